@@ -8,8 +8,13 @@
 #include <string>
 #include <filesystem>
 #include <chrono>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include "../hek/map.hpp"
 #include "../resource/resource_map.hpp"
+#include "../file/tag_path_index.hpp"
 #include "../tag/parser/parser.hpp"
 #include "../error_handler/error_handler.hpp"
 
@@ -68,19 +73,19 @@ namespace Invader {
             std::optional<std::vector<File::TagFilePath>> index;
             
             /**
-             * Bitmap data
+             * Bitmap data (shared so the parameters can be copied for each map in a batch)
              */
-            std::optional<std::vector<Resource>> bitmap_data;
+            std::shared_ptr<const ResourceMapView> bitmap_data;
             
             /**
              * Sound data
              */
-            std::optional<std::vector<Resource>> sound_data;
+            std::shared_ptr<const ResourceMapView> sound_data;
             
             /**
              * Loc data
              */
-            std::optional<std::vector<Resource>> loc_data;
+            std::shared_ptr<const ResourceMapView> loc_data;
             
             /**
              * How verbose to make the output
@@ -97,6 +102,37 @@ namespace Invader {
              */
             bool optimize_space = false;
             
+            /**
+             * Number of threads to use for reading and parsing tags, calculating the CRC32, and compressing. Tags are still compiled in order on one thread, so this does not change the output.
+             */
+            std::size_t thread_count = 1;
+            
+            /**
+             * Directory to store compiled tags in so unchanged tags can be reused by later builds
+             */
+            std::optional<std::filesystem::path> compile_cache_directory;
+            
+            /**
+             * Select what kind of profile to write
+             */
+            enum ProfileFormat {
+                /** Time, CPU time, allocations, and memory usage for each phase and tag class, as well as the slowest tags */
+                PROFILE_FORMAT_SUMMARY,
+                
+                /** Chrome trace event format, for chrome://tracing or Perfetto */
+                PROFILE_FORMAT_CHROME_TRACE
+            };
+            
+            /**
+             * Write a profile of the build to this path
+             */
+            std::optional<std::filesystem::path> profile_path;
+            
+            /**
+             * Format of the profile
+             */
+            ProfileFormat profile_format = ProfileFormat::PROFILE_FORMAT_SUMMARY;
+            
             /**
              * Control how cache files are built. Changing these may result in an incompatible cache file
              */
@@ -225,6 +261,24 @@ namespace Invader {
          */
         static std::vector<std::byte> compile_map(const BuildParameters &parameters);
 
+        /**
+         * Compile a map, writing it directly to a file rather than holding the entire map in memory
+         * @param parameters build parameters to use
+         * @param output     path to write the map to
+         */
+        static void compile_map(const BuildParameters &parameters, const std::filesystem::path &output);
+
+        /**
+         * Compile several maps at once, writing each one to a file. Maps are built at the same time on separate threads
+         * and share the tags they read, parse, and compile with each other, so tags used by more than one map are only
+         * loaded and compiled once.
+         * @param parameters   build parameters to use for each map
+         * @param outputs      paths to write each map to
+         * @param thread_count number of maps to build at once
+         * @return             number of maps that failed to build
+         */
+        static std::size_t compile_maps(const std::vector<BuildParameters> &parameters, const std::vector<std::filesystem::path> &outputs, std::size_t thread_count);
+
         /**
          * Compile a single tag
          * @param tag               tag to use
@@ -282,14 +336,17 @@ namespace Invader {
 
         /** Denotes an individual tag struct */
         struct BuildWorkloadStruct {
+            /** Allocator used for the struct's data, dependencies, and pointers */
+            using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
             /** Data in the struct */
-            std::vector<std::byte> data;
+            std::pmr::vector<std::byte> data;
 
             /** Dependencies in the struct */
-            std::vector<BuildWorkloadDependency> dependencies;
+            std::pmr::vector<BuildWorkloadDependency> dependencies;
 
             /** Struct dependencies in the struct */
-            std::vector<BuildWorkloadStructPointer> pointers;
+            std::pmr::vector<BuildWorkloadStructPointer> pointers;
 
             /** Offset of the struct in tag data if it's currently present */
             std::optional<std::size_t> offset;
@@ -300,6 +357,36 @@ namespace Invader {
             /** BSP index */
             std::optional<std::size_t> bsp = 0;
 
+            BuildWorkloadStruct() = default;
+            BuildWorkloadStruct(const BuildWorkloadStruct &) = default;
+            BuildWorkloadStruct(BuildWorkloadStruct &&) = default;
+            BuildWorkloadStruct &operator=(const BuildWorkloadStruct &) = default;
+            BuildWorkloadStruct &operator=(BuildWorkloadStruct &&) = default;
+
+            /**
+             * Instantiate an empty struct using the given allocator
+             * @param allocator allocator to use
+             */
+            explicit BuildWorkloadStruct(const allocator_type &allocator) : data(allocator), dependencies(allocator), pointers(allocator) {}
+
+            /**
+             * Copy a struct using the given allocator
+             * @param other     struct to copy
+             * @param allocator allocator to use
+             */
+            BuildWorkloadStruct(const BuildWorkloadStruct &other, const allocator_type &allocator) :
+                data(other.data, allocator), dependencies(other.dependencies, allocator), pointers(other.pointers, allocator),
+                offset(other.offset), unsafe_to_dedupe(other.unsafe_to_dedupe), bsp(other.bsp) {}
+
+            /**
+             * Move a struct using the given allocator
+             * @param other     struct to move
+             * @param allocator allocator to use
+             */
+            BuildWorkloadStruct(BuildWorkloadStruct &&other, const allocator_type &allocator) :
+                data(std::move(other.data), allocator), dependencies(std::move(other.dependencies), allocator), pointers(std::move(other.pointers), allocator),
+                offset(other.offset), unsafe_to_dedupe(other.unsafe_to_dedupe), bsp(other.bsp) {}
+
             /**
              * Resolve the pointer
              * @param offset offset of the pointer
@@ -348,9 +435,6 @@ namespace Invader {
             /** Class of the tag */
             TagFourCC tag_fourcc;
 
-            /** Original tag class, if applicable */
-            std::optional<TagFourCC> alias;
-
             /** Asset data structs */
             std::vector<std::size_t> asset_data;
 
@@ -370,8 +454,98 @@ namespace Invader {
             std::size_t path_offset;
         };
 
+        /** Denotes a tag that was read and parsed ahead of time */
+        struct BuildWorkloadPreloadedTag {
+            /** CRC32 stored in the tag file header */
+            std::uint32_t header_crc;
+
+            /** CRC32 calculated from the tag data */
+            std::uint32_t calculated_crc;
+
+            /** Parsed tag data; this may be shared with other workloads, so it must not be modified or have get_values() called on it */
+            std::shared_ptr<const Parser::ParserStruct> parsed;
+
+            /** Dependencies of the tag, found when it was read */
+            std::vector<File::TagFilePath> dependencies;
+
+            /** Time spent parsing the tag data */
+            std::chrono::steady_clock::duration parse_time {};
+
+            /** Size of the tag file */
+            std::size_t file_size = 0;
+
+            /** Hash of the tag file, if the compile cache is in use */
+            std::optional<std::uint64_t> file_hash;
+        };
+
+        /** State of the compile cache, if enabled (defined in build_workload_cache.hpp) */
+        struct CompileCache;
+
+        /** Tag file as seen by the compile cache (defined in build_workload_cache.hpp) */
+        struct CompileCacheTagFile;
+
+        /** Tags shared between workloads built together by compile_maps() (defined in build_workload_cache.hpp) */
+        struct SharedCache;
+
+        /** Timings recorded for the build profile, if enabled (defined in build_workload_profile.cpp) */
+        struct Profile;
+
+        /** Denotes a piece of the cache file that has not been written yet */
+        struct CacheFileSection {
+            /** Offset of the section in the cache file */
+            std::size_t offset;
+
+            /** Data of the section */
+            const std::byte *data;
+
+            /** Size of the section */
+            std::size_t size;
+        };
+
+        /**
+         * Memory resource for struct data. This hands out the many small allocations made for structs from a much
+         * smaller number of large blocks, counting both.
+         */
+        class BuildWorkloadArena : public std::pmr::memory_resource {
+        public:
+            /**
+             * Get the number of allocations made from the arena
+             * @return number of allocations
+             */
+            std::size_t get_allocations() const noexcept {
+                return this->allocations;
+            }
+
+            /**
+             * Get the number of blocks the arena allocated from the heap
+             * @return number of blocks
+             */
+            std::size_t get_blocks() const noexcept {
+                return this->upstream.blocks;
+            }
+
+        private:
+            class CountingResource : public std::pmr::memory_resource {
+            public:
+                std::size_t blocks = 0;
+            private:
+                void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+                void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+                bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+            } upstream;
+            std::pmr::unsynchronized_pool_resource pool { &this->upstream };
+            std::size_t allocations = 0;
+
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+            void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+        };
+
+        /** Arena the structs are allocated in; this must be declared before the structs */
+        std::shared_ptr<BuildWorkloadArena> struct_arena = std::make_shared<BuildWorkloadArena>();
+
         /** Structs being worked with */
-        std::vector<BuildWorkloadStruct> structs;
+        std::pmr::vector<BuildWorkloadStruct> structs { this->struct_arena.get() };
 
         /** Uncompressed vertices for models */
         std::vector<Parser::ModelVertexUncompressed::struct_little> uncompressed_model_vertices;
@@ -460,7 +634,43 @@ namespace Invader {
         std::chrono::steady_clock::time_point start;
         const char *scenario;
         std::vector<std::byte> build_cache_file();
+        const std::filesystem::path *output_path = nullptr;
+        std::uint32_t calculate_cache_file_crc(const std::vector<CacheFileSection> &sections, std::size_t file_size, std::size_t model_offset, std::size_t model_data_size, std::size_t tag_data_offset, std::size_t tag_data_size);
+        static std::vector<std::byte> assemble_cache_file(const std::vector<CacheFileSection> &sections, std::size_t file_size);
+        static void save_cache_file(const std::filesystem::path &path, const std::vector<CacheFileSection> &sections, std::size_t file_size);
         void add_tags();
+        void preload_tags();
+        static std::optional<BuildWorkloadPreloadedTag> preload_tag(const std::vector<std::byte> &tag_file, TagFourCC tag_fourcc, bool hash_file);
+        std::map<File::TagFilePath, BuildWorkloadPreloadedTag> preloaded_tags;
+        std::shared_ptr<SharedCache> shared_cache;
+        std::optional<BuildWorkloadPreloadedTag> find_shared_tag(const File::TagFilePath &tag_path);
+        void add_shared_tag(const File::TagFilePath &tag_path, const BuildWorkloadPreloadedTag &tag);
+        std::mutex *output_mutex = nullptr;
+        std::shared_ptr<Profile> profile;
+        void profile_begin();
+        std::size_t profile_begin_phase(const char *name);
+        void profile_end_phase(std::size_t phase);
+        void profile_begin_tag(std::size_t tag_index);
+        void profile_tag_parsed(std::chrono::steady_clock::duration parse_time, bool preloaded);
+        void profile_end_tag(bool replayed);
+        void profile_save();
+        std::size_t find_or_compile_tag(const char *tag_path, TagFourCC tag_fourcc);
+        File::TagPathIndex tag_path_index;
+        void index_tag(std::size_t tag_index);
+        void unindex_tag(std::size_t tag_index) noexcept;
+        std::shared_ptr<CompileCache> compile_cache;
+        std::size_t compile_cache_reused = 0;
+        std::size_t compile_cache_compiled = 0;
+        void compile_cache_begin();
+        bool compile_cache_replay_or_record(const char *tag_path, TagFourCC tag_fourcc, const std::filesystem::path &file_path, std::size_t tag_index);
+        void compile_cache_finish_recording(std::size_t tag_index);
+        void compile_cache_pause_recording();
+        void compile_cache_resume_recording(const char *tag_path, TagFourCC tag_fourcc, std::size_t tag_index);
+        std::optional<std::uint64_t> compile_cache_verified_key(const File::TagFilePath &tag_path);
+        std::uint64_t compile_cache_parameters_key() const;
+        const CompileCacheTagFile *compile_cache_tag_file(const File::TagFilePath &tag_path, const std::filesystem::path *file_path = nullptr);
+        static std::uint64_t compile_cache_file_hash(const std::vector<std::byte> &tag_file) noexcept;
+        void compile_tag_data_recursively(const std::byte *tag_data, std::size_t tag_data_size, std::size_t tag_index, std::optional<TagFourCC> tag_fourcc, BuildWorkloadPreloadedTag *preloaded);
         void generate_tag_array();
         void dedupe_structs();
         std::vector<std::vector<std::byte>> map_data_structs;
@@ -5,8 +5,15 @@
 
 #include <vector>
 #include <optional>
+#include <filesystem>
+#include <functional>
 
 namespace Invader::Compression {
+    /**
+     * Function that is passed decompressed data in order, a chunk at a time; the data is only valid until it returns
+     */
+    using DecompressionSink = std::function<void (const std::byte *data, std::size_t size)>;
+
     /**
      * Compress the map data
      * @param data              data pointer
@@ -14,9 +21,10 @@ namespace Invader::Compression {
      * @param output            data output
      * @param output_size       output buffer size
      * @param compression_level compression level to use
+     * @param thread_count      number of threads to compress on, or 0 to use every CPU thread; this does not change the output
      * @return                  actual size of the output
      */
-    std::size_t compress_map_data(const std::byte *data, std::size_t data_size, std::byte *output, std::size_t output_size, int compression_level = 19);
+    std::size_t compress_map_data(const std::byte *data, std::size_t data_size, std::byte *output, std::size_t output_size, int compression_level = 19, std::size_t thread_count = 0);
 
     /**
      * Decompress the map data
@@ -33,9 +41,21 @@ namespace Invader::Compression {
      * @param data              data pointer
      * @param data_size         size of the data
      * @param compression_level compression level to use
+     * @param thread_count      number of threads to compress on, or 0 to use every CPU thread; this does not change the output
      * @return                  vector of compressed data
      */
-    std::vector<std::byte> compress_map_data(const std::byte *data, std::size_t data_size, int compression_level = 19);
+    std::vector<std::byte> compress_map_data(const std::byte *data, std::size_t data_size, int compression_level = 19, std::size_t thread_count = 0);
+
+    /**
+     * Compress the map data directly to a file without holding the compressed data in memory
+     * @param data              data pointer
+     * @param data_size         size of the data
+     * @param output            path to the compressed file
+     * @param compression_level compression level to use
+     * @param thread_count      number of threads to compress on, or 0 to use every CPU thread; this does not change the output
+     * @return                  size of output in bytes
+     */
+    std::size_t compress_map_file(const std::byte *data, std::size_t data_size, const std::filesystem::path &output, int compression_level = 19, std::size_t thread_count = 0);
 
     /**
      * Decompress the map data
@@ -45,6 +65,15 @@ namespace Invader::Compression {
      */
     std::vector<std::byte> decompress_map_data(const std::byte *data, std::size_t data_size);
 
+    /**
+     * Decompress the map data, passing the header and then the decompressed data to the sink in chunks
+     * @param data              data pointer
+     * @param data_size         size of the data
+     * @param sink              function to pass the decompressed data to
+     * @return                  size of output in bytes
+     */
+    std::size_t decompress_map_data(const std::byte *data, std::size_t data_size, const DecompressionSink &sink);
+
     /**
      * Decompress one file to another file, using significantly less memory but also significantly more disk I/O
      * @param input  path to the compressed file
@@ -61,6 +90,15 @@ namespace Invader::Compression {
      * @return            size of output in bytes
      */
     std::size_t decompress_map_file(const char *input, std::byte *output, std::size_t output_size);
+
+    /**
+     * Decompress one file, passing the header and then the decompressed data to the sink in chunks, so neither the
+     * compressed nor the decompressed map is held in memory
+     * @param input  path to the compressed file
+     * @param sink   function to pass the decompressed data to
+     * @return       size of output in bytes
+     */
+    std::size_t decompress_map_file(const char *input, const DecompressionSink &sink);
 }
 
 #endif
@@ -15,9 +15,10 @@ namespace Invader {
      * @param  new_crc          new CRC32 of the map
      * @param  new_random       new random number of the map (if forging a CRC32)
      * @param  check_dirty      optionally set to false if the cache file is not dirty or true if it is
+     * @param  thread_count     number of threads to use, or 0 to use one per CPU thread
      * @return                  CRC32 of the map
      */
-    std::uint32_t calculate_map_crc(const std::byte *data, std::size_t size, const std::uint32_t *new_crc = nullptr, std::uint32_t *new_random = nullptr, bool *check_dirty = nullptr);
+    std::uint32_t calculate_map_crc(const std::byte *data, std::size_t size, const std::uint32_t *new_crc = nullptr, std::uint32_t *new_random = nullptr, bool *check_dirty = nullptr, std::size_t thread_count = 0);
     
     class Map;
     
@@ -27,9 +28,10 @@ namespace Invader {
      * @param  new_crc          new CRC32 of the map
      * @param  new_random       new random number of the map (if forging a CRC32)
      * @param  check_dirty      optionally set to false if the cache file is not dirty or true if it is
+     * @param  thread_count     number of threads to use, or 0 to use one per CPU thread
      * @return                  CRC32 of the map
      */
-    std::uint32_t calculate_map_crc(const Invader::Map &map, const std::uint32_t *new_crc = nullptr, std::uint32_t *new_random = nullptr, bool *check_dirty = nullptr);
+    std::uint32_t calculate_map_crc(const Invader::Map &map, const std::uint32_t *new_crc = nullptr, std::uint32_t *new_random = nullptr, bool *check_dirty = nullptr, std::size_t thread_count = 0);
 }
 
 #endif
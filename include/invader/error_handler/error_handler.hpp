@@ -6,6 +6,8 @@
 #include <cstddef>
 #include <optional>
 #include <vector>
+#include <mutex>
+#include <string>
 
 #include "../file/file.hpp"
 
@@ -102,6 +104,16 @@ namespace Invader {
             this->reporting_level = reporting_level;
         }
         
+        /**
+         * Print reports while holding a mutex and start each line with a label, for when other handlers print at the same time
+         * @param mutex mutex shared with everything else printing, or nullptr to print normally
+         * @param label label to start each line with
+         */
+        void set_report_output(std::mutex *mutex, const std::string &label) {
+            this->report_mutex = mutex;
+            this->report_label = label;
+        }
+        
         virtual ~ErrorHandler() = 0;
         
     protected:
@@ -123,6 +135,8 @@ namespace Invader {
         std::size_t errors = 0;
         ReportingLevel reporting_level = ReportingLevel::REPORTING_LEVEL_ALL;
         std::vector<File::TagFilePath> tag_paths;
+        std::mutex *report_mutex = nullptr;
+        std::string report_label;
         
     };
     
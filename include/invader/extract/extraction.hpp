@@ -3,6 +3,7 @@
 #ifndef INVADER__EXTRACT__EXTRACTION_HPP
 #define INVADER__EXTRACT__EXTRACTION_HPP
 
+#include <functional>
 #include <vector>
 #include "../map/tag.hpp"
 #include "../error_handler/error_handler.hpp"
@@ -14,6 +15,14 @@ namespace Invader::Parser {
 namespace Invader {
     class ExtractionWorkload : public ErrorHandler {
     public:
+        /**
+         * Function to give extracted tags to instead of saving them to the tags directory. It is called from one thread at a time, in the order tags are reported.
+         * @param tag_path path of the tag, using Halo path separators
+         * @param tag_data tag file data
+         * @return         true if the tag was written
+         */
+        using TagOutput = std::function<bool (const File::TagFilePath &tag_path, const std::vector<std::byte> &tag_data)>;
+
         /**
          * Extract a single tag from a map
          * @param tag             tag from a loaded map to extract
@@ -31,8 +40,10 @@ namespace Invader {
          * @param overwrite       overwrite tag files that exist
          * @param non_mp_globals  allow extraction of non-multiplayer globals
          * @param reporting_level reporting level to use
+         * @param thread_count    number of threads to extract tags on, or 0 to extract them on the calling thread
+         * @param output          if set, give tags to this instead of saving them to the tags directory
          */
-        static void extract_map(const Map &map, const std::string &tags, const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, bool recursive = false, bool overwrite = false, bool non_mp_globals = false, ReportingLevel reporting_level = ReportingLevel::REPORTING_LEVEL_ALL);
+        static void extract_map(const Map &map, const std::string &tags, const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, bool recursive = false, bool overwrite = false, bool non_mp_globals = false, ReportingLevel reporting_level = ReportingLevel::REPORTING_LEVEL_ALL, std::size_t thread_count = 1, const TagOutput &output = TagOutput());
         
     private:
         /**
@@ -40,6 +51,13 @@ namespace Invader {
          * @param tag tag to extract
          */
         std::optional<std::unique_ptr<Parser::ParserStruct>> extract_tag(std::size_t tag_index);
+
+        /**
+         * Parse a tag from the map without reporting anything
+         * @param tag tag to parse
+         * @return    parsed tag, or nullptr if the tag group is unsupported
+         */
+        static std::unique_ptr<Parser::ParserStruct> parse_tag(const Tag &tag);
         
         /**
          * Perform the extraction
@@ -49,9 +67,11 @@ namespace Invader {
          * @param recursive       also extract tags depended by a tag
          * @param overwrite       overwrite tag files that exist
          * @param non_mp_globals  allow extraction of non-multiplayer globals
+         * @param thread_count    number of threads to extract tags on, or 0 to extract them on the calling thread
+         * @param output          if set, give tags to this instead of saving them to the tags directory
          * @return                number of tags successfully extracted
          */
-        std::size_t perform_extraction(const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, const std::filesystem::path &tags, bool recursive, bool overwrite, bool non_mp_globals);
+        std::size_t perform_extraction(const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, const std::filesystem::path &tags, bool recursive, bool overwrite, bool non_mp_globals, std::size_t thread_count, const TagOutput &output);
         
         /** Map reference */
         const Map &map;
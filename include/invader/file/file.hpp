@@ -68,6 +68,69 @@ namespace Invader::File {
      */
     std::optional<std::vector<std::byte>> open_file(const std::filesystem::path &path);
 
+    /**
+     * File mapped into memory
+     */
+    class MemoryMappedFile {
+    public:
+        /**
+         * Create a scratch file in the temporary directory and map it into memory for reading and writing. The file
+         * is deleted when it is unmapped, and its pages can be written back to the file rather than to swap.
+         * @param size size of the file in bytes
+         * @return     the mapped file or std::nullopt if failed
+         */
+        static std::optional<MemoryMappedFile> scratch(std::size_t size);
+
+        /**
+         * Map an existing file into memory. The mapping is copy-on-write, so writing to it does not change the file.
+         * @param path path to the file
+         * @return     the mapped file or std::nullopt if failed or if the file is empty
+         */
+        static std::optional<MemoryMappedFile> open(const std::filesystem::path &path);
+
+        /**
+         * Get the mapped data
+         * @return mapped data
+         */
+        std::byte *data() noexcept {
+            return this->mapped_data;
+        }
+
+        /**
+         * Get the mapped data
+         * @return mapped data
+         */
+        const std::byte *data() const noexcept {
+            return this->mapped_data;
+        }
+
+        /**
+         * Get the size of the mapped data
+         * @return size in bytes
+         */
+        std::size_t size() const noexcept {
+            return this->mapped_size;
+        }
+
+        MemoryMappedFile(MemoryMappedFile &&move) noexcept;
+        MemoryMappedFile &operator=(MemoryMappedFile &&move) noexcept;
+        MemoryMappedFile(const MemoryMappedFile &) = delete;
+        MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+        ~MemoryMappedFile();
+
+    private:
+        MemoryMappedFile(std::byte *mapped_data, std::size_t mapped_size) noexcept : mapped_data(mapped_data), mapped_size(mapped_size) {}
+
+        /** Unmap the data, if any */
+        void unmap() noexcept;
+
+        /** Mapped data */
+        std::byte *mapped_data = nullptr;
+
+        /** Size of the mapped data */
+        std::size_t mapped_size = 0;
+    };
+
     /**
      * Attempt to save the file
      * @param  path path to the file
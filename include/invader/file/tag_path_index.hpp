@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__FILE__TAG_PATH_INDEX_HPP
+#define INVADER__FILE__TAG_PATH_INDEX_HPP
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../hek/fourcc.hpp"
+
+namespace Invader::File {
+    /**
+     * Hash index of tags by path and class. Each distinct path is stored once, and lookups don't allocate.
+     */
+    class TagPathIndex {
+    public:
+        /**
+         * Add a tag to the index. If a tag with the same path and class is already in it, the lower index is found.
+         * @param path       path of the tag
+         * @param tag_fourcc class of the tag
+         * @param index      index of the tag
+         */
+        void insert(std::string_view path, HEK::TagFourCC tag_fourcc, std::size_t index);
+
+        /**
+         * Remove a tag from the index, such as before it is renamed. If other tags have the same path and class, the lowest
+         * of those is found instead.
+         * @param path       path of the tag
+         * @param tag_fourcc class of the tag
+         * @param index      index of the tag
+         */
+        void erase(std::string_view path, HEK::TagFourCC tag_fourcc, std::size_t index) noexcept;
+
+        /**
+         * Find a tag
+         * @param path       path of the tag
+         * @param tag_fourcc class of the tag
+         * @return           index of the tag if found
+         */
+        std::optional<std::size_t> find(std::string_view path, HEK::TagFourCC tag_fourcc) const noexcept;
+
+        /**
+         * Remove everything from the index
+         */
+        void clear() noexcept;
+
+        /**
+         * Reserve space for the given number of tags
+         * @param count number of tags
+         */
+        void reserve(std::size_t count);
+
+    private:
+        struct PathHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view path) const noexcept {
+                return std::hash<std::string_view>()(path);
+            }
+        };
+
+        /** Index of each distinct path */
+        std::unordered_map<std::string, std::uint32_t, PathHash, std::equal_to<>> paths;
+
+        /** Lowest tag index for each path index (high 32 bits) and class (low 32 bits) */
+        std::unordered_map<std::uint64_t, std::size_t> tags;
+
+        /** Every other tag index with the same path and class, for the few that have more than one */
+        std::unordered_map<std::uint64_t, std::vector<std::size_t>> duplicates;
+
+        static std::uint64_t tag_key(std::uint32_t path, HEK::TagFourCC tag_fourcc) noexcept {
+            return (static_cast<std::uint64_t>(path) << 32) | static_cast<std::uint32_t>(tag_fourcc);
+        }
+    };
+}
+
+#endif
@@ -129,5 +129,17 @@ namespace Invader::HEK {
         #define LittleEndian NativeEndian
         #define BigEndian SwappedEndian
     #endif
+
+    /**
+     * Convert an array of big endian structs to native endian (or the other way around) in bulk. This uses SIMD shuffles
+     * if the CPU supports them.
+     * @param input        array to read from
+     * @param output       array to write to; this may be the same as input
+     * @param size         size of the array in bytes; the array must start at the start of a struct
+     * @param pattern      byte i of the output is byte pattern[i] of the same 16 byte block of the input, repeating every
+     *                     pattern_size bytes
+     * @param pattern_size size of the pattern in bytes; this must be a multiple of both 16 and the struct size
+     */
+    void swap_big_endian_array(const std::byte *input, std::byte *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept;
 }
 #endif
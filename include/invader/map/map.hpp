@@ -7,9 +7,14 @@
 #include <vector>
 #include <cstddef>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <optional>
+#include <filesystem>
 
 #include "../resource/resource_map.hpp"
+#include "../file/file.hpp"
+#include "../file/tag_path_index.hpp"
 #include "../hek/map.hpp"
 #include "tag.hpp"
 
@@ -132,9 +137,10 @@ namespace Invader {
         
         /**
          * Calculate the map's CRC32
-         * @return crc32
+         * @param thread_count number of threads to use, or 0 to use one per CPU thread
+         * @return             crc32
          */
-        std::uint32_t get_crc32() const noexcept;
+        std::uint32_t get_crc32(std::size_t thread_count = 0) const noexcept;
 
         /**
          * Get the tag data length
@@ -176,6 +182,50 @@ namespace Invader {
                                  std::vector<std::byte> &&loc_data = std::vector<std::byte>(),
                                  std::vector<std::byte> &&sounds_data = std::vector<std::byte>());
 
+        /**
+         * Create a Map by reading the given file and moving the given bitmaps, loc, and sound data. Compressed maps are
+         * decompressed straight from the file into a memory-mapped scratch file, so the compressed map is never held in
+         * memory.
+         * @param  path         path to the map
+         * @param  bitmaps_data bitmap data vector
+         * @param  loc_data     loc data vector
+         * @param  sounds_data  sound data vector
+         * @return              map
+         */
+        static Map map_with_path(const std::filesystem::path &path,
+                                 std::vector<std::byte> &&bitmaps_data = std::vector<std::byte>(),
+                                 std::vector<std::byte> &&loc_data = std::vector<std::byte>(),
+                                 std::vector<std::byte> &&sounds_data = std::vector<std::byte>());
+
+        /**
+         * Create a Map by reading the given file and sharing the given resource map views. Compressed maps are
+         * decompressed the same way as with the other map_with_path().
+         * @param  path         path to the map
+         * @param  bitmaps_data bitmaps.map view
+         * @param  loc_data     loc.map view
+         * @param  sounds_data  sounds.map view
+         * @return              map
+         */
+        static Map map_with_path(const std::filesystem::path &path,
+                                 std::shared_ptr<const ResourceMapView> bitmaps_data,
+                                 std::shared_ptr<const ResourceMapView> loc_data = nullptr,
+                                 std::shared_ptr<const ResourceMapView> sounds_data = nullptr);
+
+        /**
+         * Create a Map by memory-mapping the given file and resource maps, so only the data that is actually used is
+         * read. The mappings are copy-on-write, so the files are never modified. Compressed maps are decompressed the
+         * same way as with map_with_path(). Resource maps that are missing or can't be read are left out.
+         * @param  path          path to the map
+         * @param  bitmaps_path  path to bitmaps.map
+         * @param  loc_path      path to loc.map
+         * @param  sounds_path   path to sounds.map
+         * @return               map
+         */
+        static Map map_with_mapping(const std::filesystem::path &path,
+                                    const std::optional<std::filesystem::path> &bitmaps_path = std::nullopt,
+                                    const std::optional<std::filesystem::path> &loc_path = std::nullopt,
+                                    const std::optional<std::filesystem::path> &sounds_path = std::nullopt);
+
         /**
          * Get the data at the specified offset
          * @param  offset       offset
@@ -309,9 +359,10 @@ namespace Invader {
         
         /**
          * Do a basic check to ensure the map hasn't been improperly modified or corrupted
-         * @return true if the map is clean
+         * @param thread_count number of threads to use for calculating the CRC32, or 0 to use one per CPU thread
+         * @return             true if the map is clean
          */
-        bool is_clean() const noexcept;
+        bool is_clean(std::size_t thread_count = 0) const noexcept;
         
         /**
          * Get the game engine
@@ -324,6 +375,12 @@ namespace Invader {
         /** Map data if managed */
         std::vector<std::byte> data;
 
+        /** Map data if memory-mapped instead, either from the file itself or from a scratch file it was decompressed into */
+        std::optional<File::MemoryMappedFile> mapped_data;
+
+        /** Size of the map in the mapping */
+        std::size_t mapped_data_size = 0;
+
 
         /** Bitmaps data if managed */
         std::vector<std::byte> bitmap_data;
@@ -335,6 +392,10 @@ namespace Invader {
 
         /** Sounds data if managed */
         std::vector<std::byte> sound_data;
+
+
+        /** Resource maps if given as views instead; these are never written to */
+        std::shared_ptr<const ResourceMapView> bitmap_view, sound_view, loc_view;
         
 
         /** Model data offset */
@@ -350,6 +411,18 @@ namespace Invader {
         /** Tag array */
         std::vector<Tag> tags;
 
+        /** Whether each tag's path has been loaded */
+        std::unique_ptr<std::once_flag[]> tag_path_loaded;
+
+        /** Whether each tag's data location has been loaded */
+        std::unique_ptr<std::once_flag[]> tag_data_loaded;
+
+        /** Tag array indices by path and class, built when first needed */
+        File::TagPathIndex tag_path_index;
+
+        /** Whether the tag path index has been built */
+        mutable std::once_flag tag_path_index_built;
+
         /** Scenario tag ID */
         std::size_t scenario_tag_id = 0;
 
@@ -362,8 +435,8 @@ namespace Invader {
         /** Base memory address */
         std::uint32_t base_memory_address = 0;
         
-        /** Invalid paths? */
-        bool invalid_paths_detected = false;
+        /** Invalid paths? This is only complete once every tag's path has been loaded. */
+        std::atomic<bool> invalid_paths_detected = false;
 
         /** Map is compressed */
         CompressionType compressed = CompressionType::COMPRESSION_TYPE_NONE;
@@ -405,6 +478,15 @@ namespace Invader {
         /** Populate tag array */
         void populate_tag_array();
 
+        /** Check and normalize the path of the tag */
+        void load_tag_path(Tag &tag) noexcept;
+
+        /** Find where the tag's data is, throwing if it's indexed but can't be found in its resource map */
+        void load_tag_data(Tag &tag);
+
+        /** Index every tag by path and class */
+        void build_tag_path_index();
+
         /** Get BSPs */
         void get_bsps();
 
@@ -416,6 +498,13 @@ namespace Invader {
          */
         bool decompress_if_needed(const std::byte *data, std::size_t data_size);
 
+        /**
+         * Read the map file into data, or mapped_data if it's compressed or map_file is set
+         * @param path     path to the map
+         * @param map_file memory-map the file rather than reading it if it isn't compressed
+         */
+        void read_map_file(const std::filesystem::path &path, bool map_file);
+
         Map() = default;
     };
 }
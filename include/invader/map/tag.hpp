@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <cstddef>
 
@@ -43,6 +44,7 @@ namespace Invader {
          * @return path of the tag
          */
         const std::string &get_path() const noexcept {
+            this->load_path();
             return this->path;
         }
 
@@ -59,6 +61,7 @@ namespace Invader {
          * @return true if this is an indexed tag that is not in the map
          */
         bool is_indexed() const noexcept {
+            this->load_data();
             return this->indexed;
         }
         
@@ -67,6 +70,7 @@ namespace Invader {
          * @return resource index if applicable
          */
         std::optional<std::size_t> get_resource_index() const noexcept {
+            this->load_data();
             return this->resource_index;
         }
 
@@ -172,6 +176,7 @@ namespace Invader {
          */
         template <template<template<typename> typename> typename StructType>
         StructType<HEK::LittleEndian> &get_base_struct() {
+            this->load_data();
             return get_struct_at_pointer<StructType>(this->base_struct_pointer);
         }
 
@@ -258,7 +263,10 @@ namespace Invader {
         /** Map reference */
         Map &map;
 
-        /** Path of tag */
+        /** Path of tag as stored in the cache file, or empty if it isn't null-terminated in the tag data */
+        std::string_view raw_path;
+
+        /** Path of tag, checked and normalized from the raw path when first needed */
         std::string path;
 
         /** Class of tag */
@@ -266,9 +274,9 @@ namespace Invader {
 
         /** This is indexed and not in the map? */
         bool indexed = false;
-        
-        /** It uses external pointers */
-        bool external_pointers = false;
+
+        /** If indexed, the resource map has the tag's data */
+        bool resource_available = false;
 
         /** Base struct pointer */
         HEK::Pointer base_struct_pointer;
@@ -287,6 +295,12 @@ namespace Invader {
 
         /** Initialize the tag */
         Tag(Map &map);
+
+        /** Check and normalize the path if it hasn't been done yet */
+        void load_path() const noexcept;
+
+        /** Find where the tag data is if it hasn't been done yet; indexed tags are always found when the map is loaded */
+        void load_data() const noexcept;
         
         /** Resource index */
         std::optional<std::size_t> resource_index;
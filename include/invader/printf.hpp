@@ -16,8 +16,25 @@ bool is_on_color_term() noexcept;
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <string>
 
-#define eprintf(...) std::fprintf(stderr, __VA_ARGS__)
+/**
+ * Hold everything the calling thread prints to stderr in a string instead, such as so it can be printed in order later
+ * @param capture string to append to, or nullptr to print to stderr again
+ */
+void set_stderr_capture(std::string *capture) noexcept;
+
+/**
+ * Print to stderr, or to the calling thread's capture string if it has one
+ * @param format format string
+ * @return       number of characters printed
+ */
+#ifdef __GNUC__
+__attribute__((format(printf, 1, 2)))
+#endif
+int stderr_printf(const char *format, ...);
+
+#define eprintf(...) stderr_printf(__VA_ARGS__)
 #define oprintf(...) std::fprintf(stdout, __VA_ARGS__)
 #define oflush(...) std::fflush(stdout)
 
@@ -4,9 +4,15 @@
 #define INVADER__RESOURCE__RESOURCE_MAP_HPP
 
 #include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "../file/file.hpp"
+
 namespace Invader {
     struct Resource {
         std::string path;
@@ -15,6 +21,142 @@ namespace Invader {
         std::size_t data_offset;
     };
 
+    /**
+     * Resource referencing the data of a resource map rather than holding a copy of it
+     */
+    struct ResourceView {
+        /** Resource data */
+        std::span<const std::byte> data;
+
+        /** Path as stored in the resource map, which may have duplicate slashes */
+        const char *raw_path;
+
+        /** Offset of the path in the resource map */
+        std::size_t path_offset;
+
+        /** Offset of the data in the resource map */
+        std::size_t data_offset;
+
+        /**
+         * Get the path with duplicate slashes removed
+         * @return path
+         */
+        std::string path() const;
+
+        /**
+         * Check if the path with duplicate slashes removed is equal to the given path, only removing them if needed
+         * @param  path path to compare with
+         * @return      true if equal
+         */
+        bool path_equals(const std::string &path) const;
+    };
+
+    /**
+     * Resource map whose resources are views into its data, which is memory-mapped from the file if possible
+     */
+    class ResourceMapView {
+    public:
+        /**
+         * Map the resource map file into memory and read its resources
+         * @param  path path to the resource map
+         * @return      resource map view
+         * @throws      if failed
+         */
+        static ResourceMapView view_file(const std::filesystem::path &path);
+
+        /**
+         * Take the resource map data and read its resources
+         * @param  data resource map data
+         * @return      resource map view
+         * @throws      if failed
+         */
+        static ResourceMapView view_data(std::vector<std::byte> &&data);
+
+        /**
+         * Get the number of resources
+         * @return number of resources
+         */
+        std::size_t size() const noexcept {
+            return this->resources.size();
+        }
+
+        /**
+         * Get the resource at the given index
+         * @param  index index of the resource
+         * @return       resource
+         */
+        const ResourceView &operator[](std::size_t index) const noexcept {
+            return this->resources[index];
+        }
+
+        std::vector<ResourceView>::const_iterator begin() const noexcept {
+            return this->resources.begin();
+        }
+
+        std::vector<ResourceView>::const_iterator end() const noexcept {
+            return this->resources.end();
+        }
+
+        /**
+         * Find the first resource with the given path
+         * @param  path         path to look for, without duplicate slashes
+         * @param  odd_only     only consider resources on odd indices (bitmap and sound tags)
+         * @return              index of the resource if found
+         */
+        std::optional<std::size_t> find(const std::string &path, bool odd_only = false) const noexcept;
+
+        /**
+         * Get the whole resource map
+         * @return resource map data
+         */
+        const std::byte *get_data() const noexcept {
+            return this->mapped_data.has_value() ? this->mapped_data->data() : this->data.data();
+        }
+
+        /**
+         * Get the size of the whole resource map
+         * @return resource map size
+         */
+        std::size_t get_data_length() const noexcept {
+            return this->mapped_data.has_value() ? this->mapped_data->size() : this->data.size();
+        }
+
+        ResourceMapView(ResourceMapView &&) = default;
+        ResourceMapView &operator=(ResourceMapView &&) = default;
+
+    private:
+        ResourceMapView() = default;
+
+        /**
+         * Read the resources and index their paths
+         */
+        void read_resources();
+
+        /** Resource map data if memory-mapped */
+        std::optional<File::MemoryMappedFile> mapped_data;
+
+        /** Resource map data if read */
+        std::vector<std::byte> data;
+
+        /** Resources */
+        std::vector<ResourceView> resources;
+
+        /** Index of the first resource with each path */
+        std::unordered_map<std::string, std::size_t> path_index;
+
+        /** Index of the first resource on an odd index with each path */
+        std::unordered_map<std::string, std::size_t> odd_path_index;
+    };
+
+    /**
+     * Return an array of views of the resources in the given resource map
+     * @param  data pointer to resource data
+     * @param  size size of resource data
+     * @return      array of views
+     * @throws      if failed
+     */
+    std::vector<ResourceView> view_resource_map(const std::byte *data, std::size_t size);
+
     /**
      * Return an array of containers for the given resource map
      * @param  data pointer to resource data
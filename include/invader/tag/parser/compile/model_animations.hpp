@@ -18,6 +18,17 @@ namespace Invader::Parser {
      * @param animation animation
      */
     std::size_t expected_uncompressed_frame_size_for_animation(ModelAnimationsAnimation &animation) noexcept;
+
+    /**
+     * Convert the uncompressed frame data or default data of the animation from big endian to native endian (or the
+     * other way around) in bulk.
+     * @param animation    animation
+     * @param input        data to read from
+     * @param output       data to write to; this may be the same as input
+     * @param frame_count  number of frames to convert
+     * @param default_data convert default data (nodes that are not animated) instead of frame data
+     */
+    void swap_animation_frame_data(ModelAnimationsAnimation &animation, const std::byte *input, std::byte *output, std::size_t frame_count, bool default_data) noexcept;
 }
 
 #endif
@@ -4,12 +4,18 @@
 #define INVADER__TAG__PARSER__PARSER_STRUCT_HPP
 
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <cstring>
 #include <deque>
 #include <cstddef>
 #include <list>
 #include <optional>
 #include <variant>
 #include <memory>
+#include <string_view>
+#include <span>
+#include <type_traits>
 #include "../hek/definition.hpp"
 
 namespace Invader {
@@ -122,6 +128,87 @@ namespace Invader::Parser {
         }
     };
 
+    /**
+     * Dependency found by scanning a tag file without parsing it
+     */
+    struct ScannedDependency {
+        /** Tag class */
+        TagFourCC tag_fourcc;
+        
+        /** Path as stored in the tag file; this points into the tag file data */
+        std::string_view path;
+    };
+
+    /**
+     * Range over a reflexive in HEK tag data; elements are read as views of type T (see the generated View classes)
+     */
+    template<typename T> class ReflexiveView {
+    public:
+        class iterator {
+        public:
+            T operator*() const noexcept {
+                return T(this->element, this->data, this->data_size);
+            }
+            iterator &operator++() {
+                std::size_t trailing_size = T::get_trailing_size(this->element, this->data, this->data_size);
+                this->element += sizeof(typename T::struct_big);
+                this->data += trailing_size;
+                this->data_size -= trailing_size;
+                this->index++;
+                return *this;
+            }
+            bool operator==(const iterator &other) const noexcept {
+                return this->index == other.index;
+            }
+            bool operator!=(const iterator &other) const noexcept {
+                return this->index != other.index;
+            }
+            iterator(const std::byte *element, const std::byte *data, std::size_t data_size, std::size_t index) noexcept : element(element), data(data), data_size(data_size), index(index) {}
+        private:
+            const std::byte *element;
+            const std::byte *data;
+            std::size_t data_size;
+            std::size_t index;
+        };
+
+        iterator begin() const noexcept {
+            return iterator(this->array, this->data, this->data_size, 0);
+        }
+        iterator end() const noexcept {
+            return iterator(nullptr, nullptr, 0, this->count);
+        }
+        std::size_t size() const noexcept {
+            return this->count;
+        }
+        bool empty() const noexcept {
+            return this->count == 0;
+        }
+
+        /**
+         * Get the element at the index; this skips over the data stored after each element before it
+         * @param index index of the element
+         * @return      view of the element
+         * @throws      OutOfBoundsException if index is out of bounds
+         */
+        T operator[](std::size_t index) const {
+            if(index >= this->count) {
+                throw OutOfBoundsException();
+            }
+            auto it = this->begin();
+            while(index-- > 0) {
+                ++it;
+            }
+            return *it;
+        }
+
+        ReflexiveView(const std::byte *array, std::size_t count, const std::byte *data, std::size_t data_size) noexcept : array(array), data(data), data_size(data_size), count(count) {}
+    private:
+        const std::byte *array;
+        const std::byte *data;
+        std::size_t data_size;
+        std::size_t count;
+    };
+
     class ParserStructValue {
     public:
         enum ValueType {
@@ -939,6 +1026,52 @@ namespace Invader::Parser {
         }
     };
 
+    /**
+     * Compile-time description of a field in a parser struct. Each parser struct has a constexpr table of these (fields)
+     * for the same fields get_values() returns, and visit_fields() passes each one along with the member it describes.
+     */
+    struct ParserStructField {
+        /** Name of the member */
+        const char *member_name;
+
+        /** Type of the value */
+        ParserStructValue::ValueType type;
+
+        /** Number of values (2 if it's bounds) */
+        std::size_t count;
+
+        /** Value can be added or removed when a map is compiled */
+        bool volatile_value;
+
+        /** Classes a dependency can reference; empty if it can reference anything */
+        std::span<const TagFourCC> allowed_classes;
+
+        /** Number of options an enum has */
+        std::size_t enum_count;
+
+        /** Options of an enum that are not listed */
+        std::span<const std::uint16_t> excluded_options;
+
+        /** Bits of a bitmask that are listed */
+        std::uint64_t bitmask;
+
+        /**
+         * Get the number format
+         * @return number format
+         */
+        constexpr ParserStructValue::NumberFormat get_number_format() const noexcept {
+            if(this->type < ParserStructValue::ValueType::VALUE_TYPE_FLOAT) {
+                return ParserStructValue::NumberFormat::NUMBER_FORMAT_INT;
+            }
+            else if(this->type < ParserStructValue::ValueType::VALUE_TYPE_REFLEXIVE) {
+                return ParserStructValue::NumberFormat::NUMBER_FORMAT_FLOAT;
+            }
+            else {
+                return ParserStructValue::NumberFormat::NUMBER_FORMAT_NONE;
+            }
+        }
+    };
+
     struct ParserStruct {
         /**
          * Get whether or not the data is formatted for cache files.
@@ -955,6 +1088,17 @@ namespace Invader::Parser {
          */
         static std::unique_ptr<ParserStruct> parse_hek_tag_file(const std::byte *data, std::size_t data_size, bool postprocess = false);
 
+        /**
+         * Find all dependencies in the HEK tag file without parsing it. This is much faster than using parse_hek_tag_file()
+         * and then going through get_values(), but only dependencies with a path are returned. Unlike parse_hek_tag_file(),
+         * errors in the tag data are only reported by the exception thrown, not printed.
+         * @param  data      Tag file data to read from
+         * @param  data_size Size of the tag file
+         * @return           dependencies in the order they are stored; paths point into data
+         * @throws           InvalidTagDataException or OutOfBoundsException if the tag file is invalid
+         */
+        static std::vector<ScannedDependency> scan_hek_tag_file_dependencies(const std::byte *data, std::size_t data_size);
+
         /**
          * Generate a tag base struct
          * @param  tag_class tag class
@@ -974,7 +1118,7 @@ namespace Invader::Parser {
          * @param  reset_enums attempt to fix the enums by setting them to 0
          * @return             true if broken enums were found; false if not
          */
-        bool check_for_broken_enums(bool reset_enums);
+        virtual bool check_for_broken_enums(bool reset_enums) = 0;
 
         /**
          * Check for broken indices
@@ -996,7 +1140,13 @@ namespace Invader::Parser {
          * @param  null_references attempt to fix the references by nulling them out
          * @return                 true if invalid references were found; false if not
          */
-        bool check_for_invalid_references(bool null_references);
+        virtual bool check_for_invalid_references(bool null_references) = 0;
+
+        /**
+         * Get all dependencies with a path in the struct and its reflexives, in the order they are stored
+         * @return dependencies; these point into the struct
+         */
+        virtual std::vector<const Dependency *> get_dependencies() = 0;
 
         /**
          * Check for nonnormal vectors
@@ -1036,6 +1186,13 @@ namespace Invader::Parser {
          */
         virtual std::vector<std::byte> generate_hek_tag_data(std::optional<TagFourCC> generate_header_class = std::nullopt, bool clear_on_save = false) = 0;
 
+        /**
+         * Get the size of the HEK tag data generate_hek_tag_data() makes, not including the tag file header. This formats the
+         * struct for HEK tags first if it is formatted for cache files, as generate_hek_tag_data() would.
+         * @return size in bytes
+         */
+        virtual std::size_t hek_tag_data_size() = 0;
+
         /**
          * Refactor the tag reference, replacing all references with the given reference. Paths must use Halo path separators.
          * @param from_path  Path to look for
@@ -1120,8 +1277,216 @@ namespace Invader::Parser {
         bool cache_formatted = false;
         
         virtual std::vector<ParserStructValue> get_values_internal() = 0;
+
+        /**
+         * Compare the struct against another struct of the same type without listing the differences
+         * @param what            struct to compare against; this must be the same type
+         * @param precision       allow small differences for floats
+         * @param ignore_volatile ignore data that can be added or removed when a map is compiled
+         * @return                true if they are the same
+         */
+        virtual bool compare_fields(const ParserStruct &what, bool precision, bool ignore_volatile) const = 0;
+
+        /**
+         * Check if floats are too different to be considered the same when comparing with precision
+         * @param a first float
+         * @param b second float
+         * @return  true if too different
+         */
+        static constexpr bool too_different(double a, double b) noexcept {
+            double delta = 0.0001;
+            
+            auto max_discrepency = a * delta;
+            if(max_discrepency < 0.0) {
+                max_discrepency *= -1.0;
+            }
+            
+            auto difference = (a - b);
+            if(difference < 0.0) {
+                difference *= -1.0;
+            }
+            
+            // (a-b) > delta && b is not in [a - dA, a + dA]
+            return difference > delta && ((b > a + max_discrepency) || (b < a - max_discrepency));
+        }
+
+        /**
+         * Compare two structs of the same type through their fields
+         * @param a               first struct
+         * @param b               second struct
+         * @param precision       allow small differences for floats
+         * @param ignore_volatile ignore data that can be added or removed when a map is compiled
+         * @return                true if they are the same
+         */
+        template <typename T>
+        static bool compare_template(const T &a, const T &b, bool precision, bool ignore_volatile) {
+            return T::visit_fields([precision, ignore_volatile](const ParserStructField &field, const auto &a_value, const auto &b_value) -> bool {
+                using value_type = std::remove_cvref_t<decltype(a_value)>;
+
+                // Ignore volatile values
+                if(ignore_volatile && field.volatile_value) {
+                    return true;
+                }
+
+                if constexpr(is_reflexive<value_type>::value) {
+                    if(a_value.size() != b_value.size()) {
+                        return false;
+                    }
+                    for(std::size_t i = 0; i < a_value.size(); i++) {
+                        if(!compare_template(a_value[i], b_value[i], precision, ignore_volatile)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+                else if constexpr(std::is_same_v<value_type, Dependency>) {
+                    return a_value == b_value;
+                }
+                else if constexpr(std::is_same_v<value_type, HEK::TagString>) {
+                    return std::strcmp(a_value.string, b_value.string) == 0;
+                }
+                else if constexpr(std::is_same_v<value_type, std::vector<std::byte>>) {
+                    return a_value == b_value;
+                }
+                else if constexpr(std::is_enum_v<value_type>) {
+                    // Enums that are both out of range are the same unknown value
+                    auto a_index = static_cast<std::size_t>(a_value);
+                    auto b_index = static_cast<std::size_t>(b_value);
+                    return a_index == b_index || (a_index >= field.enum_count && b_index >= field.enum_count);
+                }
+                else {
+                    if constexpr(std::is_integral_v<value_type>) {
+                        if(field.type == ParserStructValue::ValueType::VALUE_TYPE_BITMASK) {
+                            return ((static_cast<std::uint64_t>(a_value) ^ static_cast<std::uint64_t>(b_value)) & field.bitmask) == 0;
+                        }
+                    }
+                    if(field.type == ParserStructValue::ValueType::VALUE_TYPE_TAGID) {
+                        return true;
+                    }
+                    return numbers_equal(field, &a_value, &b_value, sizeof(std::remove_extent_t<value_type>), precision);
+                }
+            }, a, b);
+        }
+
+        /**
+         * Check for broken enums through the struct's fields
+         * @param  s           struct to check
+         * @param  reset_enums attempt to fix the enums by setting them to the first listed option
+         * @return             true if broken enums were found; false if not
+         */
+        template <typename T>
+        static bool check_for_broken_enums_template(T &s, bool reset_enums) {
+            bool result = false;
+            T::visit_fields([&result, reset_enums](const ParserStructField &field, auto &value) -> bool {
+                using value_type = std::remove_cvref_t<decltype(value)>;
+                if constexpr(is_reflexive<value_type>::value) {
+                    for(std::size_t c = 0; c < value.size() && (!result || reset_enums); c++) { // continue until result is true, unless we're resetting enums
+                        result = check_for_broken_enums_template(value[c], reset_enums) || result;
+                    }
+                }
+                else if constexpr(std::is_enum_v<value_type>) {
+                    auto is_listed = [&field](std::size_t index) {
+                        return index < field.enum_count && std::find(field.excluded_options.begin(), field.excluded_options.end(), index) == field.excluded_options.end();
+                    };
+                    if(!is_listed(static_cast<std::size_t>(value))) {
+                        if(reset_enums) {
+                            std::size_t first = 0;
+                            while(!is_listed(first)) {
+                                first++;
+                            }
+                            value = static_cast<value_type>(first);
+                        }
+                        result = true;
+                    }
+                }
+                
+                // If we're done, stop
+                return reset_enums || !result;
+            }, s);
+            return result;
+        }
+
+        /**
+         * Check for invalid references through the struct's fields
+         * @param  s               struct to check
+         * @param  null_references attempt to fix the references by nulling them out
+         * @return                 true if invalid references were found; false if not
+         */
+        template <typename T>
+        static bool check_for_invalid_references_template(T &s, bool null_references) {
+            bool result = false;
+            T::visit_fields([&result, null_references](const ParserStructField &field, auto &value) -> bool {
+                using value_type = std::remove_cvref_t<decltype(value)>;
+                if constexpr(is_reflexive<value_type>::value) {
+                    for(std::size_t c = 0; c < value.size() && (!result || null_references); c++) { // continue until result is true, unless we're nulling references
+                        result = check_for_invalid_references_template(value[c], null_references) || result;
+                    }
+                }
+                else if constexpr(std::is_same_v<value_type, Dependency>) {
+                    auto &allowed_classes = field.allowed_classes;
+                    if(!allowed_classes.empty() && !value.path.empty() && std::find(allowed_classes.begin(), allowed_classes.end(), value.tag_fourcc) == allowed_classes.end()) {
+                        if(null_references) {
+                            value.tag_fourcc = allowed_classes[0]; // set it
+                            value.path.clear(); // clear the path
+                        }
+                        result = true;
+                    }
+                }
+                
+                // If we're done, stop
+                return null_references || !result;
+            }, s);
+            return result;
+        }
+
+        /**
+         * Get all dependencies with a path through the struct's fields
+         * @param s            struct to go through
+         * @param dependencies dependencies to append to
+         */
+        template <typename T>
+        static void get_dependencies_template(T &s, std::vector<const Dependency *> &dependencies) {
+            T::visit_fields([&dependencies](const ParserStructField &, auto &value) -> bool {
+                using value_type = std::remove_cvref_t<decltype(value)>;
+                if constexpr(is_reflexive<value_type>::value) {
+                    for(auto &c : value) {
+                        get_dependencies_template(c, dependencies);
+                    }
+                }
+                else if constexpr(std::is_same_v<value_type, Dependency>) {
+                    if(!value.path.empty()) {
+                        dependencies.emplace_back(&value);
+                    }
+                }
+                return true;
+            }, s);
+        }
         
     private:
+        template <typename T> struct is_reflexive : std::false_type {};
+        template <typename T> struct is_reflexive<std::vector<T>> : std::is_base_of<ParserStruct, T> {};
+
+        static bool numbers_equal(const ParserStructField &field, const void *a, const void *b, std::size_t size, bool precision) noexcept {
+            if(field.get_number_format() != ParserStructValue::NumberFormat::NUMBER_FORMAT_FLOAT) {
+                return std::memcmp(a, b, size) == 0;
+            }
+            
+            // Go through each float to find a difference
+            const auto *a_bytes = reinterpret_cast<const std::byte *>(a);
+            const auto *b_bytes = reinterpret_cast<const std::byte *>(b);
+            for(std::size_t i = 0; i + sizeof(float) <= size; i += sizeof(float)) {
+                float a_float, b_float;
+                std::memcpy(&a_float, a_bytes + i, sizeof(a_float));
+                std::memcpy(&b_float, b_bytes + i, sizeof(b_float));
+                
+                // If accounting for slight precision errors, skip
+                if(a_float != b_float && !(precision && !too_different(a_float, b_float))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
         bool compare(const ParserStruct *what, bool precision, bool ignore_volatile, std::list<std::string> *differences, std::size_t depth) const;
         
         std::optional<std::vector<ParserStructValue>> values;
@@ -11,34 +11,9 @@
 #include <invader/map/map.hpp>
 #include <invader/dependency/found_tag_dependency.hpp>
 #include "../command_line_option.hpp"
+#include "archive_format.hpp"
 #include <invader/file/file.hpp>
 
-struct Format {
-    const char *name;
-    const char *extension;
-    int (*filter)(archive *a);
-    int (*format)(archive *a);
-};
-
-static const constexpr Format formats[] = {
-    {"7z", ".7z", nullptr, archive_write_set_format_7zip},
-    {"tar-gz", ".tar.xz", archive_write_add_filter_gzip, archive_write_set_format_pax_restricted},
-    {"tar-xz", ".tar.xz", archive_write_add_filter_xz, archive_write_set_format_pax_restricted},
-    {"tar-zst", ".tar.zst", archive_write_add_filter_zstd, archive_write_set_format_pax_restricted},
-    {"zip", ".zip", nullptr, archive_write_set_format_zip}
-};
-
-static std::string list_formats() {
-    std::string f;
-    for(auto &format : formats) {
-        if(!f.empty()) {
-            f = f + ", ";
-        }
-        f = f + format.name;
-    }
-    return f;
-}
-
 int main(int argc, const char **argv) {
     set_up_color_term();
 
@@ -55,13 +30,13 @@ int main(int argc, const char **argv) {
         bool verbose = false;
         bool overwrite = false;
         std::optional<HEK::GameEngine> engine;
-        const Format *format = &formats[0];
+        const ArchiveFormat *format = &archive_formats[0];
     } archive_options;
 
     static constexpr char DESCRIPTION[] = "Generate .tar.xz archives of the tags required to build a cache file.";
     static constexpr char USAGE[] = "[options] <-g <engine> <scenario> | -s tag.class>";
 
-    std::string formats_argument = std::string("Specify format. Valid formats are: ") + list_formats() + ". Default format is 7z";
+    std::string formats_argument = std::string("Specify format. Valid formats are: ") + list_archive_formats() + ". Default format is 7z";
 
     const CommandLineOption options[] {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO),
@@ -82,7 +57,7 @@ int main(int argc, const char **argv) {
         switch(opt) {
             case 'F': {
                 bool found = false;
-                for(auto &f : formats) {
+                for(auto &f : archive_formats) {
                     if(std::strcmp(arguments[0], f.name) == 0) {
                         archive_options.format = &f;
                         found = true;
@@ -281,11 +256,11 @@ int main(int argc, const char **argv) {
         try {
             auto path = Invader::File::tag_path_to_file_path(base_tag + ".scenario", archive_options.tags);
             auto scenario_data = Invader::File::open_file(path.value()).value();
-            auto scenario_ptr = Invader::Parser::ParserStruct::parse_hek_tag_file(scenario_data.data(), scenario_data.size());
-            auto &scenario = dynamic_cast<Invader::Parser::Scenario &>(*scenario_ptr);
-            for(auto &child : scenario.child_scenarios) {
-                if(!child.child_scenario.path.empty()) {
-                    archive_it(child.child_scenario.path, child.child_scenario.tag_fourcc);
+            auto scenario = Invader::Parser::Scenario::View::from_hek_tag_file(scenario_data.data(), scenario_data.size());
+            for(auto child : scenario.child_scenarios()) {
+                auto child_scenario = child.child_scenario();
+                if(!child_scenario.path.empty()) {
+                    archive_it(File::remove_duplicate_slashes(std::string(child_scenario.path)), child_scenario.tag_fourcc);
                 }
             }
         }
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__ARCHIVE__ARCHIVE_FORMAT_HPP
+#define INVADER__ARCHIVE__ARCHIVE_FORMAT_HPP
+
+#include <cstring>
+#include <string>
+#include <archive.h>
+
+namespace Invader {
+    struct ArchiveFormat {
+        const char *name;
+        const char *extension;
+        int (*filter)(archive *a);
+        int (*format)(archive *a);
+    };
+
+    static const constexpr ArchiveFormat archive_formats[] = {
+        {"7z", ".7z", nullptr, archive_write_set_format_7zip},
+        {"tar-gz", ".tar.gz", archive_write_add_filter_gzip, archive_write_set_format_pax_restricted},
+        {"tar-xz", ".tar.xz", archive_write_add_filter_xz, archive_write_set_format_pax_restricted},
+        {"tar-zst", ".tar.zst", archive_write_add_filter_zstd, archive_write_set_format_pax_restricted},
+        {"zip", ".zip", nullptr, archive_write_set_format_zip}
+    };
+
+    /**
+     * List the names of all archive formats, separated by commas
+     * @return format names
+     */
+    inline std::string list_archive_formats() {
+        std::string f;
+        for(auto &format : archive_formats) {
+            if(!f.empty()) {
+                f = f + ", ";
+            }
+            f = f + format.name;
+        }
+        return f;
+    }
+
+    /**
+     * List the extensions of all archive formats, separated by commas
+     * @return format extensions
+     */
+    inline std::string list_archive_extensions() {
+        std::string f;
+        for(auto &format : archive_formats) {
+            if(!f.empty()) {
+                f = f + ", ";
+            }
+            f = f + format.extension;
+        }
+        return f;
+    }
+
+    /**
+     * Find the archive format of a file by its extension
+     * @param  path path of the file
+     * @return      format, or nullptr if the extension is not an archive format's
+     */
+    inline const ArchiveFormat *find_archive_format_by_extension(const std::string &path) {
+        for(auto &format : archive_formats) {
+            std::size_t extension_length = std::strlen(format.extension);
+            if(path.size() > extension_length && path.compare(path.size() - extension_length, extension_length, format.extension) == 0) {
+                return &format;
+            }
+        }
+        return nullptr;
+    }
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cstring>
 #include <filesystem>
+#include <algorithm>
 
 #include <invader/build/build_workload.hpp>
 #include <invader/compress/compression.hpp>
@@ -76,6 +77,10 @@ int main(int argc, const char **argv) {
         bool do_not_auto_forge = false;
         bool use_anniverary_mode = false;
         bool use_tags_for_script_source = false;
+        std::size_t thread_count = 1;
+        std::optional<std::filesystem::path> cache_directory;
+        std::optional<std::filesystem::path> profile_path;
+        BuildWorkload::BuildParameters::ProfileFormat profile_format = BuildWorkload::BuildParameters::ProfileFormat::PROFILE_FORMAT_SUMMARY;
     } build_options;
 
     const CommandLineOption options[] = {
@@ -93,21 +98,25 @@ int main(int argc, const char **argv) {
         CommandLineOption("forge-crc", 'C', 1, "Forge the CRC32 value of the map after building it.", "<crc>"),
         CommandLineOption("rename-scenario", 'N', 1, "Rename the scenario.", "<name>"),
         CommandLineOption("level", 'l', 1, "Set the compression level (Xbox maps only). Must be between 0 and 9. Default: 9", "<level>"),
-        CommandLineOption("optimize", 'O', 0, "Optimize tag space. This will drastically increase the amount of time required to build the cache file."),
+        CommandLineOption("optimize", 'O', 0, "Optimize tag space by deduplicating identical tag data."),
         CommandLineOption("hide-pedantic-warnings", 'H', 0, "Don't show minor warnings."),
         CommandLineOption("extend-file-limits", 'E', 0, "Extend file size limits to 2 GiB regardless of if the target engine will support the cache file."),
         CommandLineOption("build-string", 'B', 1, "Set the build string in the header.", "<ver>"),
         CommandLineOption("stock-resource-bounds", 'b', 0, "Only index tags if the tag's index is within stock Custom Edition's resource map bounds. (Custom Edition only)"),
         CommandLineOption("anniversary-mode", 'a', 0, "Enable anniversary graphics and audio (CEA only)"),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for reading and parsing tags, calculating the CRC32, and compressing. If multiple scenarios are given, this is also the number of maps to build at once. This does not change the output. Default: 1", "<count>"),
+        CommandLineOption("cache-dir", 'c', 1, "Reuse compiled tags from previous builds, storing them in the given directory. Tags are recompiled if they or anything they depend on changed. This does not change the output.", "<dir>"),
         CommandLineOption("resource-maps", 'R', 1, "Specify the directory for loading resource maps. (by default this is the maps directory)", "<dir>"),
         CommandLineOption("tag-space", 'T', 1, "Override the tag space. This may result in a map that does not work with the stock games. You can specify the number of bytes, optionally suffixing with K (for KiB) or M (for MiB), or specify in hexadecimal the number of bytes (e.g. 0x1000).", "<size>"),
+        CommandLineOption("profile", 'p', 1, "Write a report of how long each phase of the build took (with CPU time, allocations, and peak memory usage), how long each tag class took, and the slowest tags to the given JSON file. This does not change the output.", "<file>"),
+        CommandLineOption("profile-format", 'F', 1, "Set the format of the report written by --profile. Can be \"summary\" or \"trace\" (Chrome trace event format). Default: summary", "<format>"),
         CommandLineOption("resource-usage", 'r', 1, "Specify the behavior for using resource maps. Must be: none (don't use resource maps), check (check resource maps), always (always index tags in resource maps - Custom Edition only). Default: none", "<usage>")
     };
 
     static constexpr char DESCRIPTION[] = "Build a cache file.";
-    static constexpr char USAGE[] = "[options] -g <target> <scenario>";
+    static constexpr char USAGE[] = "[options] -g <target> <scenario> [<scenario> ...]";
 
-    auto remaining_arguments = CommandLineOption::parse_arguments<BuildOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, build_options, [](char opt, const auto &arguments, auto &build_options) {
+    auto remaining_arguments = CommandLineOption::parse_arguments<BuildOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 65535, build_options, [](char opt, const auto &arguments, auto &build_options) {
         switch(opt) {
             case 'r':
                 if(std::strcmp(arguments[0], "none") == 0) {
@@ -145,6 +154,24 @@ int main(int argc, const char **argv) {
             case 'R':
                 build_options.resource_map_path = std::string(arguments[0]);
                 break;
+            case 'c':
+                build_options.cache_directory = std::string(arguments[0]);
+                break;
+            case 'p':
+                build_options.profile_path = std::string(arguments[0]);
+                break;
+            case 'F':
+                if(std::strcmp(arguments[0], "summary") == 0) {
+                    build_options.profile_format = BuildWorkload::BuildParameters::ProfileFormat::PROFILE_FORMAT_SUMMARY;
+                }
+                else if(std::strcmp(arguments[0], "trace") == 0) {
+                    build_options.profile_format = BuildWorkload::BuildParameters::ProfileFormat::PROFILE_FORMAT_CHROME_TRACE;
+                }
+                else {
+                    eprintf_error("Unknown profile format %s. Use -h for more information.", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
             case 'B':
                 build_options.build_version = std::string(arguments[0]);
                 if(build_options.build_version->size() >= 32) {
@@ -216,6 +243,18 @@ int main(int argc, const char **argv) {
             case 'O':
                 build_options.optimize_space = true;
                 break;
+            case 'j':
+                try {
+                    build_options.thread_count = std::stoul(arguments[0]);
+                    if(build_options.thread_count < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s", arguments[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
             case 'H':
                 build_options.hide_pedantic_warnings = true;
                 break;
@@ -272,26 +311,36 @@ int main(int argc, const char **argv) {
         }
     });
 
-    std::string scenario;
+    std::vector<std::string> scenarios;
 
     // By default, just use tags
     if(build_options.tags.size() == 0) {
         build_options.tags.emplace_back("tags");
     }
 
-    if(build_options.use_filesystem_path) {
-        auto scenario_maybe = Invader::File::file_path_to_tag_path(remaining_arguments[0], build_options.tags);
-        if(scenario_maybe.has_value()) std::printf("%s\n", scenario_maybe->c_str());
-        if(scenario_maybe.has_value() && std::filesystem::exists(remaining_arguments[0])) {
-            scenario = std::filesystem::path(*scenario_maybe).replace_extension().string();
+    for(auto *argument : remaining_arguments) {
+        if(build_options.use_filesystem_path) {
+            auto scenario_maybe = Invader::File::file_path_to_tag_path(argument, build_options.tags);
+            if(scenario_maybe.has_value()) std::printf("%s\n", scenario_maybe->c_str());
+            if(scenario_maybe.has_value() && std::filesystem::exists(argument)) {
+                scenarios.emplace_back(std::filesystem::path(*scenario_maybe).replace_extension().string());
+            }
+            else {
+                eprintf_error("Failed to find a valid tag %s in the tags directory", argument);
+                return EXIT_FAILURE;
+            }
         }
         else {
-            eprintf_error("Failed to find a valid tag %s in the tags directory", remaining_arguments[0]);
-            return EXIT_FAILURE;
+            scenarios.emplace_back(File::halo_path_to_preferred_path(argument));
         }
     }
-    else {
-        scenario = File::halo_path_to_preferred_path(remaining_arguments[0]);
+
+    // These only make sense for one map
+    if(scenarios.size() > 1) {
+        if(build_options.output.has_value() || build_options.rename_scenario.has_value() || build_options.forged_crc.has_value() || !build_options.index.empty() || build_options.profile_path.has_value()) {
+            eprintf_error("--output, --rename-scenario, --forge-crc, --with-index, and --profile can only be used when building one scenario");
+            return EXIT_FAILURE;
+        }
     }
 
     try {
@@ -353,9 +402,12 @@ int main(int argc, const char **argv) {
         parameters.use_tags_for_script_data = build_options.use_tags_for_script_source;
         parameters.tags_directories = build_options.tags;
         parameters.data_directory = build_options.data;
-        parameters.scenario = scenario;
         parameters.rename_scenario = build_options.rename_scenario;
         parameters.optimize_space = build_options.optimize_space;
+        parameters.thread_count = build_options.thread_count;
+        parameters.compile_cache_directory = build_options.cache_directory;
+        parameters.profile_path = build_options.profile_path;
+        parameters.profile_format = build_options.profile_format;
         parameters.forge_crc = build_options.forged_crc;
         parameters.index = with_index;
 
@@ -403,14 +455,13 @@ int main(int argc, const char **argv) {
             bool error = false;
 
             auto try_open = [](const std::filesystem::path &path) {
-                auto file = File::open_file(path);
-                if(!file.has_value()) {
+                try {
+                    return std::make_shared<const ResourceMapView>(ResourceMapView::view_file(path));
+                }
+                catch(FailedToOpenFileException &) {
                     eprintf_error("Failed to open %s", path.string().c_str());
                     std::exit(EXIT_FAILURE);
                 }
-                try {
-                    return load_resource_map(file->data(), file->size());
-                }
                 catch(std::exception &e) {
                     eprintf_error("Failed to read %s: %s", path.string().c_str(), e.what());
                     std::exit(EXIT_FAILURE);
@@ -473,140 +524,156 @@ int main(int argc, const char **argv) {
             parameters.verbosity = BuildWorkload::BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET;
         }
 
-        // Set the map name
-        std::string map_name;
-        if(build_options.rename_scenario) {
-            map_name = *build_options.rename_scenario;
-        }
-        else {
-            map_name = File::base_name(scenario.c_str());
-        }
+        // Set up each map
+        std::vector<BuildWorkload::BuildParameters> all_parameters;
+        std::vector<std::filesystem::path> final_files;
+        all_parameters.reserve(scenarios.size());
+        final_files.reserve(scenarios.size());
+
+        for(auto &scenario : scenarios) {
+            // Set the map name
+            auto &map_parameters = all_parameters.emplace_back(parameters);
+            map_parameters.scenario = scenario;
+            std::string map_name;
+            if(build_options.rename_scenario) {
+                map_name = *build_options.rename_scenario;
+            }
+            else {
+                map_name = File::base_name(scenario.c_str());
+            }
 
-        // CRC32 spoofing, indexing, etc.
-        if(build_options.auto_forge) {
-            if(!parameters.index.has_value()) {
-                switch(engine_info.engine) {
-                    case HEK::GameEngine::GAME_ENGINE_GEARBOX_RETAIL:
-                        parameters.index = retail_indices(map_name.c_str());
-                        break;
-                    case HEK::GameEngine::GAME_ENGINE_GEARBOX_CUSTOM_EDITION:
-                        parameters.index = custom_edition_indices(map_name.c_str());
-
-                        if(!parameters.forge_crc.has_value()) {
-                            if(map_name == "beavercreek") {
-                                parameters.forge_crc = 0x07B3876A;
-                            }
-                            else if(map_name == "bloodgulch") {
-                                parameters.forge_crc = 0x7B309554;
-                            }
-                            else if(map_name == "boardingaction") {
-                                parameters.forge_crc = 0xF4DEEF94;
-                            }
-                            else if(map_name == "carousel") {
-                                parameters.forge_crc = 0x9C301A08;
+            // CRC32 spoofing, indexing, etc.
+            if(build_options.auto_forge) {
+                if(!map_parameters.index.has_value()) {
+                    switch(engine_info.engine) {
+                        case HEK::GameEngine::GAME_ENGINE_GEARBOX_RETAIL:
+                            map_parameters.index = retail_indices(map_name.c_str());
+                            break;
+                        case HEK::GameEngine::GAME_ENGINE_GEARBOX_CUSTOM_EDITION:
+                            map_parameters.index = custom_edition_indices(map_name.c_str());
+
+                            if(!map_parameters.forge_crc.has_value()) {
+                                if(map_name == "beavercreek") {
+                                    map_parameters.forge_crc = 0x07B3876A;
+                                }
+                                else if(map_name == "bloodgulch") {
+                                    map_parameters.forge_crc = 0x7B309554;
+                                }
+                                else if(map_name == "boardingaction") {
+                                    map_parameters.forge_crc = 0xF4DEEF94;
+                                }
+                                else if(map_name == "carousel") {
+                                    map_parameters.forge_crc = 0x9C301A08;
+                                }
+                                else if(map_name == "chillout") {
+                                    map_parameters.forge_crc = 0x93C53C27;
+                                }
+                                else if(map_name == "damnation") {
+                                    map_parameters.forge_crc = 0x0FBA059D;
+                                }
+                                else if(map_name == "dangercanyon") {
+                                    map_parameters.forge_crc = 0xC410CD74;
+                                }
+                                else if(map_name == "deathisland") {
+                                    map_parameters.forge_crc = 0x1DF8C97F;
+                                }
+                                else if(map_name == "gephyrophobia") {
+                                    map_parameters.forge_crc = 0xD2872165;
+                                }
+                                else if(map_name == "hangemhigh") {
+                                    map_parameters.forge_crc = 0xA7C8B9C6;
+                                }
+                                else if(map_name == "icefields") {
+                                    map_parameters.forge_crc = 0x5EC1DEB7;
+                                }
+                                else if(map_name == "infinity") {
+                                    map_parameters.forge_crc = 0x0E7F7FE7;
+                                }
+                                else if(map_name == "longest") {
+                                    map_parameters.forge_crc = 0xC8F48FF6;
+                                }
+                                else if(map_name == "prisoner") {
+                                    map_parameters.forge_crc = 0x43B81A8B;
+                                }
+                                else if(map_name == "putput") {
+                                    map_parameters.forge_crc = 0xAF2F0B84;
+                                }
+                                else if(map_name == "ratrace") {
+                                    map_parameters.forge_crc = 0xF7F8E14C;
+                                }
+                                else if(map_name == "sidewinder") {
+                                    map_parameters.forge_crc = 0xBD95CF55;
+                                }
+                                else if(map_name == "timberland") {
+                                    map_parameters.forge_crc = 0x54446470;
+                                }
+                                else if(map_name == "wizard") {
+                                    map_parameters.forge_crc = 0xCF3359B1;
+                                }
                             }
-                            else if(map_name == "chillout") {
-                                parameters.forge_crc = 0x93C53C27;
-                            }
-                            else if(map_name == "damnation") {
-                                parameters.forge_crc = 0x0FBA059D;
-                            }
-                            else if(map_name == "dangercanyon") {
-                                parameters.forge_crc = 0xC410CD74;
-                            }
-                            else if(map_name == "deathisland") {
-                                parameters.forge_crc = 0x1DF8C97F;
-                            }
-                            else if(map_name == "gephyrophobia") {
-                                parameters.forge_crc = 0xD2872165;
-                            }
-                            else if(map_name == "hangemhigh") {
-                                parameters.forge_crc = 0xA7C8B9C6;
-                            }
-                            else if(map_name == "icefields") {
-                                parameters.forge_crc = 0x5EC1DEB7;
-                            }
-                            else if(map_name == "infinity") {
-                                parameters.forge_crc = 0x0E7F7FE7;
-                            }
-                            else if(map_name == "longest") {
-                                parameters.forge_crc = 0xC8F48FF6;
-                            }
-                            else if(map_name == "prisoner") {
-                                parameters.forge_crc = 0x43B81A8B;
-                            }
-                            else if(map_name == "putput") {
-                                parameters.forge_crc = 0xAF2F0B84;
-                            }
-                            else if(map_name == "ratrace") {
-                                parameters.forge_crc = 0xF7F8E14C;
-                            }
-                            else if(map_name == "sidewinder") {
-                                parameters.forge_crc = 0xBD95CF55;
-                            }
-                            else if(map_name == "timberland") {
-                                parameters.forge_crc = 0x54446470;
-                            }
-                            else if(map_name == "wizard") {
-                                parameters.forge_crc = 0xCF3359B1;
-                            }
-                        }
 
-                        break;
-                    case HEK::GameEngine::GAME_ENGINE_GEARBOX_DEMO:
-                        parameters.index = demo_indices(map_name.c_str());
-                        break;
-                    case HEK::GameEngine::GAME_ENGINE_MCC_COMBAT_EVOLVED_ANNIVERSARY:
-                        parameters.index = mcc_cea_indices(map_name.c_str());
-                        break;
-                    default: break;
+                            break;
+                        case HEK::GameEngine::GAME_ENGINE_GEARBOX_DEMO:
+                            map_parameters.index = demo_indices(map_name.c_str());
+                            break;
+                        case HEK::GameEngine::GAME_ENGINE_MCC_COMBAT_EVOLVED_ANNIVERSARY:
+                            map_parameters.index = mcc_cea_indices(map_name.c_str());
+                            break;
+                        default: break;
+                    }
                 }
             }
-        }
 
-        // Build!
-        auto map = Invader::BuildWorkload::compile_map(parameters);
-
-        static const char MAP_EXTENSION[] = ".map";
-        auto map_name_with_extension = std::string(map_name) + MAP_EXTENSION;
-
-        // Format path to maps/map_name.map if output not specified
-        std::filesystem::path final_file;
-        if(!build_options.output.has_value()) {
-            final_file = std::filesystem::path(build_options.maps) / map_name_with_extension;
-        }
-        else {
-            final_file = *build_options.output;
-            auto final_file_name_no_extension = final_file.filename().replace_extension();
-            auto final_file_name_no_extension_string = final_file_name_no_extension.string();
+            static const char MAP_EXTENSION[] = ".map";
+            auto map_name_with_extension = std::string(map_name) + MAP_EXTENSION;
 
-            // If it's not a .map, warn
-            if(final_file.extension() != MAP_EXTENSION) {
-                eprintf_warn("The base file extension is not \"%s\" which is required by the target engine", MAP_EXTENSION);
+            // Format path to maps/map_name.map if output not specified
+            auto &final_file = final_files.emplace_back();
+            if(!build_options.output.has_value()) {
+                final_file = std::filesystem::path(build_options.maps) / map_name_with_extension;
             }
+            else {
+                final_file = *build_options.output;
+                auto final_file_name_no_extension = final_file.filename().replace_extension();
+                auto final_file_name_no_extension_string = final_file_name_no_extension.string();
+
+                // If it's not a .map, warn
+                if(final_file.extension() != MAP_EXTENSION) {
+                    eprintf_warn("The base file extension is not \"%s\" which is required by the target engine", MAP_EXTENSION);
+                }
 
-            // If we are not building for MCC and the scenario name is mismatched, warn
-            if(final_file_name_no_extension_string != map_name && engine_info.scenario_name_and_file_name_must_be_equal) {
-                eprintf_warn("The base name (%s) does not match the scenario (%s)", final_file_name_no_extension_string.c_str(), map_name.c_str());
-                eprintf_warn("The map will fail to load correctly in the target engine with this file name.");
+                // If we are not building for MCC and the scenario name is mismatched, warn
+                if(final_file_name_no_extension_string != map_name && engine_info.scenario_name_and_file_name_must_be_equal) {
+                    eprintf_warn("The base name (%s) does not match the scenario (%s)", final_file_name_no_extension_string.c_str(), map_name.c_str());
+                    eprintf_warn("The map will fail to load correctly in the target engine with this file name.");
 
-                bool incorrect_case = false;
-                for(char &c : final_file_name_no_extension_string) {
-                    if(std::tolower(c) != c) {
-                        incorrect_case = true;
-                        break;
+                    bool incorrect_case = false;
+                    for(char &c : final_file_name_no_extension_string) {
+                        if(std::tolower(c) != c) {
+                            incorrect_case = true;
+                            break;
+                        }
+                    }
+                    if(!incorrect_case) {
+                        eprintf_warn("Did you intend to use --rename-scenario \"%s\"", final_file_name_no_extension_string.c_str());
                     }
-                }
-                if(!incorrect_case) {
-                    eprintf_warn("Did you intend to use --rename-scenario \"%s\"", final_file_name_no_extension_string.c_str());
                 }
             }
         }
 
-        // Save the file
-        if(!File::save_file(final_file, map)) {
-            eprintf_error("Failed to save %s", final_file.string().c_str());
-            return EXIT_FAILURE;
+        // Build!
+        if(all_parameters.size() == 1) {
+            Invader::BuildWorkload::compile_map(all_parameters[0], final_files[0]);
+        }
+        else {
+            // Each map reads its tags on its share of the threads
+            std::size_t map_threads = std::min(build_options.thread_count, all_parameters.size());
+            for(auto &p : all_parameters) {
+                p.thread_count = build_options.thread_count / map_threads;
+            }
+            if(Invader::BuildWorkload::compile_maps(all_parameters, final_files, map_threads) > 0) {
+                return EXIT_FAILURE;
+            }
         }
 
         return EXIT_SUCCESS;
@@ -8,7 +8,6 @@
 #include <invader/file/file.hpp>
 #include <invader/tag/hek/header.hpp>
 #include <invader/version.hpp>
-#include <invader/crc/hek/crc.hpp>
 #include <invader/compress/compression.hpp>
 #include <invader/tag/index/index.hpp>
 #include <invader/tag/parser/compile/scenario_structure_bsp.hpp>
@@ -51,35 +50,72 @@ namespace Invader {
 
     BuildWorkload::BuildWorkload() : ErrorHandler() {}
 
+    void *BuildWorkload::BuildWorkloadArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+        this->allocations++;
+        return this->pool.allocate(bytes, alignment);
+    }
+
+    void BuildWorkload::BuildWorkloadArena::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+        this->pool.deallocate(p, bytes, alignment);
+    }
+
+    bool BuildWorkload::BuildWorkloadArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+
+    void *BuildWorkload::BuildWorkloadArena::CountingResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+        this->blocks++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void BuildWorkload::BuildWorkloadArena::CountingResource::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool BuildWorkload::BuildWorkloadArena::CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        return this == &other;
+    }
+
     std::vector<std::byte> BuildWorkload::compile_map(const BuildParameters &parameters) {
         BuildWorkload workload;
         workload.parameters = &parameters;
+        return workload.build_cache_file();
+    }
 
+    void BuildWorkload::compile_map(const BuildParameters &parameters, const std::filesystem::path &output) {
+        BuildWorkload workload;
+        workload.parameters = &parameters;
+        workload.output_path = &output;
+        workload.build_cache_file();
+    }
+
+    #define BYTES_TO_MiB(bytes) (bytes / 1024.0 / 1024.0)
+
+    std::vector<std::byte> BuildWorkload::build_cache_file() {
         // Start benchmark
-        workload.start = std::chrono::steady_clock::now();
+        this->start = std::chrono::steady_clock::now();
 
         // Hide these?
-        switch(parameters.verbosity) {
+        switch(this->parameters->verbosity) {
             case BuildParameters::BuildVerbosity::BUILD_VERBOSITY_SHOW_ALL:
                 break;
             case BuildParameters::BuildVerbosity::BUILD_VERBOSITY_HIDE_PEDANTIC:
-                workload.set_reporting_level(REPORTING_LEVEL_HIDE_ALL_PEDANTIC_WARNINGS);
+                this->set_reporting_level(REPORTING_LEVEL_HIDE_ALL_PEDANTIC_WARNINGS);
                 break;
             case BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET:
             case BuildParameters::BuildVerbosity::BUILD_VERBOSITY_HIDE_WARNINGS:
-                workload.set_reporting_level(REPORTING_LEVEL_HIDE_ALL_WARNINGS);
+                this->set_reporting_level(REPORTING_LEVEL_HIDE_ALL_WARNINGS);
                 break;
             case BuildParameters::BuildVerbosity::BUILD_VERBOSITY_HIDE_ERRORS:
-                workload.set_reporting_level(REPORTING_LEVEL_HIDE_EVERYTHING);
+                this->set_reporting_level(REPORTING_LEVEL_HIDE_EVERYTHING);
                 break;
         }
 
-        return workload.build_cache_file();
-    }
-
-    #define BYTES_TO_MiB(bytes) (bytes / 1024.0 / 1024.0)
+        // Start profiling if needed
+        if(this->parameters->profile_path.has_value()) {
+            this->profile_begin();
+        }
 
-    std::vector<std::byte> BuildWorkload::build_cache_file() {
         // Yay
         File::check_working_directory("./toolbeta.map");
         auto cache_version = this->parameters->details.build_cache_file_engine;
@@ -103,12 +139,14 @@ namespace Invader {
             auto &tag_paths = this->get_tag_paths();
             this->tags.reserve(index.size());
             tag_paths.reserve(index.size());
+            this->tag_path_index.reserve(index.size());
             for(auto &i : index) {
                 auto &tag = this->tags.emplace_back();
                 tag_paths.emplace_back(i);
                 tag.path = i.path;
                 tag.tag_fourcc = i.fourcc;
                 tag.stubbed = true;
+                this->index_tag(this->tags.size() - 1);
             }
         }
 
@@ -118,21 +156,35 @@ namespace Invader {
         TAG_ARRAY_STRUCT.unsafe_to_dedupe = true;
 
         // Add all of the tags
-        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !this->output_mutex) {
             oprintf("Reading tags...\n");
         }
+        if(this->parameters->compile_cache_directory.has_value() || this->shared_cache) {
+            this->compile_cache_begin();
+        }
+        if(this->parameters->thread_count > 1) {
+            auto phase = this->profile_begin_phase("read tags");
+            this->preload_tags();
+            this->profile_end_phase(phase);
+        }
+        auto compile_phase = this->profile_begin_phase("compile tags");
         this->add_tags();
 
         // Check this stuff
         this->check_hud_text_indices();
+        this->profile_end_phase(compile_phase);
 
         // If we have resource maps to check, check them
         if(this->parameters->details.build_raw_data_handling != BuildParameters::BuildParametersDetails::RawDataHandling::RAW_DATA_HANDLING_RETAIN_ALL) {
+            auto phase = this->profile_begin_phase("externalize tags");
             this->externalize_tags();
+            this->profile_end_phase(phase);
         }
 
         // Generate the tag array
+        auto tag_array_phase = this->profile_begin_phase("generate tag array");
         this->generate_tag_array();
+        this->profile_end_phase(tag_array_phase);
 
         // Set the scenario tag thingy
         auto make_tag_data_header_struct = [](std::size_t scenario_index, auto &structs, auto size) {
@@ -180,16 +232,20 @@ namespace Invader {
 
         // Dedupe structs
         if(this->parameters->optimize_space) {
+            auto phase = this->profile_begin_phase("dedupe structs");
             this->dedupe_structs();
+            this->profile_end_phase(phase);
         }
 
         // Get the tag data
-        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !this->output_mutex) {
             oprintf("Building tag data...");
             oflush();
         }
+        auto tag_data_phase = this->profile_begin_phase("generate tag data");
         std::size_t end_of_bsps = this->generate_tag_data();
-        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+        this->profile_end_phase(tag_data_phase);
+        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !this->output_mutex) {
             oprintf(" done\n");
         }
 
@@ -225,12 +281,14 @@ namespace Invader {
         }
 
         // Get the bitmap and sound data in there
-        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !this->output_mutex) {
             oprintf("Building raw data...");
             oflush();
         }
+        auto raw_data_phase = this->profile_begin_phase("generate bitmap sound data");
         this->generate_bitmap_sound_data(end_of_bsps);
-        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+        this->profile_end_phase(raw_data_phase);
+        if(this->parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !this->output_mutex) {
             oprintf(" done\n");
         }
 
@@ -252,31 +310,41 @@ namespace Invader {
             header.map_type = *workload.cache_file_type;
             header.name = workload.scenario_name;
 
-            if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+            if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                 oprintf("Building cache file data...");
                 oflush();
             }
 
+            // Lay out everything where it will go in the file. Nothing is copied until it is written.
+            std::vector<CacheFileSection> sections;
+            std::byte header_data[sizeof(HEK::CacheFileHeader)] = {};
+            std::size_t file_size = 0;
+            auto add_section = [&sections, &file_size](const void *data, std::size_t size) {
+                if(size > 0) {
+                    sections.emplace_back(CacheFileSection { file_size, reinterpret_cast<const std::byte *>(data), size });
+                }
+                file_size += size;
+            };
+            static_assert(sizeof(header) == sizeof(header_data));
+
             // Add header stuff
-            final_data.resize(sizeof(HEK::CacheFileHeader));
+            add_section(header_data, sizeof(header_data));
 
             // Add each BSP data thing
             for(auto &b : workload.bsp_data) {
-                final_data.insert(final_data.end(), b.begin(), b.end());
+                add_section(b.data(), b.size());
             }
 
             // Go through each BSP and add that stuff
             if(cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
                 for(std::size_t b = 0; b < workload.bsp_count; b++) {
-                    final_data.insert(final_data.end(), workload.map_data_structs[b + 1].begin(), workload.map_data_structs[b + 1].end());
+                    add_section(workload.map_data_structs[b + 1].data(), workload.map_data_structs[b + 1].size());
                 }
             }
-            workload.map_data_structs.resize(1);
 
             // Now add all the raw data
-            final_data.insert(final_data.end(), workload.all_raw_data.begin(), workload.all_raw_data.end());
+            add_section(workload.all_raw_data.data(), workload.all_raw_data.size());
             auto raw_data_size = workload.all_raw_data.size();
-            workload.all_raw_data = std::vector<std::byte>();
 
             std::size_t model_data_size;
             std::size_t vertex_size;
@@ -286,17 +354,15 @@ namespace Invader {
             // If we're not on Xbox, we put the model data here
             if(cache_version != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
                 // Let's get the model data there
-                model_offset = final_data.size() + REQUIRED_PADDING_32_BIT(final_data.size());
-                final_data.resize(model_offset, std::byte());
-                final_data.insert(final_data.end(), reinterpret_cast<std::byte *>(workload.uncompressed_model_vertices.data()), reinterpret_cast<std::byte *>(workload.uncompressed_model_vertices.data() + workload.uncompressed_model_vertices.size()));
+                model_offset = file_size + REQUIRED_PADDING_32_BIT(file_size);
+                file_size = model_offset;
+                vertex_size = workload.uncompressed_model_vertices.size() * sizeof(*workload.uncompressed_model_vertices.data());
+                add_section(workload.uncompressed_model_vertices.data(), vertex_size);
 
                 // Now add model indices
-                vertex_size = workload.uncompressed_model_vertices.size() * sizeof(*workload.uncompressed_model_vertices.data());
-                final_data.insert(final_data.end(), reinterpret_cast<std::byte *>(workload.model_indices.data()), reinterpret_cast<std::byte *>(workload.model_indices.data() + workload.model_indices.size()));
-                workload.uncompressed_model_vertices = decltype(workload.uncompressed_model_vertices)();
-                workload.model_indices = decltype(workload.model_indices)();
+                add_section(workload.model_indices.data(), workload.model_indices.size() * sizeof(*workload.model_indices.data()));
 
-                tag_data_offset = final_data.size() + REQUIRED_PADDING_32_BIT(final_data.size());
+                tag_data_offset = file_size + REQUIRED_PADDING_32_BIT(file_size);
                 model_data_size = tag_data_offset - model_offset;
             }
 
@@ -305,18 +371,19 @@ namespace Invader {
                 vertex_size = workload.compressed_model_vertices.size() * sizeof(*workload.compressed_model_vertices.data());
                 model_data_size = vertex_size + workload.model_indices.size() * sizeof(*workload.model_indices.data());
                 model_offset = 0;
-                tag_data_offset = final_data.size() + REQUIRED_PADDING_N_BYTES(final_data.size(), HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE);
+                tag_data_offset = file_size + REQUIRED_PADDING_N_BYTES(file_size, HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE);
             }
 
             // We're almost there
-            final_data.resize(tag_data_offset, std::byte());
+            file_size = tag_data_offset;
 
             // Add tag data
-            std::size_t tag_data_size = workload.map_data_structs[0].size();
-            final_data.insert(final_data.end(), workload.map_data_structs[0].begin(), workload.map_data_structs[0].end());
+            auto &tag_data = workload.map_data_structs[0];
+            std::size_t tag_data_size = tag_data.size();
+            add_section(tag_data.data(), tag_data_size);
             auto part_count = workload.model_parts.size();
             if(cache_version == HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
-                auto &tag_data_struct = *reinterpret_cast<HEK::NativeCacheFileTagDataHeader *>(final_data.data() + tag_data_offset);
+                auto &tag_data_struct = *reinterpret_cast<HEK::NativeCacheFileTagDataHeader *>(tag_data.data());
                 tag_data_struct.tag_count = static_cast<std::uint32_t>(workload.tags.size());
                 tag_data_struct.tags_literal = CacheFileLiteral::CACHE_FILE_TAGS;
                 tag_data_struct.model_part_count = static_cast<std::uint32_t>(part_count);
@@ -326,14 +393,14 @@ namespace Invader {
                 tag_data_struct.raw_data_indices = workload.raw_data_indices_offset;
             }
             else if(cache_version == HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-                auto &tag_data_struct = *reinterpret_cast<HEK::CacheFileTagDataHeaderXbox *>(final_data.data() + tag_data_offset);
+                auto &tag_data_struct = *reinterpret_cast<HEK::CacheFileTagDataHeaderXbox *>(tag_data.data());
                 tag_data_struct.tag_count = static_cast<std::uint32_t>(workload.tags.size());
                 tag_data_struct.tags_literal = CacheFileLiteral::CACHE_FILE_TAGS;
                 tag_data_struct.model_part_count = static_cast<std::uint32_t>(part_count);
                 tag_data_struct.model_part_count_again = static_cast<std::uint32_t>(part_count);
             }
             else {
-                auto &tag_data_struct = *reinterpret_cast<HEK::CacheFileTagDataHeaderPC *>(final_data.data() + tag_data_offset);
+                auto &tag_data_struct = *reinterpret_cast<HEK::CacheFileTagDataHeaderPC *>(tag_data.data());
                 tag_data_struct.tag_count = static_cast<std::uint32_t>(workload.tags.size());
                 tag_data_struct.tags_literal = CacheFileLiteral::CACHE_FILE_TAGS;
                 tag_data_struct.model_part_count = static_cast<std::uint32_t>(part_count);
@@ -349,25 +416,23 @@ namespace Invader {
             if(cache_version == HEK::CacheFileEngine::CACHE_FILE_DEMO) {
                 header.head_literal = CacheFileLiteral::CACHE_FILE_HEAD_DEMO;
                 header.foot_literal = CacheFileLiteral::CACHE_FILE_FOOT_DEMO;
-                *reinterpret_cast<HEK::CacheFileDemoHeader *>(final_data.data()) = *reinterpret_cast<HEK::CacheFileHeader *>(&header);
             }
             else {
                 header.head_literal = CacheFileLiteral::CACHE_FILE_HEAD;
                 header.foot_literal = CacheFileLiteral::CACHE_FILE_FOOT;
-                std::memcpy(final_data.data(), &header, sizeof(header));
             }
 
-            if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+            if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                 oprintf(" done\n");
             }
 
             // Resize to ye ol' sector
             if(cache_version == HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-                final_data.insert(final_data.end(), REQUIRED_PADDING_N_BYTES(final_data.size(), HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE), std::byte());
+                file_size += REQUIRED_PADDING_N_BYTES(file_size, HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE);
             }
 
             // Check to make sure we aren't too big
-            std::size_t uncompressed_size = final_data.size();
+            std::size_t uncompressed_size = file_size;
             if(static_cast<std::uint64_t>(uncompressed_size) > max_size) {
                 REPORT_ERROR_PRINTF(workload, ERROR_TYPE_FATAL_ERROR, std::nullopt, "Map file exceeds maximum size for the target engine when uncompressed (%.04f MiB > %.04f MiB)", BYTES_TO_MiB(uncompressed_size), BYTES_TO_MiB(static_cast<std::size_t>(max_size)));
                 throw MaximumFileSizeException();
@@ -384,31 +449,25 @@ namespace Invader {
             }
 
             // Hold this here, of course
-            auto &tag_file_checksums = reinterpret_cast<HEK::CacheFileTagDataHeader *>(final_data.data() + tag_data_offset)->tag_file_checksums;
-            tag_file_checksums = workload.tag_file_checksums;
+            reinterpret_cast<HEK::CacheFileTagDataHeader *>(tag_data.data())->tag_file_checksums = workload.tag_file_checksums;
 
             // If we can calculate the CRC32, do it
             std::uint32_t new_crc = 0;
             bool can_calculate_crc = cache_version != CacheFileEngine::CACHE_FILE_XBOX;
 
             if(can_calculate_crc) {
-                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                     oprintf("Calculating CRC32...");
                     oflush();
                 }
 
                 // Calculate the CRC32 and/or forge one if we must
-                if(workload.parameters->forge_crc.has_value()) {
-                    std::uint32_t checksum_delta = 0;
-                    new_crc = calculate_map_crc(final_data.data(), final_data.size(), &workload.parameters->forge_crc.value(), &checksum_delta);
-                    tag_file_checksums = checksum_delta;
-                }
-                else {
-                    new_crc = calculate_map_crc(final_data.data(), final_data.size());
-                }
+                auto phase = workload.profile_begin_phase("calculate crc32");
+                new_crc = workload.calculate_cache_file_crc(sections, file_size, model_offset, model_data_size, tag_data_offset, tag_data_size);
+                workload.profile_end_phase(phase);
 
                 header.crc32 = new_crc;
-                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                     oprintf(" done\n");
                 }
             }
@@ -417,30 +476,65 @@ namespace Invader {
             }
 
             // Set the file size
-            header.decompressed_file_size = final_data.size();
+            header.decompressed_file_size = file_size;
 
-            // Copy it again, this time with the new CRC32
+            // Now that the header is done, put it in
             if(cache_version == HEK::CacheFileEngine::CACHE_FILE_DEMO) {
-                *reinterpret_cast<HEK::CacheFileDemoHeader *>(final_data.data()) = *reinterpret_cast<HEK::CacheFileHeader *>(&header);
+                *reinterpret_cast<HEK::CacheFileDemoHeader *>(header_data) = *reinterpret_cast<HEK::CacheFileHeader *>(&header);
             }
             else {
-                std::memcpy(final_data.data(), &header, sizeof(header));
+                std::memcpy(header_data, &header, sizeof(header));
             }
 
             // Compress if needed
+            std::size_t compressed_size = 0;
             if(workload.parameters->details.build_compress) {
-                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+                final_data = assemble_cache_file(sections, file_size);
+                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                     oprintf("Compressing...");
                     oflush();
                 }
-                final_data = Compression::compress_map_data(final_data.data(), final_data.size(), workload.parameters->details.build_compression_level.value_or(19));
-                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+                auto compress_phase = workload.profile_begin_phase("compress");
+                auto compression_level = workload.parameters->details.build_compression_level.value_or(19);
+
+                // If we're writing to a file, compress straight into it
+                if(workload.output_path) {
+                    compressed_size = Compression::compress_map_file(final_data.data(), final_data.size(), *workload.output_path, compression_level, workload.parameters->thread_count);
+                    final_data = std::vector<std::byte>();
+                }
+                else {
+                    final_data = Compression::compress_map_data(final_data.data(), final_data.size(), compression_level, workload.parameters->thread_count);
+                    compressed_size = final_data.size();
+                }
+                workload.profile_end_phase(compress_phase);
+                if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET && !workload.output_mutex) {
                     oprintf(" done\n");
                 }
             }
 
-            // Display the scenario name and information
+            // Otherwise, write it straight out if we can; we don't need to hold a copy of the whole thing in memory
+            else if(workload.output_path) {
+                auto phase = workload.profile_begin_phase("write cache file");
+                save_cache_file(*workload.output_path, sections, file_size);
+                workload.profile_end_phase(phase);
+            }
+            else {
+                final_data = assemble_cache_file(sections, file_size);
+            }
+
+            // Free everything we don't need anymore
+            workload.map_data_structs.resize(1);
+            workload.all_raw_data = std::vector<std::byte>();
+            workload.uncompressed_model_vertices = decltype(workload.uncompressed_model_vertices)();
+            workload.model_indices = decltype(workload.model_indices)();
+
+            // Display the scenario name and information (all at once if other maps are being built at the same time)
             if(workload.parameters->verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET) {
+                std::unique_lock<std::mutex> output_lock;
+                if(workload.output_mutex) {
+                    output_lock = std::unique_lock<std::mutex>(*workload.output_mutex);
+                }
+
                 auto warnings = workload.get_warnings();
                 if(warnings) {
                     oprintf_success_warn("Built successfully with %zu warning%s", warnings, warnings == 1 ? "" : "s");
@@ -518,6 +612,10 @@ namespace Invader {
                 // Show some other data that might be useful
                 oprintf("Models:            %zu (%.02f MiB)\n", part_count, BYTES_TO_MiB(model_data_size));
                 oprintf("Raw data:          %.02f MiB (%.02f MiB bitmaps, %.02f MiB sounds)\n", BYTES_TO_MiB(raw_data_size), BYTES_TO_MiB(workload.raw_bitmap_size), BYTES_TO_MiB(workload.raw_sound_size));
+                oprintf("Allocations:       %zu struct allocations in %zu blocks\n", workload.struct_arena->get_allocations(), workload.struct_arena->get_blocks());
+                if(workload.compile_cache) {
+                    oprintf("Compile cache:     %zu / %zu tags reused\n", workload.compile_cache_reused, workload.compile_cache_reused + workload.compile_cache_compiled);
+                }
 
                 // Show our CRC32
                 if(can_calculate_crc) {
@@ -526,7 +624,6 @@ namespace Invader {
 
                 // If we compressed it, how small did we get it?
                 if(workload.parameters->details.build_compress) {
-                    std::size_t compressed_size = final_data.size();
                     oprintf("Compressed size:   %.02f MiB (%.02f %%)\n", BYTES_TO_MiB(compressed_size), 100.0 * compressed_size / uncompressed_size);
                 }
 
@@ -554,6 +651,7 @@ namespace Invader {
                 oprintf("\n");
             }
 
+            workload.profile_save();
             return final_data;
         };
 
@@ -581,12 +679,26 @@ namespace Invader {
         }
     }
 
+    template <typename T> static const T *preloaded_tag_struct(BuildWorkload::BuildWorkloadPreloadedTag *preloaded) noexcept {
+        return preloaded ? dynamic_cast<const T *>(preloaded->parsed.get()) : nullptr;
+    }
+
     void BuildWorkload::compile_tag_data_recursively(const std::byte *tag_data, std::size_t tag_data_size, std::size_t tag_index, std::optional<TagFourCC> tag_fourcc) {
+        this->compile_tag_data_recursively(tag_data, tag_data_size, tag_index, tag_fourcc, nullptr);
+    }
+
+    void BuildWorkload::compile_tag_data_recursively(const std::byte *tag_data, std::size_t tag_data_size, std::size_t tag_index, std::optional<TagFourCC> tag_fourcc, BuildWorkloadPreloadedTag *preloaded) {
         #define COMPILE_TAG_CLASS(class_struct, fourcc) case TagFourCC::fourcc: { \
-            do_compile_tag(std::move(Parser::class_struct::parse_hek_tag_file(tag_data, tag_data_size, true))); \
+            if(auto *preloaded_struct = preloaded_tag_struct<Parser::class_struct>(preloaded)) { \
+                do_compile_tag(*preloaded_struct); \
+            } \
+            else { \
+                do_compile_tag(parse_tag([&]() { return Parser::class_struct::parse_hek_tag_file(tag_data, tag_data_size, true); })); \
+            } \
             break; \
         }
 
+        // Preloaded tags were already validated, and their tag data is no longer held
         auto *header = reinterpret_cast<const HEK::TagFileHeader *>(tag_data);
 
         if(!tag_fourcc.has_value()) {
@@ -594,7 +706,11 @@ namespace Invader {
         }
 
         // Set this in case it's not set yet
-        this->tags[tag_index].tag_fourcc = *tag_fourcc;
+        if(this->tags[tag_index].tag_fourcc != *tag_fourcc) {
+            this->unindex_tag(tag_index);
+            this->tags[tag_index].tag_fourcc = *tag_fourcc;
+            this->index_tag(tag_index);
+        }
 
         // Make sure the path isn't bullshit
         bool invalid_path = false;
@@ -637,9 +753,17 @@ namespace Invader {
         }
 
         // Check header and CRC32
-        HEK::TagFileHeader::validate_header(header, tag_data_size, tag_fourcc);
-        HEK::BigEndian<std::uint32_t> expected_crc = ~crc32(0, header + 1, tag_data_size - sizeof(*header));
-        std::uint32_t header_crc = header->crc32;
+        HEK::BigEndian<std::uint32_t> expected_crc;
+        std::uint32_t header_crc;
+        if(preloaded) {
+            expected_crc = preloaded->calculated_crc;
+            header_crc = preloaded->header_crc;
+        }
+        else {
+            HEK::TagFileHeader::validate_header(header, tag_data_size, tag_fourcc);
+            expected_crc = ~crc32(0, header + 1, tag_data_size - sizeof(*header));
+            header_crc = header->crc32;
+        }
 
         // Make sure the header's CRC32 matches the calculated CRC32 (but only if the header CRC is not 0xFFFFFFFF since some stock tags have this)
         if(header_crc != 0xFFFFFFFF && expected_crc != header_crc) {
@@ -662,6 +786,17 @@ namespace Invader {
             new_tag_struct.compile(workload, tag_index, &new_struct - structs.data());
         };
 
+        // Time parsing for the profile
+        if(preloaded) {
+            this->profile_tag_parsed(preloaded->parse_time, true);
+        }
+        auto parse_tag = [this](auto parse) {
+            auto parse_start = std::chrono::steady_clock::now();
+            auto parsed = parse();
+            this->profile_tag_parsed(std::chrono::steady_clock::now() - parse_start, false);
+            return parsed;
+        };
+
         switch(*tag_fourcc) {
             COMPILE_TAG_CLASS(Actor, TAG_FOURCC_ACTOR)
             COMPILE_TAG_CLASS(ActorVariant, TAG_FOURCC_ACTOR_VARIANT)
@@ -750,7 +885,8 @@ namespace Invader {
             // And, of course, BSP tags
             case TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP: {
                 // First thing's first - parse the tag data
-                auto tag_data_parsed = Parser::ScenarioStructureBSP::parse_hek_tag_file(tag_data, tag_data_size, true);
+                auto *preloaded_bsp = preloaded_tag_struct<Parser::ScenarioStructureBSP>(preloaded);
+                auto tag_data_parsed = preloaded_bsp ? *preloaded_bsp : parse_tag([&]() { return Parser::ScenarioStructureBSP::parse_hek_tag_file(tag_data, tag_data_size, true); });
                 std::size_t bsp = this->bsp_count++;
 
                 auto cache_version = this->parameters->details.build_cache_file_engine;
@@ -811,6 +947,28 @@ namespace Invader {
     }
 
     std::size_t BuildWorkload::compile_tag_recursively(const char *tag_path, TagFourCC tag_fourcc) {
+        if(!this->compile_cache) {
+            return this->find_or_compile_tag(tag_path, tag_fourcc);
+        }
+
+        // Let the compile cache know which tags were depended on and where
+        this->compile_cache_pause_recording();
+        auto tag_index = this->find_or_compile_tag(tag_path, tag_fourcc);
+        this->compile_cache_resume_recording(tag_path, tag_fourcc, tag_index);
+        return tag_index;
+    }
+
+    void BuildWorkload::index_tag(std::size_t tag_index) {
+        auto &tag = this->tags[tag_index];
+        this->tag_path_index.insert(tag.path, tag.tag_fourcc, tag_index);
+    }
+
+    void BuildWorkload::unindex_tag(std::size_t tag_index) noexcept {
+        auto &tag = this->tags[tag_index];
+        this->tag_path_index.erase(tag.path, tag.tag_fourcc, tag_index);
+    }
+
+    std::size_t BuildWorkload::find_or_compile_tag(const char *tag_path, TagFourCC tag_fourcc) {
         // Remove duplicate slashes
         auto fixed_path = Invader::File::remove_duplicate_slashes(tag_path);
         tag_path = fixed_path.c_str();
@@ -829,20 +987,24 @@ namespace Invader {
             renamed_path = std::string(first_char, last_slash - first_char) + this->scenario_name.string;
         }
 
-        // Search for the tag
+        // Search for the tag, taking whichever came first if it's there under both its path and its renamed path
         std::size_t return_value = this->tags.size();
         bool found = false;
-        for(std::size_t i = 0; i < return_value; i++) {
-            auto &tag = this->tags[i];
-            if((tag.tag_fourcc == tag_fourcc || tag.alias == tag_fourcc) && (tag.path == tag_path || renamed_path == tag.path)) {
-                if(tag.base_struct.has_value()) {
-                    return i;
-                }
-                return_value = i;
-                found = true;
-                tag.stubbed = false;
-                break;
+        auto found_index = this->tag_path_index.find(fixed_path, tag_fourcc);
+        if(renamed_path.has_value()) {
+            auto renamed_index = this->tag_path_index.find(*renamed_path, tag_fourcc);
+            if(renamed_index.has_value() && (!found_index.has_value() || *renamed_index < *found_index)) {
+                found_index = renamed_index;
+            }
+        }
+        if(found_index.has_value()) {
+            auto &tag = this->tags[*found_index];
+            if(tag.base_struct.has_value()) {
+                return *found_index;
             }
+            return_value = *found_index;
+            found = true;
+            tag.stubbed = false;
         }
 
         auto &tags_directories = this->parameters->tags_directories;
@@ -864,11 +1026,14 @@ namespace Invader {
             tag.path = tag_path;
             tag.tag_fourcc = tag_fourcc;
             this->get_tag_paths().emplace_back(tag_path, tag_fourcc);
+            this->index_tag(return_value);
         }
 
         // Rename the path
         if(renamed_path.has_value()) {
+            this->unindex_tag(return_value);
             this->tags[return_value].path = *renamed_path;
+            this->index_tag(return_value);
         }
 
         // And we're done! Maybe?
@@ -881,22 +1046,67 @@ namespace Invader {
             throw InvalidTagPathException();
         }
 
-        // Open it
-        auto tag_file = Invader::File::open_file(*new_path);
-        if(!tag_file.has_value()) {
-            eprintf_error("Failed to open %s\n", formatted_path);
-            throw FailedToOpenFileException();
+        // If we compiled this exact tag in a previous build, splice that in instead
+        this->profile_begin_tag(return_value);
+        if(this->compile_cache && this->compile_cache_replay_or_record(tag_path, tag_fourcc, *new_path, return_value)) {
+            this->profile_end_tag(true);
+            return return_value;
+        }
+
+        // If we (or another map in this batch) already read and parsed it, use that
+        File::TagFilePath preloaded_path(tag_path, tag_fourcc);
+        std::optional<BuildWorkloadPreloadedTag> preloaded_tag;
+        if(auto preloaded = this->preloaded_tags.find(preloaded_path); preloaded != this->preloaded_tags.end()) {
+            preloaded_tag = std::move(preloaded->second);
+            this->preloaded_tags.erase(preloaded);
+        }
+        else if(this->shared_cache) {
+            preloaded_tag = this->find_shared_tag(preloaded_path);
+        }
+
+        // Otherwise open it
+        std::optional<std::vector<std::byte>> tag_file;
+        if(!preloaded_tag.has_value()) {
+            tag_file = Invader::File::open_file(*new_path);
+            if(!tag_file.has_value()) {
+                eprintf_error("Failed to open %s\n", formatted_path);
+                throw FailedToOpenFileException();
+            }
+        }
+
+        // And let the rest of the batch have it
+        if(!preloaded_tag.has_value() && this->shared_cache) {
+            try {
+                preloaded_tag = preload_tag(*tag_file, tag_fourcc, true);
+            }
+            catch(std::exception &) {
+                preloaded_tag = std::nullopt;
+            }
+            if(preloaded_tag.has_value()) {
+                this->add_shared_tag(preloaded_path, *preloaded_tag);
+                this->profile_tag_parsed(preloaded_tag->parse_time, false);
+                preloaded_tag->parse_time = {};
+            }
         }
-        auto &tag_file_data = *tag_file;
 
         try {
-            this->compile_tag_data_recursively(tag_file_data.data(), tag_file_data.size(), return_value, tag_fourcc);
+            if(preloaded_tag.has_value()) {
+                this->compile_tag_data_recursively(nullptr, 0, return_value, tag_fourcc, &*preloaded_tag);
+            }
+            else {
+                this->compile_tag_data_recursively(tag_file->data(), tag_file->size(), return_value, tag_fourcc);
+            }
         }
         catch(std::exception &e) {
             eprintf("Failed to compile tag %s\n", formatted_path);
             throw;
         }
 
+        if(this->compile_cache) {
+            this->compile_cache_finish_recording(return_value);
+        }
+
+        this->profile_end_tag(false);
         return return_value;
     }
 
@@ -1016,6 +1226,7 @@ namespace Invader {
                     warned++;
                 }
 
+                this->unindex_tag(&tag - this->tags.data());
                 tag.path = "MISSINGNO.";
                 tag.tag_fourcc = TagFourCC::TAG_FOURCC_NONE;
                 this->stubbed_tag_count++;
@@ -1061,7 +1272,7 @@ namespace Invader {
         return workload;
     }
 
-    template <typename Tag, HEK::Pointer64 stub_address, bool native> static void do_generate_tag_array(std::size_t tag_count, std::vector<BuildWorkload::BuildWorkloadTag> &tags, std::vector<BuildWorkload::BuildWorkloadStruct> &structs) {
+    template <typename Tag, HEK::Pointer64 stub_address, bool native> static void do_generate_tag_array(std::size_t tag_count, std::vector<BuildWorkload::BuildWorkloadTag> &tags, std::pmr::vector<BuildWorkload::BuildWorkloadStruct> &structs) {
         TAG_ARRAY_STRUCT.data.resize(sizeof(Tag) * tag_count);
 
         // Reserve tag paths
@@ -1247,8 +1458,30 @@ namespace Invader {
             data.insert(data.end(), REQUIRED_PADDING_32_BIT(data.size()), std::byte());
         };
 
+        // Get the size of everything reachable from a struct so we can allocate it all at once rather than growing as we go
+        auto generated_data_size = [&structs](std::size_t struct_index) -> std::size_t {
+            std::vector<bool> visited(structs.size());
+            std::vector<std::size_t> remaining = { struct_index };
+            std::size_t size = 0;
+            while(!remaining.empty()) {
+                auto i = remaining.back();
+                remaining.pop_back();
+                if(visited[i] || structs[i].offset.has_value()) {
+                    continue;
+                }
+                visited[i] = true;
+                auto &s = structs[i];
+                size += s.data.size() + REQUIRED_PADDING_32_BIT(s.data.size());
+                for(auto &p : s.pointers) {
+                    remaining.emplace_back(p.struct_index);
+                }
+            }
+            return size;
+        };
+
         // Build the tag data for the main tag data
         auto &tag_data_struct = this->map_data_structs.emplace_back();
+        tag_data_struct.reserve(generated_data_size(0));
         recursively_generate_data(tag_data_struct, 0, recursively_generate_data);
         auto *tag_data_b = tag_data_struct.data();
 
@@ -1299,6 +1532,7 @@ namespace Invader {
                     pointers.clear();
                     pointers_64_bit.clear();
                     auto &bsp_data_struct = this->map_data_structs.emplace_back();
+                    bsp_data_struct.reserve(generated_data_size(base_struct));
                     recursively_generate_data(bsp_data_struct, base_struct, recursively_generate_data);
 
                     std::size_t bsp_size = bsp_data_struct.size();
@@ -1495,9 +1729,9 @@ namespace Invader {
     void BuildWorkload::externalize_tags() noexcept {
         bool always_index_tags = this->parameters->details.build_raw_data_handling == BuildParameters::BuildParametersDetails::RawDataHandling::RAW_DATA_HANDLING_ALWAYS_INDEX;
 
-        auto &bitmaps = this->parameters->bitmap_data;
-        auto &sounds = this->parameters->sound_data;
-        auto &loc = this->parameters->loc_data;
+        const auto *bitmaps = this->parameters->bitmap_data.get();
+        const auto *sounds = this->parameters->sound_data.get();
+        const auto *loc = this->parameters->loc_data.get();
 
         bool check_ce_bounds = this->parameters->details.build_check_custom_edition_resource_map_bounds;
 
@@ -1505,27 +1739,11 @@ namespace Invader {
             case HEK::CacheFileEngine::CACHE_FILE_CUSTOM_EDITION:
                 for(auto &t : this->tags) {
                     // Find the tag
-                    auto find_tag_index = [](const std::string &path, const std::optional<std::vector<Resource>> &resources, bool every_other) -> std::optional<std::size_t> {
-                        if(!resources.has_value()) {
+                    auto find_tag_index = [](const std::string &path, const ResourceMapView *resources, bool every_other) -> std::optional<std::size_t> {
+                        if(!resources) {
                             return std::nullopt;
                         }
-
-                        std::size_t count = resources->size();
-                        std::size_t iterate_count, iterate_start;
-                        if(every_other) {
-                            iterate_count = 2;
-                            iterate_start = 1;
-                        }
-                        else {
-                            iterate_count = 1;
-                            iterate_start = 0;
-                        }
-                        for(std::size_t i = iterate_start; i < count; i += iterate_count) {
-                            if((*resources)[i].path == path) {
-                                return i;
-                            }
-                        }
-                        return std::nullopt;
+                        return resources->find(path, every_other);
                     };
 
                     switch(t.tag_fourcc) {
@@ -1682,7 +1900,7 @@ namespace Invader {
                                                 auto *raw_data_other_data = bitmap_tag_struct_other_raw_data + bitmap_data_other.pixel_data_offset - bitmap_tag_struct_raw_data_translation;
 
                                                 // Make sure it's not bullshit
-                                                if(raw_data_other_data < bitmap_tag_struct_other_raw_data || raw_data_other_data > (bitmap_tag_struct_other_raw_data + bitmap_tag_struct_other_raw_data_size)) {
+                                                if(raw_data_other_data < bitmap_tag_struct_other_raw_data || raw_data_other_data + raw_data_size > (bitmap_tag_struct_other_raw_data + bitmap_tag_struct_other_raw_data_size)) {
                                                     REPORT_ERROR_PRINTF(*this, ERROR_TYPE_ERROR, std::nullopt, "%s in bitmaps.map appears to be corrupt (pixel data goes out of bounds)", File::halo_path_to_preferred_path(t.path).c_str());
                                                     match = false;
                                                     break;
@@ -1827,7 +2045,7 @@ namespace Invader {
                                                     std::size_t raw_data_other_size = permutation_other.samples.size;
 
                                                     // Make sure it's not bullshit
-                                                    if(raw_data_other_data < sound_tag_struct_other_raw_data || raw_data_other_data > (sound_tag_struct_other_raw_data + sound_tag_struct_raw_data_size)) {
+                                                    if(raw_data_other_data < sound_tag_struct_other_raw_data || raw_data_other_data + raw_data_other_size > (sound_tag_struct_other_raw_data + sound_tag_struct_raw_data_size)) {
                                                         REPORT_ERROR_PRINTF(*this, ERROR_TYPE_ERROR, std::nullopt, "%s in sounds.map appears to be corrupt (sample data goes out of bounds)", File::halo_path_to_preferred_path(t.path).c_str());
                                                         match = false;
                                                         break;
@@ -2152,7 +2370,7 @@ namespace Invader {
                     switch(t.tag_fourcc) {
                         // Iterate through bitmap data
                         case TagFourCC::TAG_FOURCC_BITMAP: {
-                            if(bitmaps.has_value()) {
+                            if(bitmaps) {
                                 auto &bitmap_tag_struct = this->structs[*t.base_struct];
                                 auto &bitmap_tag = *reinterpret_cast<Parser::Bitmap::struct_little *>(bitmap_tag_struct.data.data());
                                 std::size_t bitmap_data_count = bitmap_tag.bitmap_data.count;
@@ -2184,7 +2402,7 @@ namespace Invader {
 
                         // Iterate through each permutation in each pitch range to find the sound
                         case TagFourCC::TAG_FOURCC_SOUND: {
-                            if(sounds.has_value()) {
+                            if(sounds) {
                                 auto &sound_tag_struct = this->structs[*t.base_struct];
                                 auto &sound_tag = *reinterpret_cast<Parser::Sound::struct_little *>(sound_tag_struct.data.data());
                                 std::size_t sound_pitch_range_count = sound_tag.pitch_ranges.count;
@@ -2351,8 +2569,8 @@ namespace Invader {
         auto &vertices_data_struct = this->structs[vertices_data_struct_index];
 
         // Add an entry for each part
-        auto *indices_array_data = reinterpret_cast<HEK::CacheFileModelPartIndicesXbox *>((indices_array_struct.data = std::vector<std::byte>(part_count * sizeof(HEK::CacheFileModelPartIndicesXbox))).data());
-        auto *vertices_array_data = reinterpret_cast<HEK::CacheFileModelPartVerticesXbox *>((vertices_array_struct.data = std::vector<std::byte>(part_count * sizeof(HEK::CacheFileModelPartVerticesXbox))).data());
+        auto *indices_array_data = reinterpret_cast<HEK::CacheFileModelPartIndicesXbox *>((indices_array_struct.data.resize(part_count * sizeof(HEK::CacheFileModelPartIndicesXbox)), indices_array_struct.data.data()));
+        auto *vertices_array_data = reinterpret_cast<HEK::CacheFileModelPartVerticesXbox *>((vertices_array_struct.data.resize(part_count * sizeof(HEK::CacheFileModelPartVerticesXbox)), vertices_array_struct.data.data()));
 
         // Fill it up with the vertices/indices
         auto *indices_data = this->model_indices.data();
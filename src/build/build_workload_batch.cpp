@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <thread>
+#include <atomic>
+
+#include <invader/printf.hpp>
+#include "build_workload_cache.hpp"
+
+namespace Invader {
+    std::optional<BuildWorkload::BuildWorkloadPreloadedTag> BuildWorkload::find_shared_tag(const File::TagFilePath &tag_path) {
+        // Maps with different tags directories may find a different file for the same path
+        std::scoped_lock<std::mutex> lock(this->shared_cache->mutex);
+        auto directories = this->shared_cache->parsed_tags.find(this->parameters->tags_directories);
+        if(directories == this->shared_cache->parsed_tags.end()) {
+            return std::nullopt;
+        }
+        auto &parsed_tags = directories->second;
+        if(auto shared = parsed_tags.find(tag_path); shared != parsed_tags.end()) {
+            // Another map paid for the parse, so don't count it against this one
+            auto tag = shared->second;
+            tag.parse_time = {};
+            return tag;
+        }
+        return std::nullopt;
+    }
+
+    void BuildWorkload::add_shared_tag(const File::TagFilePath &tag_path, const BuildWorkloadPreloadedTag &tag) {
+        std::scoped_lock<std::mutex> lock(this->shared_cache->mutex);
+        this->shared_cache->parsed_tags[this->parameters->tags_directories].emplace(tag_path, tag);
+    }
+
+    std::size_t BuildWorkload::compile_maps(const std::vector<BuildParameters> &parameters, const std::vector<std::filesystem::path> &outputs, std::size_t thread_count) {
+        if(parameters.size() != outputs.size() || thread_count < 1) {
+            throw InvalidArgumentException();
+        }
+
+        // Parsed tags are copied before they're compiled, and compiled tags are copied into each workload as they're
+        // replayed. Nothing in here may be modified once it's added, and that includes the values cache filled in by
+        // ParserStruct::get_values(), so dependencies are found by scanning the tag file instead.
+        auto shared_cache = std::make_shared<SharedCache>();
+        std::mutex output_mutex;
+        std::atomic<std::size_t> next_map = 0;
+        std::atomic<std::size_t> failed_maps = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        auto build_worker = [&]() {
+            for(std::size_t m; (m = next_map++) < parameters.size();) {
+                auto &map_parameters = parameters[m];
+                auto map_start = std::chrono::steady_clock::now();
+
+                try {
+                    BuildWorkload workload;
+                    workload.parameters = &map_parameters;
+                    workload.output_path = &outputs[m];
+                    workload.shared_cache = shared_cache;
+                    workload.output_mutex = &output_mutex;
+                    workload.set_report_output(&output_mutex, "[" + outputs[m].filename().string() + "] ");
+                    workload.build_cache_file();
+                }
+                catch(std::exception &e) {
+                    failed_maps++;
+                    std::scoped_lock<std::mutex> lock(output_mutex);
+                    eprintf_error("Failed to build %s after %.03f ms: %s", outputs[m].string().c_str(), std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - map_start).count() / 1000.0, e.what());
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for(std::size_t i = 0; i < thread_count && i < parameters.size(); i++) {
+            threads.emplace_back(build_worker);
+        }
+        for(auto &i : threads) {
+            i.join();
+        }
+
+        // Summarize the batch
+        bool show_summary = false;
+        for(auto &p : parameters) {
+            show_summary = show_summary || p.verbosity > BuildParameters::BuildVerbosity::BUILD_VERBOSITY_QUIET;
+        }
+        if(show_summary) {
+            oprintf("Built %zu / %zu maps in %.03f ms\n", parameters.size() - failed_maps, parameters.size(), std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0);
+        }
+
+        return failed_maps;
+    }
+}
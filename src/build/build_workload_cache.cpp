@@ -0,0 +1,711 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cstring>
+#include <thread>
+
+#include <invader/file/file.hpp>
+#include <invader/tag/hek/header.hpp>
+#include <invader/version.hpp>
+#include <invader/printf.hpp>
+#include "../crc/crc32.h"
+#include "build_workload_cache.hpp"
+
+// The compile cache stores what compiling a tag added to the workload, keyed by the tag's path, its contents and
+// everything about the build that the tag's compile can see. A tag's full key also covers the full keys of every tag
+// it depended on, so a tag is only reused when nothing it could have looked at has changed.
+//
+// Compiling a tag alternates between adding its own structs and compiling its dependencies (which add theirs), so
+// the tag's own structs and raw data are stored as segments between each dependency. Replaying a tag does the same
+// thing in the same order, so tag and struct indices come out exactly as if the tag had been compiled.
+
+namespace Invader {
+    using namespace HEK;
+
+    #define COMPILE_CACHE_MAGIC static_cast<std::uint32_t>(0x49434332) // ICC2
+
+    static std::uint64_t compile_cache_hash(std::uint64_t hash, const void *data, std::size_t size) noexcept {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+        for(std::size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    template <typename T> static std::uint64_t compile_cache_hash_value(std::uint64_t hash, const T &value) noexcept {
+        return compile_cache_hash(hash, &value, sizeof(value));
+    }
+
+    static std::filesystem::path compile_cache_entry_path(const std::filesystem::path &directory, std::uint64_t content_key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.tagc", static_cast<unsigned long long>(content_key));
+        return directory / name;
+    }
+
+    // Entries are only read back by the same build of Invader on the same machine, so native byte order is fine
+    class CompileCacheWriter {
+    public:
+        template <typename T> void write(const T &value) {
+            const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+            this->data.insert(this->data.end(), bytes, bytes + sizeof(value));
+        }
+        template <typename T> void write_bytes(const T &bytes) {
+            this->write(static_cast<std::uint64_t>(bytes.size()));
+            this->data.insert(this->data.end(), bytes.begin(), bytes.end());
+        }
+        void write_string(const std::string &string) {
+            this->write(static_cast<std::uint64_t>(string.size()));
+            const auto *bytes = reinterpret_cast<const std::byte *>(string.data());
+            this->data.insert(this->data.end(), bytes, bytes + string.size());
+        }
+        std::vector<std::byte> data;
+    };
+
+    class CompileCacheReader {
+    public:
+        CompileCacheReader(const std::vector<std::byte> &data) : data(data) {}
+        template <typename T> T read() {
+            T value;
+            this->check(sizeof(value));
+            std::memcpy(&value, this->data.data() + this->offset, sizeof(value));
+            this->offset += sizeof(value);
+            return value;
+        }
+        std::size_t read_count() {
+            auto count = this->read<std::uint64_t>();
+            this->check(count); // every element takes at least one byte, so this catches garbage counts early
+            return static_cast<std::size_t>(count);
+        }
+        std::vector<std::byte> read_bytes() {
+            auto size = this->read_count();
+            std::vector<std::byte> bytes(this->data.begin() + this->offset, this->data.begin() + this->offset + size);
+            this->offset += size;
+            return bytes;
+        }
+        std::string read_string() {
+            auto size = this->read_count();
+            std::string string(reinterpret_cast<const char *>(this->data.data() + this->offset), size);
+            this->offset += size;
+            return string;
+        }
+        bool done() const noexcept {
+            return this->offset == this->data.size();
+        }
+    private:
+        void check(std::size_t size) {
+            if(size > this->data.size() - this->offset) {
+                throw OutOfBoundsException();
+            }
+        }
+        const std::vector<std::byte> &data;
+        std::size_t offset = 0;
+    };
+
+    static std::vector<std::byte> compile_cache_serialize(const BuildWorkload::CompileCache::Entry &entry) {
+        CompileCacheWriter w;
+        w.write(COMPILE_CACHE_MAGIC);
+        w.write(entry.key);
+        w.write(entry.tag_crc);
+        w.write(entry.tag_size);
+        w.write(static_cast<std::uint8_t>(entry.reusable));
+        w.write(static_cast<std::uint64_t>(entry.dependencies.size()));
+        for(auto &d : entry.dependencies) {
+            w.write_string(d.path);
+            w.write(d.fourcc);
+            w.write(d.key);
+        }
+        if(!entry.reusable) {
+            return std::move(w.data);
+        }
+
+        w.write(static_cast<std::uint64_t>(entry.segment_struct_counts.size()));
+        for(std::size_t i = 0; i < entry.segment_struct_counts.size(); i++) {
+            w.write(static_cast<std::uint64_t>(entry.segment_struct_counts[i]));
+            w.write(static_cast<std::uint64_t>(entry.segment_raw_data_counts[i]));
+        }
+        w.write(static_cast<std::uint64_t>(entry.structs.size()));
+        for(auto &s : entry.structs) {
+            w.write_bytes(s.data);
+            w.write(static_cast<std::uint8_t>(s.unsafe_to_dedupe));
+            w.write(static_cast<std::uint8_t>(s.bsp.has_value()));
+            w.write(static_cast<std::uint64_t>(s.bsp.value_or(0)));
+            w.write(static_cast<std::uint64_t>(s.dependencies.size()));
+            for(auto &d : s.dependencies) {
+                w.write(static_cast<std::uint64_t>(d.tag_index));
+                w.write(static_cast<std::uint64_t>(d.offset));
+                w.write(static_cast<std::uint8_t>(d.tag_id_only));
+            }
+            w.write(static_cast<std::uint64_t>(s.pointers.size()));
+            for(auto &p : s.pointers) {
+                w.write(static_cast<std::uint64_t>(p.struct_index));
+                w.write(static_cast<std::uint64_t>(p.offset));
+                w.write(static_cast<std::uint8_t>(p.limit_to_32_bits));
+                w.write(static_cast<std::uint64_t>(p.struct_data_offset));
+            }
+        }
+        w.write(static_cast<std::uint64_t>(entry.raw_data.size()));
+        for(auto &r : entry.raw_data) {
+            w.write_bytes(r);
+        }
+        w.write(static_cast<std::uint64_t>(entry.referenced_tags.size()));
+        for(auto &t : entry.referenced_tags) {
+            w.write_string(t.path);
+            w.write(t.fourcc);
+        }
+        w.write(static_cast<std::uint64_t>(entry.asset_data.size()));
+        for(auto &a : entry.asset_data) {
+            w.write(static_cast<std::uint64_t>(a));
+        }
+        w.write(static_cast<std::uint64_t>(entry.base_struct));
+        return std::move(w.data);
+    }
+
+    static std::optional<BuildWorkload::CompileCache::Entry> compile_cache_deserialize(const std::vector<std::byte> &data) {
+        try {
+            CompileCacheReader r(data);
+            if(r.read<std::uint32_t>() != COMPILE_CACHE_MAGIC) {
+                return std::nullopt;
+            }
+
+            BuildWorkload::CompileCache::Entry entry;
+            entry.key = r.read<std::uint64_t>();
+            entry.tag_crc = r.read<std::uint32_t>();
+            entry.tag_size = r.read<std::uint64_t>();
+            entry.reusable = r.read<std::uint8_t>();
+            entry.dependencies.resize(r.read_count());
+            for(auto &d : entry.dependencies) {
+                d.path = r.read_string();
+                d.fourcc = r.read<TagFourCC>();
+                d.key = r.read<std::uint64_t>();
+            }
+            if(!entry.reusable) {
+                return r.done() ? std::optional(std::move(entry)) : std::nullopt;
+            }
+
+            auto segment_count = r.read_count();
+            if(segment_count != entry.dependencies.size() + 1) {
+                return std::nullopt;
+            }
+            for(std::size_t i = 0; i < segment_count; i++) {
+                entry.segment_struct_counts.emplace_back(r.read<std::uint64_t>());
+                entry.segment_raw_data_counts.emplace_back(r.read<std::uint64_t>());
+            }
+            entry.structs.resize(r.read_count());
+            for(auto &s : entry.structs) {
+                auto data = r.read_bytes();
+                s.data.assign(data.begin(), data.end());
+                s.unsafe_to_dedupe = r.read<std::uint8_t>();
+                bool has_bsp = r.read<std::uint8_t>();
+                auto bsp = r.read<std::uint64_t>();
+                s.bsp = has_bsp ? std::optional<std::size_t>(bsp) : std::nullopt;
+                s.dependencies.resize(r.read_count());
+                for(auto &d : s.dependencies) {
+                    d.tag_index = r.read<std::uint64_t>();
+                    d.offset = r.read<std::uint64_t>();
+                    d.tag_id_only = r.read<std::uint8_t>();
+                }
+                s.pointers.resize(r.read_count());
+                for(auto &p : s.pointers) {
+                    p.struct_index = r.read<std::uint64_t>();
+                    p.offset = r.read<std::uint64_t>();
+                    p.limit_to_32_bits = r.read<std::uint8_t>();
+                    p.struct_data_offset = r.read<std::uint64_t>();
+                }
+            }
+            entry.raw_data.resize(r.read_count());
+            for(auto &d : entry.raw_data) {
+                d = r.read_bytes();
+            }
+            entry.referenced_tags.resize(r.read_count());
+            for(auto &t : entry.referenced_tags) {
+                t.path = r.read_string();
+                t.fourcc = r.read<TagFourCC>();
+            }
+            entry.asset_data.resize(r.read_count());
+            for(auto &a : entry.asset_data) {
+                a = r.read<std::uint64_t>();
+            }
+            entry.base_struct = r.read<std::uint64_t>();
+
+            // Make sure everything points to something that exists
+            std::size_t struct_total = 0, raw_data_total = 0;
+            for(std::size_t i = 0; i < segment_count; i++) {
+                struct_total += entry.segment_struct_counts[i];
+                raw_data_total += entry.segment_raw_data_counts[i];
+            }
+            if(!r.done() || struct_total != entry.structs.size() || raw_data_total != entry.raw_data.size() || entry.base_struct >= struct_total) {
+                return std::nullopt;
+            }
+            for(auto &s : entry.structs) {
+                for(auto &d : s.dependencies) {
+                    auto size = d.tag_id_only ? sizeof(HEK::LittleEndian<HEK::TagID>) : sizeof(HEK::TagDependency<HEK::LittleEndian>);
+                    if(d.tag_index >= entry.referenced_tags.size() || d.offset > s.data.size() || size > s.data.size() - d.offset) {
+                        return std::nullopt;
+                    }
+                }
+                for(auto &p : s.pointers) {
+                    if(p.struct_index >= struct_total) {
+                        return std::nullopt;
+                    }
+                }
+            }
+            for(auto &a : entry.asset_data) {
+                if(a >= raw_data_total) {
+                    return std::nullopt;
+                }
+            }
+
+            return entry;
+        }
+        catch(std::exception &) {
+            return std::nullopt;
+        }
+    }
+
+    static std::string compile_cache_directory_name(const BuildWorkload::CompileCache &cache) {
+        return cache.directory.has_value() ? cache.directory->string() : std::string("the compile cache");
+    }
+
+    static std::shared_ptr<const BuildWorkload::CompileCache::Entry> compile_cache_load_entry(BuildWorkload::SharedCache *shared_cache, const std::optional<std::filesystem::path> &directory, std::uint64_t content_key) {
+        // Another map in this batch may have already loaded or compiled it
+        if(shared_cache) {
+            std::scoped_lock<std::mutex> lock(shared_cache->mutex);
+            if(auto shared = shared_cache->compiled_tags.find(content_key); shared != shared_cache->compiled_tags.end()) {
+                return shared->second;
+            }
+        }
+
+        if(!directory.has_value()) {
+            return nullptr;
+        }
+        auto data = File::open_file(compile_cache_entry_path(*directory, content_key));
+        if(!data.has_value()) {
+            return nullptr;
+        }
+        auto entry = compile_cache_deserialize(*data);
+        if(!entry.has_value()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<const BuildWorkload::CompileCache::Entry> loaded = std::make_shared<BuildWorkload::CompileCache::Entry>(std::move(*entry));
+        if(shared_cache) {
+            std::scoped_lock<std::mutex> lock(shared_cache->mutex);
+            shared_cache->compiled_tags.emplace(content_key, loaded);
+        }
+        return loaded;
+    }
+
+    void BuildWorkload::compile_cache_begin() {
+        this->compile_cache = std::make_shared<CompileCache>();
+
+        // Without a directory, the cache only lives as long as the batch it's shared with
+        if(!this->parameters->compile_cache_directory.has_value()) {
+            return;
+        }
+
+        auto &directory = *this->parameters->compile_cache_directory;
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if(!std::filesystem::is_directory(directory, ec)) {
+            eprintf_error("Failed to create compile cache directory %s", directory.string().c_str());
+            throw FailedToOpenFileException();
+        }
+        this->compile_cache->directory = directory;
+    }
+
+    std::uint64_t BuildWorkload::compile_cache_parameters_key() const {
+        // Everything a tag's compile can see besides its own data and its dependencies
+        std::uint64_t hash = 0xCBF29CE484222325ull;
+        const char *version = full_version();
+        hash = compile_cache_hash(hash, version, std::strlen(version));
+        hash = compile_cache_hash_value(hash, this->parameters->details.build_game_engine);
+        hash = compile_cache_hash_value(hash, this->parameters->details.build_cache_file_engine);
+        hash = compile_cache_hash_value(hash, this->parameters->verbosity);
+        hash = compile_cache_hash_value(hash, this->get_reporting_level());
+        hash = compile_cache_hash_value(hash, this->cache_file_type.has_value() ? static_cast<int>(*this->cache_file_type) : -1);
+        hash = compile_cache_hash_value(hash, this->demo_ui);
+        hash = compile_cache_hash_value(hash, this->jason_jones);
+        hash = compile_cache_hash_value(hash, this->building_stock_map);
+        hash = compile_cache_hash_value(hash, this->disable_error_checking);
+        hash = compile_cache_hash_value(hash, this->disable_recursion);
+        return hash;
+    }
+
+    std::uint64_t BuildWorkload::compile_cache_file_hash(const std::vector<std::byte> &tag_file) noexcept {
+        return compile_cache_hash(0xCBF29CE484222325ull, tag_file.data(), tag_file.size());
+    }
+
+    static std::uint64_t compile_cache_content_key(std::uint64_t parameters_key, const File::TagFilePath &tag_path, std::uint64_t file_size, std::uint64_t file_hash) noexcept {
+        auto hash = compile_cache_hash(parameters_key, tag_path.path.data(), tag_path.path.size());
+        hash = compile_cache_hash_value(hash, tag_path.fourcc);
+        hash = compile_cache_hash_value(hash, file_size);
+        return compile_cache_hash_value(hash, file_hash);
+    }
+
+    const BuildWorkload::CompileCacheTagFile *BuildWorkload::compile_cache_tag_file(const File::TagFilePath &tag_path, const std::filesystem::path *file_path) {
+        auto &cache = *this->compile_cache;
+        if(auto t = cache.tag_files.find(tag_path); t != cache.tag_files.end()) {
+            return t->second.has_value() ? &*t->second : nullptr;
+        }
+
+        auto get_tag_file = [this, &tag_path, &file_path]() -> std::optional<CompileCacheTagFile> {
+            auto parameters_key = this->compile_cache_parameters_key();
+
+            // If it was preloaded, it was already hashed
+            std::optional<BuildWorkloadPreloadedTag> preloaded;
+            if(auto p = this->preloaded_tags.find(tag_path); p != this->preloaded_tags.end()) {
+                preloaded = p->second;
+            }
+            else if(this->shared_cache) {
+                preloaded = this->find_shared_tag(tag_path);
+            }
+            if(preloaded.has_value() && preloaded->file_hash.has_value()) {
+                return CompileCacheTagFile { compile_cache_content_key(parameters_key, tag_path, preloaded->file_size, *preloaded->file_hash), preloaded->calculated_crc, preloaded->file_size };
+            }
+
+            // Otherwise read it
+            std::optional<std::filesystem::path> found_path;
+            if(file_path) {
+                found_path = *file_path;
+            }
+            else {
+                try {
+                    found_path = File::tag_path_to_file_path(tag_path, this->parameters->tags_directories);
+                }
+                catch(std::exception &) {
+                    return std::nullopt;
+                }
+            }
+            if(!found_path.has_value()) {
+                return std::nullopt;
+            }
+            auto tag_file = File::open_file(*found_path);
+            if(!tag_file.has_value()) {
+                return std::nullopt;
+            }
+            auto tag_crc = tag_file->size() >= sizeof(TagFileHeader) ? ~crc32(0, tag_file->data() + sizeof(TagFileHeader), tag_file->size() - sizeof(TagFileHeader)) : 0;
+            return CompileCacheTagFile { compile_cache_content_key(parameters_key, tag_path, tag_file->size(), compile_cache_file_hash(*tag_file)), tag_crc, tag_file->size() };
+        };
+
+        auto &tag_file = cache.tag_files[tag_path] = get_tag_file();
+        return tag_file.has_value() ? &*tag_file : nullptr;
+    }
+
+    static std::uint64_t compile_cache_full_key(std::uint64_t content_key, const std::vector<std::uint64_t> &dependency_keys) noexcept {
+        auto hash = compile_cache_hash_value(0xCBF29CE484222325ull, content_key);
+        for(auto &k : dependency_keys) {
+            hash = compile_cache_hash_value(hash, k);
+        }
+        return hash;
+    }
+
+    std::optional<std::uint64_t> BuildWorkload::compile_cache_verified_key(const File::TagFilePath &tag_path) {
+        auto &cache = *this->compile_cache;
+        if(auto v = cache.verified_keys.find(tag_path); v != cache.verified_keys.end()) {
+            return v->second;
+        }
+
+        // A tag that (indirectly) depends on itself can't be verified
+        if(!cache.verifying.insert(tag_path).second) {
+            return std::nullopt;
+        }
+
+        auto verify = [this, &cache, &tag_path]() -> std::optional<std::uint64_t> {
+            auto *tag_file = this->compile_cache_tag_file(tag_path);
+            if(!tag_file) {
+                return std::nullopt;
+            }
+
+            // The content key is only a hash, so make sure it's the same tag
+            auto entry = compile_cache_load_entry(this->shared_cache.get(), cache.directory, tag_file->content_key);
+            if(!entry || entry->tag_crc != tag_file->tag_crc || entry->tag_size != tag_file->tag_size) {
+                return std::nullopt;
+            }
+
+            std::vector<std::uint64_t> dependency_keys;
+            for(auto &d : entry->dependencies) {
+                auto key = this->compile_cache_verified_key(File::TagFilePath(File::remove_duplicate_slashes(d.path), d.fourcc));
+                if(!key.has_value() || *key != d.key) {
+                    return std::nullopt;
+                }
+                dependency_keys.emplace_back(*key);
+            }
+
+            cache.verified_entries[tag_path] = entry;
+            return entry->key;
+        };
+
+        auto key = verify();
+        cache.verifying.erase(tag_path);
+        cache.verified_keys[tag_path] = key;
+        return key;
+    }
+
+    static BuildWorkload::CompileCache::GlobalState compile_cache_global_state(const BuildWorkload &workload) noexcept {
+        BuildWorkload::CompileCache::GlobalState state;
+        state.structs = workload.structs.size();
+        state.raw_data = workload.raw_data.size();
+        state.reports = workload.get_warnings() + workload.get_errors();
+        state.model_indices = workload.model_indices.size();
+        state.compressed_model_vertices = workload.compressed_model_vertices.size();
+        state.uncompressed_model_vertices = workload.uncompressed_model_vertices.size();
+        state.model_parts = workload.model_parts.size();
+        state.bsp_data = workload.bsp_data.size();
+        state.bsp_count = workload.bsp_count;
+        return state;
+    }
+
+    void BuildWorkload::compile_cache_pause_recording() {
+        auto &cache = *this->compile_cache;
+        if(cache.recorders.empty() || cache.recorders.back().replaying) {
+            return;
+        }
+
+        // End the current segment here
+        auto &recorder = cache.recorders.back();
+        auto state = compile_cache_global_state(*this);
+        if(!state.same_globals(recorder.segment_start)) {
+            recorder.reusable = false;
+        }
+        recorder.segments.emplace_back(CompileCache::Segment { recorder.segment_start.structs, state.structs, recorder.segment_start.raw_data, state.raw_data });
+    }
+
+    void BuildWorkload::compile_cache_resume_recording(const char *tag_path, TagFourCC tag_fourcc, std::size_t tag_index) {
+        auto &cache = *this->compile_cache;
+        if(cache.recorders.empty() || cache.recorders.back().replaying) {
+            return;
+        }
+
+        auto &recorder = cache.recorders.back();
+        recorder.dependencies.emplace_back(tag_path, tag_fourcc);
+        recorder.dependency_indices.emplace_back(tag_index);
+        recorder.segment_start = compile_cache_global_state(*this);
+    }
+
+    bool BuildWorkload::compile_cache_replay_or_record(const char *tag_path, TagFourCC tag_fourcc, const std::filesystem::path &file_path, std::size_t tag_index) {
+        auto &cache = *this->compile_cache;
+        File::TagFilePath cache_path(tag_path, tag_fourcc);
+
+        // This is the same file verification looked at, so it was only read once
+        auto *tag_file = this->compile_cache_tag_file(cache_path, &file_path);
+        if(!tag_file) {
+            eprintf_error("Failed to open %s\n", file_path.string().c_str());
+            throw FailedToOpenFileException();
+        }
+
+        auto &recorder = cache.recorders.emplace_back();
+        recorder.tag_index = tag_index;
+        recorder.content_key = tag_file->content_key;
+        recorder.tag_crc = tag_file->tag_crc;
+        recorder.tag_size = tag_file->tag_size;
+        recorder.segment_start = compile_cache_global_state(*this);
+
+        // These look at or modify other tags' data outside of their dependencies, so they always have to be compiled
+        switch(tag_fourcc) {
+            case TagFourCC::TAG_FOURCC_SCENARIO:
+            case TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP:
+            case TagFourCC::TAG_FOURCC_UI_WIDGET_DEFINITION:
+            case TagFourCC::TAG_FOURCC_GLOBALS:
+                recorder.reusable = false;
+                return false;
+            default:
+                break;
+        }
+
+        // Is it in the cache and is everything it depends on the same as before?
+        auto key = this->compile_cache_verified_key(cache_path);
+        auto entry_it = cache.verified_entries.find(cache_path);
+        if(!key.has_value() || entry_it == cache.verified_entries.end() || !entry_it->second->reusable) {
+            return false;
+        }
+        auto entry = entry_it->second;
+
+        // Replay it. Anything compiled by dependencies from here belongs to them.
+        recorder.replaying = true;
+
+        HEK::BigEndian<std::uint32_t> tag_crc = entry->tag_crc;
+        this->tag_file_checksums = crc32(this->tag_file_checksums, &tag_crc, sizeof(tag_crc));
+        if(this->tags[tag_index].tag_fourcc != tag_fourcc) {
+            this->unindex_tag(tag_index);
+            this->tags[tag_index].tag_fourcc = tag_fourcc;
+            this->index_tag(tag_index);
+        }
+
+        std::vector<std::size_t> struct_indices;
+        std::vector<std::size_t> raw_data_indices;
+        struct_indices.reserve(entry->structs.size());
+        raw_data_indices.reserve(entry->raw_data.size());
+
+        std::size_t segment_count = entry->segment_struct_counts.size();
+        for(std::size_t s = 0; s < segment_count; s++) {
+            for(std::size_t i = 0; i < entry->segment_struct_counts[s]; i++) {
+                struct_indices.emplace_back(this->structs.size());
+                this->structs.emplace_back(entry->structs[struct_indices.size() - 1]);
+            }
+            for(std::size_t i = 0; i < entry->segment_raw_data_counts[s]; i++) {
+                raw_data_indices.emplace_back(this->raw_data.size());
+                this->raw_data.emplace_back(entry->raw_data[raw_data_indices.size() - 1]);
+            }
+            if(s + 1 < segment_count) {
+                auto &dependency = entry->dependencies[s];
+                auto dependency_index = this->compile_tag_recursively(dependency.path.c_str(), dependency.fourcc);
+                auto dependency_key = cache.tag_keys.find(dependency_index);
+                if(dependency_key == cache.tag_keys.end() || dependency_key->second != dependency.key) {
+                    eprintf_error("Compile cache entry for %s.%s is inconsistent; delete %s and try again", File::halo_path_to_preferred_path(tag_path).c_str(), tag_fourcc_to_extension(tag_fourcc), compile_cache_directory_name(cache).c_str());
+                    throw InvalidTagDataException();
+                }
+            }
+        }
+
+        // Point everything at where it ended up
+        std::vector<std::size_t> referenced_tags;
+        referenced_tags.reserve(entry->referenced_tags.size());
+        for(auto &r : entry->referenced_tags) {
+            auto found = this->tag_path_index.find(r.path, r.fourcc);
+            if(!found.has_value()) {
+                eprintf_error("Compile cache entry for %s.%s references %s.%s which was not compiled; delete %s and try again", File::halo_path_to_preferred_path(tag_path).c_str(), tag_fourcc_to_extension(tag_fourcc), File::halo_path_to_preferred_path(r.path).c_str(), tag_fourcc_to_extension(r.fourcc), compile_cache_directory_name(cache).c_str());
+                throw InvalidTagDataException();
+            }
+            referenced_tags.emplace_back(*found);
+        }
+        for(auto s : struct_indices) {
+            auto &new_struct = this->structs[s];
+            for(auto &d : new_struct.dependencies) {
+                d.tag_index = referenced_tags[d.tag_index];
+
+                // Other tags read tag IDs straight out of the struct data, so those have to be correct, too
+                auto *tag_id = d.tag_id_only ? reinterpret_cast<HEK::LittleEndian<HEK::TagID> *>(new_struct.data.data() + d.offset) : &reinterpret_cast<HEK::TagDependency<HEK::LittleEndian> *>(new_struct.data.data() + d.offset)->tag_id;
+                auto new_tag_id = tag_id->read();
+                new_tag_id.index = static_cast<std::uint16_t>(d.tag_index);
+                *tag_id = new_tag_id;
+            }
+            for(auto &p : this->structs[s].pointers) {
+                p.struct_index = struct_indices[p.struct_index];
+            }
+        }
+
+        auto &tag = this->tags[tag_index];
+        for(auto a : entry->asset_data) {
+            tag.asset_data.emplace_back(raw_data_indices[a]);
+        }
+        tag.base_struct = struct_indices[entry->base_struct];
+
+        cache.recorders.pop_back();
+        cache.tag_keys[tag_index] = entry->key;
+        this->compile_cache_reused++;
+        return true;
+    }
+
+    void BuildWorkload::compile_cache_finish_recording(std::size_t tag_index) {
+        auto &cache = *this->compile_cache;
+        auto recorder = std::move(cache.recorders.back());
+        cache.recorders.pop_back();
+        this->compile_cache_compiled++;
+
+        // Close the last segment
+        auto state = compile_cache_global_state(*this);
+        if(!state.same_globals(recorder.segment_start)) {
+            recorder.reusable = false;
+        }
+        recorder.segments.emplace_back(CompileCache::Segment { recorder.segment_start.structs, state.structs, recorder.segment_start.raw_data, state.raw_data });
+
+        // We need to know every dependency's key, or else we can't know when this tag changes
+        CompileCache::Entry entry;
+        std::vector<std::uint64_t> dependency_keys;
+        for(std::size_t d = 0; d < recorder.dependencies.size(); d++) {
+            auto key = cache.tag_keys.find(recorder.dependency_indices[d]);
+            if(key == cache.tag_keys.end()) {
+                return;
+            }
+            dependency_keys.emplace_back(key->second);
+            entry.dependencies.emplace_back(CompileCache::Dependency { recorder.dependencies[d].first, recorder.dependencies[d].second, key->second });
+        }
+        entry.key = compile_cache_full_key(recorder.content_key, dependency_keys);
+        entry.tag_crc = recorder.tag_crc;
+        entry.tag_size = recorder.tag_size;
+        cache.tag_keys[tag_index] = entry.key;
+
+        // Gather our structs and raw data, making sure they only point to each other
+        auto &tag = this->tags[tag_index];
+        std::map<std::size_t, std::size_t> local_structs;
+        std::map<std::size_t, std::size_t> local_raw_data;
+        std::map<std::size_t, std::size_t> local_referenced_tags;
+        for(auto &segment : recorder.segments) {
+            entry.segment_struct_counts.emplace_back(segment.struct_end - segment.struct_start);
+            entry.segment_raw_data_counts.emplace_back(segment.raw_data_end - segment.raw_data_start);
+            for(std::size_t s = segment.struct_start; s < segment.struct_end; s++) {
+                local_structs.emplace(s, local_structs.size());
+            }
+            for(std::size_t r = segment.raw_data_start; r < segment.raw_data_end; r++) {
+                local_raw_data.emplace(r, local_raw_data.size());
+            }
+        }
+
+        auto is_reusable = [&]() -> bool {
+            if(!recorder.reusable || !tag.base_struct.has_value() || !local_structs.contains(*tag.base_struct)) {
+                return false;
+            }
+            for(auto &[global, local] : local_structs) {
+                auto &s = entry.structs.emplace_back(this->structs[global]);
+                if(s.offset.has_value()) {
+                    return false;
+                }
+                for(auto &p : s.pointers) {
+                    auto l = local_structs.find(p.struct_index);
+                    if(l == local_structs.end()) {
+                        return false;
+                    }
+                    p.struct_index = l->second;
+                }
+                for(auto &d : s.dependencies) {
+                    auto &referenced = this->tags[d.tag_index];
+                    if(referenced.tag_fourcc == TagFourCC::TAG_FOURCC_SCENARIO) {
+                        return false;
+                    }
+                    auto l = local_referenced_tags.emplace(d.tag_index, local_referenced_tags.size());
+                    if(l.second) {
+                        entry.referenced_tags.emplace_back(referenced.path, referenced.tag_fourcc);
+                    }
+                    d.tag_index = l.first->second;
+                }
+            }
+            for(auto &[global, local] : local_raw_data) {
+                entry.raw_data.emplace_back(this->raw_data[global]);
+            }
+            for(auto a : tag.asset_data) {
+                auto l = local_raw_data.find(a);
+                if(l == local_raw_data.end()) {
+                    return false;
+                }
+                entry.asset_data.emplace_back(l->second);
+            }
+            entry.base_struct = local_structs[*tag.base_struct];
+            return true;
+        };
+        entry.reusable = is_reusable();
+
+        // Write it to a temporary file first so an interrupted build doesn't leave a broken entry. Other maps in the
+        // batch may be writing the same entry, so each thread gets its own temporary file.
+        if(cache.directory.has_value()) {
+            auto path = compile_cache_entry_path(*cache.directory, recorder.content_key);
+            auto temp_path = path;
+            char temp_extension[32];
+            std::snprintf(temp_extension, sizeof(temp_extension), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+            temp_path += temp_extension;
+            if(File::save_file(temp_path, compile_cache_serialize(entry))) {
+                std::error_code ec;
+                std::filesystem::rename(temp_path, path, ec);
+            }
+        }
+
+        // Let the rest of the batch use it, too
+        if(this->shared_cache) {
+            // Only the key and dependencies of an entry that can't be reused are ever looked at
+            if(!entry.reusable) {
+                entry.structs = {};
+                entry.raw_data = {};
+            }
+            std::scoped_lock<std::mutex> lock(this->shared_cache->mutex);
+            this->shared_cache->compiled_tags.emplace(recorder.content_key, std::make_shared<const CompileCache::Entry>(std::move(entry)));
+        }
+    }
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifndef INVADER__BUILD__BUILD_WORKLOAD_CACHE_HPP
+#define INVADER__BUILD__BUILD_WORKLOAD_CACHE_HPP
+
+#include <set>
+#include <invader/build/build_workload.hpp>
+
+namespace Invader {
+    struct BuildWorkload::CompileCacheTagFile {
+        /** Key of the tag's path, class, and contents */
+        std::uint64_t content_key;
+
+        /** CRC32 of the tag data, checked against entries in case of a key collision */
+        std::uint32_t tag_crc;
+
+        /** Size of the tag file, also checked against entries */
+        std::uint64_t tag_size;
+    };
+
+    struct BuildWorkload::CompileCache {
+        /** Workload state a tag must not touch outside of structs and raw data to be reused */
+        struct GlobalState {
+            std::size_t structs;
+            std::size_t raw_data;
+            std::size_t reports;
+            std::size_t model_indices;
+            std::size_t compressed_model_vertices;
+            std::size_t uncompressed_model_vertices;
+            std::size_t model_parts;
+            std::size_t bsp_data;
+            std::size_t bsp_count;
+
+            bool same_globals(const GlobalState &other) const noexcept {
+                return this->reports == other.reports &&
+                       this->model_indices == other.model_indices &&
+                       this->compressed_model_vertices == other.compressed_model_vertices &&
+                       this->uncompressed_model_vertices == other.uncompressed_model_vertices &&
+                       this->model_parts == other.model_parts &&
+                       this->bsp_data == other.bsp_data &&
+                       this->bsp_count == other.bsp_count;
+            }
+        };
+
+        struct Dependency {
+            std::string path;
+            TagFourCC fourcc;
+            std::uint64_t key;
+        };
+
+        struct Segment {
+            std::size_t struct_start;
+            std::size_t struct_end;
+            std::size_t raw_data_start;
+            std::size_t raw_data_end;
+        };
+
+        struct Entry {
+            std::uint64_t key;
+            std::uint32_t tag_crc;
+            std::uint64_t tag_size;
+            bool reusable;
+            std::vector<Dependency> dependencies;
+            std::vector<std::size_t> segment_struct_counts;
+            std::vector<std::size_t> segment_raw_data_counts;
+            std::vector<BuildWorkloadStruct> structs;
+            std::vector<std::vector<std::byte>> raw_data;
+            std::vector<File::TagFilePath> referenced_tags;
+            std::vector<std::size_t> asset_data;
+            std::size_t base_struct;
+        };
+
+        struct Recorder {
+            std::size_t tag_index;
+            std::uint64_t content_key;
+            std::uint32_t tag_crc;
+            std::uint64_t tag_size;
+            bool replaying = false;
+            bool reusable = true;
+            GlobalState segment_start;
+            std::vector<Segment> segments;
+            std::vector<std::pair<std::string, TagFourCC>> dependencies;
+            std::vector<std::size_t> dependency_indices;
+        };
+
+        /** Directory entries are stored in; if unset, entries are only shared with the rest of the batch */
+        std::optional<std::filesystem::path> directory;
+        std::vector<Recorder> recorders;
+
+        /** Tag files looked at so far (std::nullopt if they couldn't be opened) */
+        std::map<File::TagFilePath, std::optional<CompileCacheTagFile>> tag_files;
+
+        /** Full keys of tags in this workload by tag index */
+        std::map<std::size_t, std::uint64_t> tag_keys;
+
+        /** Full keys of tags verified against the cache (std::nullopt if out of date) */
+        std::map<File::TagFilePath, std::optional<std::uint64_t>> verified_keys;
+        std::set<File::TagFilePath> verifying;
+        std::map<File::TagFilePath, std::shared_ptr<const Entry>> verified_entries;
+    };
+
+    struct BuildWorkload::SharedCache {
+        std::mutex mutex;
+
+        /** Tags read and parsed by any workload in the batch, by the tags directories they were found in */
+        std::map<std::vector<std::filesystem::path>, std::map<File::TagFilePath, BuildWorkloadPreloadedTag>> parsed_tags;
+
+        /** Compile cache entries recorded or loaded by any workload in the batch, by content key */
+        std::map<std::uint64_t, std::shared_ptr<const CompileCache::Entry>> compiled_tags;
+    };
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include <unordered_map>
+#include <algorithm>
 #include <invader/build/build_workload.hpp>
 
 namespace Invader {
@@ -11,7 +13,7 @@ namespace Invader {
         
         // Make sure dependencies match
         if(this->dependencies != other.dependencies) {
-            std::vector<BuildWorkloadDependency> this_dep_small;
+            std::pmr::vector<BuildWorkloadDependency> this_dep_small;
             for(auto &td : this->dependencies) {
                 if(td.offset < other_size) {
                     if(td.offset + sizeof(HEK::TagDependency<HEK::LittleEndian>) > other_size) { // other struct only contains part of the dependency
@@ -27,7 +29,7 @@ namespace Invader {
         
         // And now pointers
         if(this->pointers != other.pointers) {
-            std::vector<BuildWorkloadStructPointer> this_ptr_small;
+            std::pmr::vector<BuildWorkloadStructPointer> this_ptr_small;
             for(auto &ptr : this->pointers) {
                 if(ptr.offset < other_size) {
                     this_ptr_small.emplace_back(ptr);
@@ -41,55 +43,192 @@ namespace Invader {
         return std::memcmp(this->data.data(), other.data.data(), other_size) == 0;
     }
 
+    // Number of leading bytes hashed when bucketing structs for prefix matches
+    static constexpr std::size_t DEDUPE_PREFIX_KEY_SIZE = 64;
+
+    // Number of structs in a prefix bucket past which larger structs are looked up by their whole prefix instead
+    static constexpr std::size_t DEDUPE_PREFIX_BUCKET_LIMIT = 32;
+
+    static std::uint64_t dedupe_hash_start(const std::optional<std::size_t> &bsp, std::uint64_t salt) noexcept {
+        std::uint64_t hash = 0xCBF29CE484222325ull ^ salt;
+        hash = (hash ^ (bsp.has_value() ? *bsp + 1 : 0)) * 0x100000001B3ull;
+        return hash;
+    }
+
+    static std::uint64_t dedupe_hash_bytes(std::uint64_t hash, const std::byte *data, std::size_t size) noexcept {
+        for(std::size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<std::uint64_t>(data[i])) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    static std::uint64_t dedupe_hash_value(std::uint64_t hash, std::uint64_t value) noexcept {
+        return dedupe_hash_bytes(hash, reinterpret_cast<const std::byte *>(&value), sizeof(value));
+    }
+
     void BuildWorkload::dedupe_structs() {
-        bool found_something = true;
         std::size_t total_savings = 0;
         std::size_t struct_count = this->structs.size();
 
         oprintf("Optimizing tag space...");
         oflush();
 
-        while(found_something) {
-            found_something = false;
-            for(std::size_t i = 0; i < struct_count; i++) {
-                if(this->structs[i].unsafe_to_dedupe) {
+        using Buckets = std::unordered_map<std::uint64_t, std::vector<std::size_t>>;
+
+        // Fingerprint a struct by everything can_dedupe() looks at for structs of equal size
+        auto full_fingerprint = [](const BuildWorkloadStruct &s) -> std::uint64_t {
+            auto hash = dedupe_hash_start(s.bsp, 0);
+            hash = dedupe_hash_value(hash, s.data.size());
+            hash = dedupe_hash_bytes(hash, s.data.data(), s.data.size());
+            for(auto &d : s.dependencies) {
+                hash = dedupe_hash_value(hash, d.tag_index);
+                hash = dedupe_hash_value(hash, d.offset);
+                hash = dedupe_hash_value(hash, d.tag_id_only);
+            }
+            for(auto &p : s.pointers) {
+                hash = dedupe_hash_value(hash, p.struct_index);
+                hash = dedupe_hash_value(hash, p.offset);
+                hash = dedupe_hash_value(hash, p.struct_data_offset);
+            }
+            return hash;
+        };
+
+        // Fingerprint the first few bytes of a struct so smaller structs can find larger structs that start with them
+        auto prefix_key = [](const std::optional<std::size_t> &bsp, std::size_t length, std::uint64_t data_hash) -> std::uint64_t {
+            return dedupe_hash_value(dedupe_hash_value(dedupe_hash_start(bsp, 1), length), data_hash);
+        };
+
+        std::vector<std::size_t> replacement(struct_count);
+        std::vector<std::size_t> prefix_lengths;
+        std::vector<std::size_t> registered;
+        Buckets full_buckets;
+        Buckets prefix_buckets;
+
+        // Structs bucketed by a hash of their first N bytes, for lengths N of structs that landed in a crowded prefix bucket
+        std::unordered_map<std::size_t, Buckets> long_prefix_buckets;
+        auto long_prefix_key = [&prefix_key](const BuildWorkloadStruct &s, std::size_t length) -> std::uint64_t {
+            return prefix_key(s.bsp, length, dedupe_hash_bytes(0, s.data.data(), length));
+        };
+
+        // Merging structs can make the structs that point to them identical, so keep going until nothing else merges
+        while(true) {
+            std::size_t merged = 0;
+            full_buckets.clear();
+            prefix_buckets.clear();
+            long_prefix_buckets.clear();
+            registered.clear();
+
+            // Every distinct length a smaller struct would need to be looked up by
+            prefix_lengths.clear();
+            for(auto &s : this->structs) {
+                if(!s.unsafe_to_dedupe) {
+                    prefix_lengths.emplace_back(std::min(s.data.size(), DEDUPE_PREFIX_KEY_SIZE));
+                }
+            }
+            std::sort(prefix_lengths.begin(), prefix_lengths.end());
+            prefix_lengths.erase(std::unique(prefix_lengths.begin(), prefix_lengths.end()), prefix_lengths.end());
+
+            for(std::size_t j = 0; j < struct_count; j++) {
+                replacement[j] = j;
+
+                auto &sj = this->structs[j];
+                if(sj.unsafe_to_dedupe) {
                     continue;
                 }
-                for(std::size_t j = i + 1; j < struct_count; j++) {
-                    if(this->structs[j].unsafe_to_dedupe) {
-                        continue;
+
+                // Find the lowest indexed struct this one can be replaced with. Everything in the buckets comes before us and is still live.
+                std::optional<std::size_t> best;
+                auto fingerprint = full_fingerprint(sj);
+                if(auto f = full_buckets.find(fingerprint); f != full_buckets.end()) {
+                    for(auto i : f->second) {
+                        if(this->structs[i].can_dedupe(sj)) {
+                            best = i;
+                            break;
+                        }
                     }
+                }
+
+                auto j_size = sj.data.size();
+                auto j_key_length = std::min(j_size, DEDUPE_PREFIX_KEY_SIZE);
+                auto j_key = prefix_key(sj.bsp, j_key_length, dedupe_hash_bytes(0, sj.data.data(), j_key_length));
+                const std::vector<std::size_t> *candidates = nullptr;
+                if(auto f = prefix_buckets.find(j_key); f != prefix_buckets.end()) {
+                    candidates = &f->second;
+                }
 
-                    // Check if the structs are the same
-                    if(this->structs[i].can_dedupe(this->structs[j])) {
-                        // If so, go through every struct pointer. If they equal j, set to i. If they're greater than j, decrement
-                        for(std::size_t k = 0; k < struct_count; k++) {
-                            for(auto &pointer : this->structs[k].pointers) {
-                                auto &struct_index = pointer.struct_index;
-                                if(struct_index == j) {
-                                    struct_index = i;
-                                }
+                // Structs sharing the first few bytes can pile up in one bucket, so check only the ones that share all of ours
+                if(candidates && j_key_length < j_size && candidates->size() > DEDUPE_PREFIX_BUCKET_LIMIT) {
+                    auto [long_buckets, inserted] = long_prefix_buckets.try_emplace(j_size);
+                    if(inserted) {
+                        for(auto i : registered) {
+                            auto &si = this->structs[i];
+                            if(si.data.size() > j_size) {
+                                long_buckets->second[long_prefix_key(si, j_size)].emplace_back(i);
                             }
                         }
+                    }
+                    auto l = long_buckets->second.find(long_prefix_key(sj, j_size));
+                    candidates = l == long_buckets->second.end() ? nullptr : &l->second;
+                }
 
-                        // Also go through every tag, too
-                        for(auto &tag : this->tags) {
-                            if(tag.base_struct.has_value()) {
-                                auto &base_struct = tag.base_struct.value();
-                                if(base_struct == j) {
-                                    base_struct = i;
-                                }
-                            }
+                if(candidates) {
+                    for(auto i : *candidates) {
+                        if(best.has_value() && i >= *best) {
+                            break;
                         }
+                        if(this->structs[i].can_dedupe(sj)) {
+                            best = i;
+                            break;
+                        }
+                    }
+                }
+
+                if(best.has_value()) {
+                    replacement[j] = *best;
+                    total_savings += j_size;
+                    sj.unsafe_to_dedupe = true;
+                    merged++;
+                    continue;
+                }
 
-                        total_savings += this->structs[j].data.size();
-                        this->structs[j].unsafe_to_dedupe = true;
+                // Nothing found, so later structs may be replaced with this one
+                full_buckets[fingerprint].emplace_back(j);
+                registered.emplace_back(j);
+                for(auto &[length, long_buckets] : long_prefix_buckets) {
+                    if(length < j_size) {
+                        long_buckets[long_prefix_key(sj, length)].emplace_back(j);
+                    }
+                }
 
-                        found_something = true;
+                std::uint64_t data_hash = 0;
+                std::size_t hashed = 0;
+                for(auto length : prefix_lengths) {
+                    if(length >= j_size) {
+                        break;
                     }
+                    data_hash = dedupe_hash_bytes(data_hash, sj.data.data() + hashed, length - hashed);
+                    hashed = length;
+                    prefix_buckets[prefix_key(sj.bsp, length, data_hash)].emplace_back(j);
+                }
+            }
+
+            if(merged == 0) {
+                break;
+            }
+
+            // Go through every struct pointer and every tag once, pointing them to whatever replaced what they pointed to
+            for(auto &s : this->structs) {
+                for(auto &pointer : s.pointers) {
+                    pointer.struct_index = replacement[pointer.struct_index];
+                }
+            }
+            for(auto &tag : this->tags) {
+                if(tag.base_struct.has_value()) {
+                    tag.base_struct = replacement[*tag.base_struct];
                 }
             }
         }
+
         oprintf(" done; reduced tag space usage by %.02f MiB\n", total_savings / 1024.0 / 1024.0);
     }
 }
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cstdio>
+#include <cstring>
+
+#include <invader/build/build_workload.hpp>
+#include <invader/printf.hpp>
+#include "../crc/crc32.h"
+#include "../crc/crc_spoof.h"
+
+namespace Invader {
+    using namespace HEK;
+
+    // Call the given function on every piece of the given range of the file in order, with padding between sections as zeroes
+    template <typename F> static void for_each_cache_file_range(const std::vector<BuildWorkload::CacheFileSection> &sections, std::size_t file_size, std::size_t start, std::size_t end, F function) {
+        static constexpr std::byte ZEROES[4096] = {};
+
+        if(start > end || end > file_size) {
+            throw OutOfBoundsException();
+        }
+
+        auto zeroes = [&function](std::size_t size) {
+            while(size > 0) {
+                auto amount = std::min(size, sizeof(ZEROES));
+                function(ZEROES, amount);
+                size -= amount;
+            }
+        };
+
+        auto offset = start;
+        for(auto &s : sections) {
+            auto section_end = s.offset + s.size;
+            if(section_end <= offset) {
+                continue;
+            }
+            if(s.offset >= end) {
+                break;
+            }
+            if(s.offset > offset) {
+                zeroes(s.offset - offset);
+                offset = s.offset;
+            }
+            auto amount = std::min(section_end, end) - offset;
+            function(s.data + (offset - s.offset), amount);
+            offset += amount;
+        }
+        zeroes(end - offset);
+    }
+
+    std::uint32_t BuildWorkload::calculate_cache_file_crc(const std::vector<CacheFileSection> &sections, std::size_t file_size, std::size_t model_offset, std::size_t model_data_size, std::size_t tag_data_offset, std::size_t tag_data_size) {
+        // Get everything that goes into the CRC32 in the order it goes in; see calculate_map_crc()
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        auto cache_version = this->parameters->details.build_cache_file_engine;
+        auto &tag_data = this->map_data_structs[0];
+
+        if(cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
+            auto &scenario_struct = this->structs[*this->tags[this->scenario_index].base_struct];
+            const auto &scenario = *reinterpret_cast<const Parser::Scenario::struct_little *>(tag_data.data() + *scenario_struct.offset);
+            std::size_t bsp_count = scenario.structure_bsps.count.read();
+            if(bsp_count > 0) {
+                auto bsps_struct_index = *scenario_struct.resolve_pointer(&reinterpret_cast<const Parser::Scenario::struct_little *>(scenario_struct.data.data())->structure_bsps.pointer);
+                const auto *bsps = reinterpret_cast<const Parser::ScenarioBSP::struct_little *>(tag_data.data() + *this->structs[bsps_struct_index].offset);
+
+                for(std::size_t b = 0; b < bsp_count; b++) {
+                    std::size_t start = bsps[b].bsp_start.read();
+                    std::size_t end = start + bsps[b].bsp_size.read();
+
+                    // If it's MCC, CRC32 the vertex data
+                    if(cache_version == HEK::CacheFileEngine::CACHE_FILE_MCC_CEA) {
+                        HEK::ScenarioStructureBSPCompiledHeaderCEA<HEK::LittleEndian> header;
+                        auto *header_bytes = reinterpret_cast<std::byte *>(&header);
+                        for_each_cache_file_range(sections, file_size, start, start + sizeof(header), [&header_bytes](const std::byte *data, std::size_t size) {
+                            std::memcpy(header_bytes, data, size);
+                            header_bytes += size;
+                        });
+                        if(header.lightmap_vertex_size.read() > 0) {
+                            ranges.emplace_back(header.lightmap_vertices.read(), header.lightmap_vertices.read() + header.lightmap_vertex_size.read());
+                        }
+                    }
+
+                    ranges.emplace_back(start, end);
+                }
+            }
+        }
+
+        ranges.emplace_back(model_offset, model_offset + model_data_size);
+        ranges.emplace_back(tag_data_offset, tag_data_offset + tag_data_size);
+
+        auto &tag_file_checksums = reinterpret_cast<HEK::CacheFileTagDataHeader *>(tag_data.data())->tag_file_checksums;
+
+        std::uint32_t crc = 0;
+        for(auto &r : ranges) {
+            for_each_cache_file_range(sections, file_size, r.first, r.second, [&crc, this](const std::byte *data, std::size_t size) {
+                crc = crc32_parallel(crc, data, size, this->parameters->thread_count);
+            });
+        }
+
+        // If we're forging, change the random number at the start of the tag data to get the CRC32 we want. Only the
+        // tag data comes after it, so the CRC32 we already have is all we need to work out what it should be.
+        if(this->parameters->forge_crc.has_value()) {
+            auto forged_crc = *this->parameters->forge_crc;
+            std::size_t tag_file_checksums_distance = tag_data_size - (reinterpret_cast<const std::byte *>(&tag_file_checksums) - tag_data.data());
+            tag_file_checksums = tag_file_checksums.read() ^ crc_spoof_calculate_patch(crc_spoof_reverse_bits(crc), ~crc_spoof_reverse_bits(forged_crc), tag_file_checksums_distance);
+            return forged_crc;
+        }
+
+        return ~crc;
+    }
+
+    std::vector<std::byte> BuildWorkload::assemble_cache_file(const std::vector<CacheFileSection> &sections, std::size_t file_size) {
+        std::vector<std::byte> data;
+        data.reserve(file_size);
+        for_each_cache_file_range(sections, file_size, 0, file_size, [&data](const std::byte *section_data, std::size_t size) {
+            data.insert(data.end(), section_data, section_data + size);
+        });
+        return data;
+    }
+
+    void BuildWorkload::save_cache_file(const std::filesystem::path &path, const std::vector<CacheFileSection> &sections, std::size_t file_size) {
+        // Write to a temporary file next to it first, so a failed write doesn't take out whatever map was already there
+        auto path_string = path.string();
+        auto temp_path = path;
+        temp_path += ".tmp";
+        auto temp_path_string = temp_path.string();
+        std::FILE *f = std::fopen(temp_path_string.c_str(), "wb");
+        if(!f) {
+            eprintf_error("Failed to open %s for writing", temp_path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        bool success = true;
+        try {
+            for_each_cache_file_range(sections, file_size, 0, file_size, [&f, &success](const std::byte *data, std::size_t size) {
+                if(success && std::fwrite(data, size, 1, f) != 1) {
+                    success = false;
+                }
+            });
+        }
+        catch(std::exception &) {
+            std::fclose(f);
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            throw;
+        }
+
+        std::error_code ec;
+        if(std::fclose(f) != 0 || !success) {
+            std::filesystem::remove(temp_path, ec);
+            eprintf_error("Failed to write to %s", temp_path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        std::filesystem::rename(temp_path, path, ec);
+        if(ec) {
+            std::filesystem::remove(temp_path, ec);
+            eprintf_error("Failed to write to %s", path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+    }
+}
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+
+#include <invader/build/build_workload.hpp>
+#include <invader/file/file.hpp>
+#include <invader/tag/hek/header.hpp>
+#include <invader/printf.hpp>
+#include "../crc/crc32.h"
+
+namespace Invader {
+    using namespace HEK;
+
+    std::optional<BuildWorkload::BuildWorkloadPreloadedTag> BuildWorkload::preload_tag(const std::vector<std::byte> &tag_file, TagFourCC tag_fourcc, bool hash_file) {
+        // Only take tags that can be read without printing anything, since this may not be on the main thread and the
+        // build may never get to this tag. Anything else is parsed again when it's compiled, which reports the error.
+        if(tag_file.size() < sizeof(TagFileHeader)) {
+            return std::nullopt;
+        }
+        const auto *header = reinterpret_cast<const TagFileHeader *>(tag_file.data());
+        auto header_fourcc = header->tag_fourcc.read();
+        if(header->blam != TagFileHeader::BLAM || header_fourcc != tag_fourcc || header->version != TagFileHeader::version_for_tag(header_fourcc)) {
+            return std::nullopt;
+        }
+
+        // Parse it, keeping anything the parser prints to ourselves. If it has anything to say, the tag is parsed again when
+        // it's compiled, which reports it.
+        std::string parser_output;
+        std::unique_ptr<Parser::ParserStruct> parsed;
+        set_stderr_capture(&parser_output);
+        auto parse_start = std::chrono::steady_clock::now();
+        try {
+            parsed = Parser::ParserStruct::parse_hek_tag_file(tag_file.data(), tag_file.size(), true);
+        }
+        catch(std::exception &) {}
+        auto parse_time = std::chrono::steady_clock::now() - parse_start;
+        set_stderr_capture(nullptr);
+        if(!parsed || !parser_output.empty()) {
+            return std::nullopt;
+        }
+
+        // Take the dependencies from what we just parsed rather than going through the tag data again
+        BuildWorkloadPreloadedTag preloaded;
+        auto dependencies = parsed->get_dependencies();
+        preloaded.dependencies.reserve(dependencies.size());
+        for(auto *d : dependencies) {
+            preloaded.dependencies.emplace_back(File::remove_duplicate_slashes(d->path), d->tag_fourcc);
+        }
+        preloaded.header_crc = header->crc32;
+        preloaded.calculated_crc = ~crc32(0, header + 1, tag_file.size() - sizeof(*header));
+        preloaded.file_size = tag_file.size();
+        if(hash_file) {
+            preloaded.file_hash = compile_cache_file_hash(tag_file);
+        }
+        preloaded.parsed = std::move(parsed);
+        preloaded.parse_time = parse_time;
+        return preloaded;
+    }
+
+    void BuildWorkload::preload_tags() {
+        // Read and parse everything we can find ahead of time. Nothing is printed here. Anything we miss or fail to read is
+        // simply read again when compiled, so errors are reported (and tag indices assigned) in the same order as a
+        // single-threaded build, and only for tags the build actually uses.
+        std::mutex preload_mutex;
+        std::condition_variable preload_condition;
+        std::deque<File::TagFilePath> queue;
+        std::set<File::TagFilePath> queued;
+        std::size_t busy = 0;
+
+        const auto &tags_directories = this->parameters->tags_directories;
+        const auto &required_tags = this->parameters->details.build_required_tags;
+        auto &preloaded_tags = this->preloaded_tags;
+        bool hash_file = this->compile_cache != nullptr;
+
+        // The mutex must be held when calling these
+        auto enqueue = [&queue, &queued](const std::string &path, TagFourCC fourcc) {
+            File::TagFilePath tag_path(File::remove_duplicate_slashes(path), fourcc);
+            if(queued.insert(tag_path).second) {
+                queue.emplace_back(std::move(tag_path));
+            }
+        };
+        auto enqueue_all = [&enqueue](const GameEngineInfo::RequiredTags::TagPairPtrArray &what) {
+            for(std::size_t c = 0; c < what.count; c++) {
+                enqueue(what.ptr[c].path, what.ptr[c].fourcc);
+            }
+        };
+
+        auto scenario_path = File::remove_duplicate_slashes(this->scenario);
+        enqueue(scenario_path, TagFourCC::TAG_FOURCC_SCENARIO);
+        enqueue_all(required_tags.all);
+
+        auto preload_worker = [&]() {
+            std::unique_lock<std::mutex> lock(preload_mutex);
+            while(true) {
+                // Stop once there is nothing left and nobody else can add anything
+                preload_condition.wait(lock, [&queue, &busy]() { return !queue.empty() || busy == 0; });
+                if(queue.empty()) {
+                    return;
+                }
+
+                auto tag_path = std::move(queue.front());
+                queue.pop_front();
+                busy++;
+                lock.unlock();
+
+                std::optional<BuildWorkloadPreloadedTag> preloaded;
+                std::vector<File::TagFilePath> dependencies;
+                const GameEngineInfo::RequiredTags::TagPairPtrArray *scenario_required_tags[2] = {};
+
+                try {
+                    // Another map in this batch may have already read it
+                    if(this->shared_cache) {
+                        preloaded = this->find_shared_tag(tag_path);
+                    }
+                    if(!preloaded.has_value()) {
+                        auto file_path = File::tag_path_to_file_path(tag_path, tags_directories);
+                        auto tag_file = file_path.has_value() ? File::open_file(*file_path) : std::nullopt;
+                        if(tag_file.has_value()) {
+                            preloaded = preload_tag(*tag_file, tag_path.fourcc, hash_file);
+                        }
+                        if(preloaded.has_value() && this->shared_cache) {
+                            this->add_shared_tag(tag_path, *preloaded);
+                        }
+                    }
+
+                    if(preloaded.has_value()) {
+                        dependencies = preloaded->dependencies;
+
+                        // Now that we know what kind of scenario this is, we know what else is required
+                        if(tag_path.fourcc == TagFourCC::TAG_FOURCC_SCENARIO && tag_path.path == scenario_path) {
+                            auto &scenario = dynamic_cast<const Parser::Scenario &>(*preloaded->parsed);
+                            bool demo = scenario.flags & ScenarioFlagsFlag::SCENARIO_FLAGS_FLAG_USE_DEMO_UI;
+                            switch(scenario.type) {
+                                case ScenarioType::SCENARIO_TYPE_SINGLEPLAYER:
+                                    scenario_required_tags[0] = &required_tags.singleplayer;
+                                    scenario_required_tags[1] = demo ? &required_tags.singleplayer_demo : &required_tags.singleplayer_full;
+                                    break;
+                                case ScenarioType::SCENARIO_TYPE_MULTIPLAYER:
+                                    scenario_required_tags[0] = &required_tags.multiplayer;
+                                    scenario_required_tags[1] = demo ? &required_tags.multiplayer_demo : &required_tags.multiplayer_full;
+                                    break;
+                                case ScenarioType::SCENARIO_TYPE_USER_INTERFACE:
+                                    scenario_required_tags[0] = &required_tags.user_interface;
+                                    scenario_required_tags[1] = demo ? &required_tags.user_interface_demo : &required_tags.user_interface_full;
+                                    break;
+                                default:
+                                    break;
+                            }
+                        }
+                    }
+                }
+                catch(std::exception &) {
+                    preloaded = std::nullopt;
+                    dependencies.clear();
+                }
+
+                lock.lock();
+                if(preloaded.has_value()) {
+                    preloaded_tags.emplace(tag_path, std::move(*preloaded));
+                }
+                for(auto &d : dependencies) {
+                    enqueue(d.path, d.fourcc);
+                }
+                for(auto *r : scenario_required_tags) {
+                    if(r) {
+                        enqueue_all(*r);
+                    }
+                }
+                busy--;
+                preload_condition.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(this->parameters->thread_count);
+        for(std::size_t i = 0; i < this->parameters->thread_count; i++) {
+            threads.emplace_back(preload_worker);
+        }
+        for(auto &i : threads) {
+            i.join();
+        }
+    }
+}
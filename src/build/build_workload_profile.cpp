@@ -0,0 +1,349 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <ctime>
+#include <sys/resource.h>
+#endif
+
+#include <cstdio>
+#include <algorithm>
+
+#include <invader/build/build_workload.hpp>
+#include <invader/file/file.hpp>
+#include <invader/printf.hpp>
+
+namespace Invader {
+    // Number of tags to list in the summary
+    static constexpr std::size_t PROFILE_SLOWEST_TAG_COUNT = 25;
+
+    struct BuildWorkload::Profile {
+        struct Counters {
+            std::chrono::steady_clock::time_point wall;
+            std::uint64_t cpu_ns;
+            std::size_t allocations;
+        };
+
+        struct Phase {
+            const char *name;
+            Counters start;
+            std::uint64_t start_us = 0;
+            std::uint64_t wall_us = 0;
+            std::uint64_t cpu_us = 0;
+            std::size_t allocations = 0;
+            std::size_t peak_rss = 0;
+        };
+
+        struct TagTimer {
+            std::size_t tag_index;
+            Counters start;
+            std::chrono::steady_clock::duration parse_time {};
+
+            // Parsing done while timing this tag rather than ahead of time
+            std::chrono::steady_clock::duration parse_time_here {};
+
+            // Everything spent on compiling dependencies while compiling this tag
+            std::chrono::steady_clock::duration dependency_wall {};
+            std::uint64_t dependency_cpu_ns = 0;
+            std::size_t dependency_allocations = 0;
+        };
+
+        struct Tag {
+            std::size_t tag_index;
+            std::uint64_t start_us;
+            std::uint64_t total_us;
+            std::uint64_t parse_us;
+            std::uint64_t compile_us;
+            std::uint64_t cpu_us;
+            std::size_t allocations;
+            bool replayed;
+        };
+
+        Counters start;
+        std::vector<Phase> phases;
+        std::vector<TagTimer> tag_stack;
+        std::vector<Tag> tags;
+    };
+
+    // CPU time used by the whole process, as phases may be spread across multiple threads
+    static std::uint64_t profile_process_cpu_time_ns() noexcept {
+        #ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+        return ((static_cast<std::uint64_t>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime) + (static_cast<std::uint64_t>(user.dwHighDateTime) << 32 | user.dwLowDateTime)) * 100;
+        #else
+        timespec t;
+        if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>(t.tv_sec) * 1000000000 + static_cast<std::uint64_t>(t.tv_nsec);
+        #endif
+    }
+
+    // CPU time used by this thread, as other maps in a batch may be building at the same time
+    static std::uint64_t profile_thread_cpu_time_ns() noexcept {
+        #ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if(!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+        return ((static_cast<std::uint64_t>(kernel.dwHighDateTime) << 32 | kernel.dwLowDateTime) + (static_cast<std::uint64_t>(user.dwHighDateTime) << 32 | user.dwLowDateTime)) * 100;
+        #else
+        timespec t;
+        if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0) {
+            return 0;
+        }
+        return static_cast<std::uint64_t>(t.tv_sec) * 1000000000 + static_cast<std::uint64_t>(t.tv_nsec);
+        #endif
+    }
+
+    static std::size_t profile_peak_rss() noexcept {
+        #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+        #else
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+        #ifdef __APPLE__
+        return static_cast<std::size_t>(usage.ru_maxrss);
+        #else
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+        #endif
+        #endif
+    }
+
+    static std::uint64_t profile_us(std::chrono::steady_clock::duration duration) noexcept {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    void BuildWorkload::profile_begin() {
+        this->profile = std::make_shared<Profile>();
+        this->profile->start = { this->start, profile_process_cpu_time_ns(), this->struct_arena->get_allocations() };
+    }
+
+    std::size_t BuildWorkload::profile_begin_phase(const char *name) {
+        if(!this->profile) {
+            return 0;
+        }
+        auto &phase = this->profile->phases.emplace_back();
+        phase.name = name;
+        phase.start = { std::chrono::steady_clock::now(), profile_process_cpu_time_ns(), this->struct_arena->get_allocations() };
+        phase.start_us = profile_us(phase.start.wall - this->profile->start.wall);
+        return this->profile->phases.size() - 1;
+    }
+
+    void BuildWorkload::profile_end_phase(std::size_t phase_index) {
+        if(!this->profile) {
+            return;
+        }
+        auto &phase = this->profile->phases[phase_index];
+        phase.wall_us = profile_us(std::chrono::steady_clock::now() - phase.start.wall);
+        phase.cpu_us = (profile_process_cpu_time_ns() - phase.start.cpu_ns) / 1000;
+        phase.allocations = this->struct_arena->get_allocations() - phase.start.allocations;
+        phase.peak_rss = profile_peak_rss();
+    }
+
+    void BuildWorkload::profile_begin_tag(std::size_t tag_index) {
+        if(!this->profile) {
+            return;
+        }
+        auto &timer = this->profile->tag_stack.emplace_back();
+        timer.tag_index = tag_index;
+        timer.start = { std::chrono::steady_clock::now(), profile_thread_cpu_time_ns(), this->struct_arena->get_allocations() };
+    }
+
+    void BuildWorkload::profile_tag_parsed(std::chrono::steady_clock::duration parse_time, bool preloaded) {
+        if(!this->profile || this->profile->tag_stack.empty()) {
+            return;
+        }
+        auto &timer = this->profile->tag_stack.back();
+        timer.parse_time += parse_time;
+        if(!preloaded) {
+            timer.parse_time_here += parse_time;
+        }
+    }
+
+    void BuildWorkload::profile_end_tag(bool replayed) {
+        if(!this->profile || this->profile->tag_stack.empty()) {
+            return;
+        }
+
+        auto &profile = *this->profile;
+        auto timer = profile.tag_stack.back();
+        profile.tag_stack.pop_back();
+
+        auto wall = std::chrono::steady_clock::now() - timer.start.wall;
+        auto cpu_ns = profile_thread_cpu_time_ns() - timer.start.cpu_ns;
+        auto allocations = this->struct_arena->get_allocations() - timer.start.allocations;
+
+        // Dependencies get their own entries, so leave them out of this one
+        auto exclusive_wall = wall - timer.dependency_wall;
+        auto compile_time = exclusive_wall - timer.parse_time_here;
+        auto &tag = profile.tags.emplace_back();
+        tag.tag_index = timer.tag_index;
+        tag.start_us = profile_us(timer.start.wall - profile.start.wall);
+        tag.total_us = profile_us(wall);
+        tag.parse_us = profile_us(timer.parse_time);
+        tag.compile_us = profile_us(std::max(compile_time, std::chrono::steady_clock::duration {}));
+        tag.cpu_us = (cpu_ns - std::min(cpu_ns, timer.dependency_cpu_ns)) / 1000;
+        tag.allocations = allocations - std::min(allocations, timer.dependency_allocations);
+        tag.replayed = replayed;
+
+        if(!profile.tag_stack.empty()) {
+            auto &parent = profile.tag_stack.back();
+            parent.dependency_wall += wall;
+            parent.dependency_cpu_ns += cpu_ns;
+            parent.dependency_allocations += allocations;
+        }
+    }
+
+    static void profile_write_string(std::FILE *f, const std::string &string) {
+        std::fputc('"', f);
+        for(char c : string) {
+            switch(c) {
+                case '"':
+                    std::fputs("\\\"", f);
+                    break;
+                case '\\':
+                    std::fputs("\\\\", f);
+                    break;
+                default:
+                    if(static_cast<unsigned char>(c) < 0x20) {
+                        std::fprintf(f, "\\u%04x", static_cast<unsigned char>(c));
+                    }
+                    else {
+                        std::fputc(c, f);
+                    }
+                    break;
+            }
+        }
+        std::fputc('"', f);
+    }
+
+    void BuildWorkload::profile_save() {
+        if(!this->profile) {
+            return;
+        }
+
+        auto &profile = *this->profile;
+        auto path_string = this->parameters->profile_path->string();
+        std::FILE *f = std::fopen(path_string.c_str(), "w");
+        if(!f) {
+            eprintf_error("Failed to open %s for writing", path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        auto tag_name = [this](std::size_t tag_index) {
+            auto &tag = this->tags[tag_index];
+            return File::halo_path_to_preferred_path(tag.path) + "." + tag_fourcc_to_extension(tag.tag_fourcc);
+        };
+        auto ms = [](std::uint64_t us) {
+            return us / 1000.0;
+        };
+
+        if(this->parameters->profile_format == BuildParameters::ProfileFormat::PROFILE_FORMAT_CHROME_TRACE) {
+            // Phases and tags are all on one thread, so tags nest under the phase (and the tags) that compiled them
+            std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            bool first = true;
+            for(auto &p : profile.phases) {
+                std::fprintf(f, "%s\n{\"name\":", first ? "" : ",");
+                profile_write_string(f, p.name);
+                std::fprintf(f, ",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,\"args\":{\"cpu_ms\":%.03f,\"struct_allocations\":%zu,\"peak_rss_bytes\":%zu}}", static_cast<unsigned long long>(p.start_us), static_cast<unsigned long long>(p.wall_us), ms(p.cpu_us), p.allocations, p.peak_rss);
+                first = false;
+            }
+            for(auto &t : profile.tags) {
+                std::fprintf(f, "%s\n{\"name\":", first ? "" : ",");
+                profile_write_string(f, tag_name(t.tag_index));
+                std::fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,\"args\":{\"parse_ms\":%.03f,\"compile_ms\":%.03f,\"cpu_ms\":%.03f,\"struct_allocations\":%zu}}", t.replayed ? "replayed tag" : "tag", static_cast<unsigned long long>(t.start_us), static_cast<unsigned long long>(t.total_us), ms(t.parse_us), ms(t.compile_us), ms(t.cpu_us), t.allocations);
+                first = false;
+            }
+            std::fprintf(f, "\n]}\n");
+        }
+        else {
+            // Overall
+            auto total_us = profile_us(std::chrono::steady_clock::now() - profile.start.wall);
+            auto total_cpu_us = (profile_process_cpu_time_ns() - profile.start.cpu_ns) / 1000;
+            std::fprintf(f, "{\n  \"scenario\": ");
+            profile_write_string(f, this->scenario_name.string);
+            std::fprintf(f, ",\n  \"wall_ms\": %.03f,\n  \"cpu_ms\": %.03f,\n  \"struct_allocations\": %zu,\n  \"peak_rss_bytes\": %zu,\n", ms(total_us), ms(total_cpu_us), this->struct_arena->get_allocations() - profile.start.allocations, profile_peak_rss());
+
+            // Each phase
+            std::fprintf(f, "  \"phases\": [");
+            for(std::size_t p = 0; p < profile.phases.size(); p++) {
+                auto &phase = profile.phases[p];
+                std::fprintf(f, "%s\n    {\"name\": ", p == 0 ? "" : ",");
+                profile_write_string(f, phase.name);
+                std::fprintf(f, ", \"wall_ms\": %.03f, \"cpu_ms\": %.03f, \"struct_allocations\": %zu, \"peak_rss_bytes\": %zu}", ms(phase.wall_us), ms(phase.cpu_us), phase.allocations, phase.peak_rss);
+            }
+            std::fprintf(f, "\n  ],\n");
+
+            // Each tag class, slowest first
+            struct ClassTotals {
+                TagFourCC tag_fourcc;
+                std::size_t count = 0;
+                std::size_t replayed = 0;
+                std::uint64_t parse_us = 0;
+                std::uint64_t compile_us = 0;
+                std::uint64_t cpu_us = 0;
+                std::size_t allocations = 0;
+            };
+            std::vector<ClassTotals> classes;
+            for(auto &t : profile.tags) {
+                auto tag_fourcc = this->tags[t.tag_index].tag_fourcc;
+                auto c = std::find_if(classes.begin(), classes.end(), [&tag_fourcc](const ClassTotals &c) { return c.tag_fourcc == tag_fourcc; });
+                if(c == classes.end()) {
+                    c = classes.emplace(classes.end());
+                    c->tag_fourcc = tag_fourcc;
+                }
+                c->count++;
+                c->replayed += t.replayed;
+                c->parse_us += t.parse_us;
+                c->compile_us += t.compile_us;
+                c->cpu_us += t.cpu_us;
+                c->allocations += t.allocations;
+            }
+            std::sort(classes.begin(), classes.end(), [](const ClassTotals &a, const ClassTotals &b) { return a.parse_us + a.compile_us > b.parse_us + b.compile_us; });
+
+            std::fprintf(f, "  \"classes\": [");
+            for(std::size_t i = 0; i < classes.size(); i++) {
+                auto &c = classes[i];
+                std::fprintf(f, "%s\n    {\"class\": \"%s\", \"tags\": %zu, \"replayed\": %zu, \"parse_ms\": %.03f, \"compile_ms\": %.03f, \"cpu_ms\": %.03f, \"struct_allocations\": %zu}", i == 0 ? "" : ",", tag_fourcc_to_extension(c.tag_fourcc), c.count, c.replayed, ms(c.parse_us), ms(c.compile_us), ms(c.cpu_us), c.allocations);
+            }
+            std::fprintf(f, "\n  ],\n");
+
+            // And the slowest tags
+            std::vector<const Profile::Tag *> slowest;
+            slowest.reserve(profile.tags.size());
+            for(auto &t : profile.tags) {
+                slowest.emplace_back(&t);
+            }
+            auto slowest_count = std::min(slowest.size(), PROFILE_SLOWEST_TAG_COUNT);
+            std::partial_sort(slowest.begin(), slowest.begin() + slowest_count, slowest.end(), [](const Profile::Tag *a, const Profile::Tag *b) { return a->parse_us + a->compile_us > b->parse_us + b->compile_us; });
+
+            std::fprintf(f, "  \"slowest_tags\": [");
+            for(std::size_t i = 0; i < slowest_count; i++) {
+                auto &t = *slowest[i];
+                std::fprintf(f, "%s\n    {\"tag\": ", i == 0 ? "" : ",");
+                profile_write_string(f, tag_name(t.tag_index));
+                std::fprintf(f, ", \"replayed\": %s, \"parse_ms\": %.03f, \"compile_ms\": %.03f, \"cpu_ms\": %.03f, \"struct_allocations\": %zu}", t.replayed ? "true" : "false", ms(t.parse_us), ms(t.compile_us), ms(t.cpu_us), t.allocations);
+            }
+            std::fprintf(f, "\n  ]\n}\n");
+        }
+
+        bool write_failed = std::ferror(f);
+        if(std::fclose(f) != 0 || write_failed) {
+            eprintf_error("Failed to write to %s", path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+    }
+}
@@ -261,28 +261,21 @@ int main(int argc, const char **argv) {
             // If we don't have a maps directory explicitly set, use the current directory of the map
             auto maps = i.maps.value_or(std::filesystem::absolute(*i.map).parent_path());
             // Load resource maps
-            std::vector<std::byte> loc, bitmaps, sounds;
+            std::optional<std::filesystem::path> loc, bitmaps, sounds;
             if(!i.ignore_resource_maps) {
-                auto open_if_present = [](const std::filesystem::path &path) -> std::vector<std::byte> {
-                    if(std::filesystem::exists(path)) {
-                        return File::open_file(path).value_or(std::vector<std::byte>());
-                    }
-                    else {
-                        return {};
-                    }
-                };
-                loc = open_if_present(maps / "loc.map");
-                bitmaps = open_if_present(maps / "bitmaps.map");
-                sounds = open_if_present(maps / "sounds.map");
+                loc = maps / "loc.map";
+                bitmaps = maps / "bitmaps.map";
+                sounds = maps / "sounds.map";
             }
 
-            auto data = File::open_file(*i.map);
-            if(!data.has_value()) {
+            try {
+                i.map_data = std::make_unique<Map>(Map::map_with_mapping(*i.map, bitmaps, loc, sounds));
+            }
+            catch(FailedToOpenFileException &) {
                 eprintf_error("Failed to read %s", i.map->string().c_str());
                 return EXIT_FAILURE;
             }
-
-            auto &map = *(i.map_data = std::make_unique<Map>(Map::map_with_move(*std::move(data),std::move(bitmaps),std::move(loc),std::move(sounds))));
+            auto &map = *i.map_data;
 
             // Warn if we failed to open some resource maps
             if(!i.ignore_resource_maps) {
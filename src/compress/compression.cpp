@@ -3,7 +3,11 @@
 #include <invader/compress/compression.hpp>
 #include <invader/map/map.hpp>
 #include <invader/file/file.hpp>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
 #include <thread>
 #include <filesystem>
 #include <mutex>
@@ -13,96 +17,560 @@
 #endif
 
 namespace Invader::Compression {
-    std::size_t compress_map_data(const std::byte *data, std::size_t data_size, std::byte *output, std::size_t output_size, int compression_level) {
+    #ifndef DISABLE_ZLIB
+    // Each block is compressed on its own, using the end of the previous block as a dictionary so we barely lose anything
+    static constexpr std::size_t DEFLATE_BLOCK_SIZE = 1024 * 1024;
+    static constexpr std::size_t DEFLATE_DICTIONARY_SIZE = 32 * 1024;
+
+    // Compress one block into a raw DEFLATE stream that ends on a byte boundary, with the final bit set only on the last block
+    static std::vector<std::byte> deflate_block(const std::byte *data, std::size_t offset, std::size_t size, bool last, int compression_level) {
+        z_stream deflate_stream = {};
+        deflate_stream.zalloc = Z_NULL;
+        deflate_stream.zfree = Z_NULL;
+        deflate_stream.opaque = Z_NULL;
+        if(deflateInit2(&deflate_stream, compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw CompressionFailureException();
+        }
+
+        std::vector<std::byte> output;
+        bool success = true;
+        if(offset > 0) {
+            auto dictionary_size = std::min(offset, DEFLATE_DICTIONARY_SIZE);
+            success = deflateSetDictionary(&deflate_stream, reinterpret_cast<const Bytef *>(data + offset - dictionary_size), static_cast<uInt>(dictionary_size)) == Z_OK;
+        }
+
+        // A sync flush ends with an empty stored block, so the next block can start on a byte boundary
+        output.resize(deflateBound(&deflate_stream, size) + 16);
+        deflate_stream.avail_in = static_cast<uInt>(size);
+        deflate_stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(data + offset));
+        int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        while(success) {
+            deflate_stream.avail_out = static_cast<uInt>(output.size() - deflate_stream.total_out);
+            deflate_stream.next_out = reinterpret_cast<Bytef *>(output.data() + deflate_stream.total_out);
+            auto result = deflate(&deflate_stream, flush);
+            if(result == Z_STREAM_END || (result == Z_OK && !last && deflate_stream.avail_in == 0 && deflate_stream.avail_out > 0)) {
+                break;
+            }
+            else if(result != Z_OK && result != Z_BUF_ERROR) {
+                success = false;
+            }
+            else {
+                output.resize(output.size() * 2);
+            }
+        }
+
+        // deflateEnd() complains if the stream was never finished, which is intended for every block but the last
+        output.resize(deflate_stream.total_out);
+        auto end_result = deflateEnd(&deflate_stream);
+        if(!success || (end_result != Z_OK && (last || end_result != Z_DATA_ERROR))) {
+            throw CompressionFailureException();
+        }
+        return output;
+    }
+
+    // Compress the data into one zlib stream on multiple threads, passing the output to the writer in order
+    template <typename F> static std::size_t deflate_parallel(const std::byte *data, std::size_t data_size, int compression_level, std::size_t thread_count, F writer) {
+        std::size_t block_count = std::max(static_cast<std::size_t>(1), (data_size + DEFLATE_BLOCK_SIZE - 1) / DEFLATE_BLOCK_SIZE);
+        if(thread_count == 0) {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        thread_count = std::min(thread_count, block_count);
+
+        struct Block {
+            std::vector<std::byte> output;
+            std::uint32_t adler;
+            bool done = false;
+        };
+        std::vector<Block> blocks(block_count);
+        std::size_t next_block = 0;
+        std::size_t next_write = 0;
+        std::atomic<bool> failed = false;
+        std::mutex mutex;
+        std::condition_variable progress;
+
+        // Don't let finished blocks pile up in memory if writing them out is slower than compressing them
+        const std::size_t max_blocks_in_flight = thread_count * 2;
+
+        auto block_length = [&data_size](std::size_t b) {
+            return std::min(data_size - b * DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
+        };
+
+        // Compress the next block nobody has taken yet, returning false if there isn't one (or if there's no room for one and wait isn't set)
+        auto compress_next_block = [&](bool wait) -> bool {
+            std::size_t b;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto has_room = [&]() { return next_block < next_write + max_blocks_in_flight; };
+                if(wait) {
+                    progress.wait(lock, [&]() { return failed || next_block >= block_count || has_room(); });
+                }
+                if(next_block >= block_count || failed || !has_room()) {
+                    return false;
+                }
+                b = next_block++;
+            }
+            try {
+                auto offset = b * DEFLATE_BLOCK_SIZE;
+                auto length = block_length(b);
+                auto output = deflate_block(data, offset, length, b + 1 == block_count, compression_level);
+                auto adler = static_cast<std::uint32_t>(adler32(adler32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(data + offset), static_cast<uInt>(length)));
+                std::scoped_lock<std::mutex> lock(mutex);
+                blocks[b].output = std::move(output);
+                blocks[b].adler = adler;
+                blocks[b].done = true;
+            }
+            catch(std::exception &) {
+                std::scoped_lock<std::mutex> lock(mutex);
+                failed = true;
+            }
+            progress.notify_all();
+            return true;
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        try {
+            for(std::size_t t = 1; t < thread_count; t++) {
+                threads.emplace_back([&compress_next_block]() {
+                    while(compress_next_block(true));
+                });
+            }
+        }
+        catch(std::system_error &) {
+            // Whatever we couldn't start a thread for, we'll do ourselves
+        }
+
+        auto write_bytes = [&writer](std::initializer_list<std::uint8_t> bytes) {
+            std::byte buffer[4];
+            std::size_t size = 0;
+            for(auto b : bytes) {
+                buffer[size++] = static_cast<std::byte>(b);
+            }
+            writer(buffer, size);
+        };
+
+        // Write blocks as they finish, helping out with compressing them if the next one isn't done yet
+        std::size_t total_size = 0;
+        std::uint32_t adler = static_cast<std::uint32_t>(adler32(0, Z_NULL, 0));
+        try {
+            // zlib header, indicating a 32 KiB window and roughly what level was used
+            std::uint8_t cmf = 0x78;
+            auto flg = static_cast<std::uint8_t>((compression_level < 2 ? 0 : compression_level < 6 ? 1 : compression_level == 6 ? 2 : 3) << 6);
+            flg += static_cast<std::uint8_t>(31 - (cmf * 256 + flg) % 31);
+            write_bytes({ cmf, flg });
+            total_size += 2;
+
+            for(std::size_t b = 0; b < block_count; b++) {
+                std::unique_lock<std::mutex> lock(mutex);
+                while(!blocks[b].done && !failed) {
+                    lock.unlock();
+                    if(!compress_next_block(false)) {
+                        lock.lock();
+                        progress.wait(lock, [&blocks, &failed, b]() { return blocks[b].done || failed; });
+                    }
+                    else {
+                        lock.lock();
+                    }
+                }
+                if(failed) {
+                    throw CompressionFailureException();
+                }
+                auto output = std::move(blocks[b].output);
+                next_write = b + 1;
+                lock.unlock();
+                progress.notify_all();
+
+                writer(output.data(), output.size());
+                total_size += output.size();
+                adler = static_cast<std::uint32_t>(adler32_combine(adler, blocks[b].adler, static_cast<z_off_t>(block_length(b))));
+            }
+
+            // And the Adler-32 of everything, big endian
+            write_bytes({ static_cast<std::uint8_t>(adler >> 24), static_cast<std::uint8_t>(adler >> 16), static_cast<std::uint8_t>(adler >> 8), static_cast<std::uint8_t>(adler) });
+            total_size += 4;
+        }
+        catch(...) {
+            {
+                std::scoped_lock<std::mutex> lock(mutex);
+                failed = true;
+            }
+            progress.notify_all();
+            for(auto &t : threads) {
+                t.join();
+            }
+            throw;
+        }
+
+        for(auto &t : threads) {
+            t.join();
+        }
+
+        return total_size;
+    }
+
+    // Check that we can compress the map and clamp the compression level
+    static const HEK::CacheFileHeader &check_map_to_compress(const std::byte *data, std::size_t data_size, int &compression_level) {
+        if(data_size < sizeof(HEK::CacheFileHeader)) {
+            throw InvalidMapException();
+        }
+
         const auto &header = *reinterpret_cast<const HEK::CacheFileHeader *>(data);
-        auto &header_output = *reinterpret_cast<HEK::CacheFileHeader *>(output);
-        
         if(!header.valid()) {
             throw InvalidMapException();
         }
-        
-        // If we're Xbox, we use a DEFLATE stream
-        if(header.engine == HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-            #ifndef DISABLE_ZLIB
-            auto input_padding_required = REQUIRED_PADDING_N_BYTES(data_size, HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE);
-            if(input_padding_required) {
-                eprintf_error("map size is not divisible by sector size (%zu)", static_cast<std::size_t>(HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE));
-                throw CompressionFailureException();
+
+        // If we're Xbox, we use a DEFLATE stream; otherwise, nope
+        if(header.engine != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
+            throw UnsupportedMapEngineException();
+        }
+
+        auto input_padding_required = REQUIRED_PADDING_N_BYTES(data_size, HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE);
+        if(input_padding_required) {
+            eprintf_error("map size is not divisible by sector size (%zu)", static_cast<std::size_t>(HEK::CacheFileXboxConstants::CACHE_FILE_XBOX_SECTOR_SIZE));
+            throw CompressionFailureException();
+        }
+
+        // Clamp
+        if(compression_level > Z_BEST_COMPRESSION) {
+            compression_level = Z_BEST_COMPRESSION;
+        }
+        else if(compression_level < Z_NO_COMPRESSION) {
+            compression_level = Z_NO_COMPRESSION;
+        }
+
+        return header;
+    }
+
+    // Compressed input is read this much at a time, and output is passed to sinks this much at a time
+    static constexpr std::size_t INFLATE_CHUNK_SIZE = 1024 * 1024;
+
+    // Inflate a zlib stream, getting input from the reader in bounded chunks until it returns an empty one. Output goes into the
+    // window; when that fills, it is passed to the writer and reused if reuse_window is set, or else any more output is a failure.
+    template <typename R, typename W> static std::size_t inflate_chunked(R reader, std::byte *window, std::size_t window_size, bool reuse_window, W writer) {
+        z_stream inflate_stream = {};
+        inflate_stream.zalloc = Z_NULL;
+        inflate_stream.zfree = Z_NULL;
+        inflate_stream.opaque = Z_NULL;
+        if(inflateInit(&inflate_stream) != Z_OK) {
+            throw DecompressionFailureException();
+        }
+
+        std::size_t total_size = 0;
+        std::size_t window_used = 0;
+        int result = Z_OK;
+        try {
+            while(result == Z_OK) {
+                if(inflate_stream.avail_in == 0) {
+                    auto [input, input_size] = reader();
+                    if(input_size == 0) {
+                        break;
+                    }
+                    inflate_stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(input));
+                    inflate_stream.avail_in = static_cast<uInt>(input_size);
+                }
+
+                // If we can't reuse the window, keep going anyway, since the Adler-32 at the end may still need to be read
+                if(window_used == window_size && reuse_window) {
+                    writer(window, window_used);
+                    total_size += window_used;
+                    window_used = 0;
+                }
+
+                auto output_size = static_cast<uInt>(std::min(window_size - window_used, static_cast<std::size_t>(UINT_MAX)));
+                inflate_stream.next_out = reinterpret_cast<Bytef *>(window + window_used);
+                inflate_stream.avail_out = output_size;
+                result = inflate(&inflate_stream, Z_NO_FLUSH);
+                window_used += output_size - inflate_stream.avail_out;
+            }
+
+            if(result == Z_STREAM_END && window_used > 0) {
+                writer(window, window_used);
+                total_size += window_used;
             }
+        }
+        catch(std::exception &) {
+            inflateEnd(&inflate_stream);
+            throw;
+        }
+
+        if(inflateEnd(&inflate_stream) != Z_OK || result != Z_STREAM_END) {
+            throw DecompressionFailureException();
+        }
+
+        return total_size;
+    }
 
-            // Compress that!
-            z_stream deflate_stream = {};
-            auto offset = sizeof(header);
-            deflate_stream.zalloc = Z_NULL;
-            deflate_stream.zfree = Z_NULL;
-            deflate_stream.opaque = Z_NULL;
-            deflate_stream.avail_in = data_size - offset;
-            deflate_stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(data + offset));
-            deflate_stream.avail_out = output_size - offset;
-            deflate_stream.next_out = reinterpret_cast<Bytef *>(output + offset);
-            
-            // Clamp
-            if(compression_level > Z_BEST_COMPRESSION) {
-                compression_level = Z_BEST_COMPRESSION;
-            }
-            else if(compression_level < Z_NO_COMPRESSION) {
-                compression_level = Z_NO_COMPRESSION;
-            }
-            
-            if((deflateInit(&deflate_stream, compression_level) != Z_OK) || (deflate(&deflate_stream, Z_FINISH) != Z_STREAM_END) || (deflateEnd(&deflate_stream) != Z_OK)) {
+    // Pass data to the inflater at most one chunk at a time
+    static auto chunked_memory_reader(const std::byte *data, std::size_t data_size) {
+        return [data, data_size]() mutable -> std::pair<const std::byte *, std::size_t> {
+            auto chunk_size = std::min(data_size, INFLATE_CHUNK_SIZE);
+            auto *chunk = data;
+            data += chunk_size;
+            data_size -= chunk_size;
+            return { chunk, chunk_size };
+        };
+    }
+
+    // Read a file into a buffer one chunk at a time
+    struct ChunkedFileReader {
+        std::FILE *file;
+        std::vector<std::byte> buffer = std::vector<std::byte>(INFLATE_CHUNK_SIZE);
+        std::pair<const std::byte *, std::size_t> operator()() {
+            auto amount_read = std::fread(this->buffer.data(), 1, this->buffer.size(), this->file);
+            if(amount_read == 0 && std::ferror(this->file)) {
                 throw DecompressionFailureException();
             }
-            
-            // Align to 4096 bytes
-            header_output = header;
-            std::size_t padding_required = REQUIRED_PADDING_N_BYTES(deflate_stream.total_out + sizeof(header), 4096);
-            header_output.compressed_padding = static_cast<std::uint32_t>(padding_required);
-            
-            return deflate_stream.total_out + sizeof(header_output) + padding_required;
-            
-            #else
-            std::terminate();
-            #endif
+            return { this->buffer.data(), amount_read };
         }
-        
-        // Otherwise, nope
-        else {
+    };
+
+    // Check that we can decompress the map
+    static void check_map_to_decompress(const HEK::CacheFileHeader &header) {
+        if(!header.valid()) {
+            throw InvalidMapException();
+        }
+        if(header.engine != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
             throw UnsupportedMapEngineException();
         }
     }
 
+    // Open a compressed map, reading its header and leaving the file at the start of the compressed data
+    static std::FILE *open_map_to_decompress(const char *input, HEK::CacheFileHeader &header) {
+        std::FILE *f = std::fopen(input, "rb");
+        if(!f) {
+            eprintf_error("Failed to open %s for reading", input);
+            throw FailedToOpenFileException();
+        }
+        try {
+            if(std::fread(&header, sizeof(header), 1, f) != 1) {
+                throw InvalidMapException();
+            }
+            check_map_to_decompress(header);
+        }
+        catch(std::exception &) {
+            std::fclose(f);
+            throw;
+        }
+        return f;
+    }
+
+    // Decompress the rest of a file opened with open_map_to_decompress(), closing it when done
+    template <typename W> static std::size_t decompress_map_file_chunked(std::FILE *f, std::byte *window, std::size_t window_size, bool reuse_window, W writer) {
+        std::size_t decompressed_size;
+        try {
+            decompressed_size = inflate_chunked(ChunkedFileReader { f }, window, window_size, reuse_window, writer);
+        }
+        catch(std::exception &) {
+            std::fclose(f);
+            throw;
+        }
+        std::fclose(f);
+        return decompressed_size;
+    }
+    #endif
+
+    std::size_t compress_map_data(const std::byte *data, std::size_t data_size, std::byte *output, std::size_t output_size, int compression_level, std::size_t thread_count) {
+        #ifndef DISABLE_ZLIB
+        const auto &header = check_map_to_compress(data, data_size, compression_level);
+        if(output_size < sizeof(header)) {
+            throw CompressionFailureException();
+        }
+
+        // Compress that!
+        std::size_t offset = sizeof(header);
+        std::size_t compressed_size = deflate_parallel(data + offset, data_size - offset, compression_level, thread_count, [&output, &output_size, &offset](const std::byte *compressed_data, std::size_t size) {
+            if(size > output_size - offset) {
+                throw CompressionFailureException();
+            }
+            std::memcpy(output + offset, compressed_data, size);
+            offset += size;
+        });
+
+        // Align to 4096 bytes
+        auto &header_output = *reinterpret_cast<HEK::CacheFileHeader *>(output);
+        header_output = header;
+        std::size_t padding_required = REQUIRED_PADDING_N_BYTES(compressed_size + sizeof(header), 4096);
+        header_output.compressed_padding = static_cast<std::uint32_t>(padding_required);
+        if(padding_required > output_size - offset) {
+            throw CompressionFailureException();
+        }
+        std::memset(output + offset, 0, padding_required);
+
+        return compressed_size + sizeof(header_output) + padding_required;
+        #else
+        std::terminate();
+        #endif
+    }
+
+    std::size_t compress_map_file(const std::byte *data, std::size_t data_size, const std::filesystem::path &output, int compression_level, std::size_t thread_count) {
+        #ifndef DISABLE_ZLIB
+        auto header = check_map_to_compress(data, data_size, compression_level);
+
+        // Write to a temporary file next to it first, so a failed write doesn't take out whatever map was already there
+        auto path_string = output.string();
+        auto temp_path = output;
+        temp_path += ".tmp";
+        auto temp_path_string = temp_path.string();
+        std::FILE *f = std::fopen(temp_path_string.c_str(), "wb");
+        if(!f) {
+            eprintf_error("Failed to open %s for writing", temp_path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        // Write the header last, since we don't know the padding yet
+        bool success = std::fseek(f, sizeof(header), SEEK_SET) == 0;
+        std::size_t compressed_size = 0;
+        try {
+            compressed_size = deflate_parallel(data + sizeof(header), data_size - sizeof(header), compression_level, thread_count, [&f, &success](const std::byte *compressed_data, std::size_t size) {
+                if(success && std::fwrite(compressed_data, size, 1, f) != 1) {
+                    success = false;
+                }
+            });
+        }
+        catch(std::exception &) {
+            std::fclose(f);
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            throw;
+        }
+
+        // Align to 4096 bytes
+        static constexpr std::byte ZEROES[4096] = {};
+        std::size_t padding_required = REQUIRED_PADDING_N_BYTES(compressed_size + sizeof(header), 4096);
+        header.compressed_padding = static_cast<std::uint32_t>(padding_required);
+        if(success && padding_required > 0) {
+            success = std::fwrite(ZEROES, padding_required, 1, f) == 1;
+        }
+        if(success) {
+            success = std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, f) == 1;
+        }
+
+        std::error_code ec;
+        if(std::fclose(f) != 0 || !success) {
+            std::filesystem::remove(temp_path, ec);
+            eprintf_error("Failed to write to %s", temp_path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        std::filesystem::rename(temp_path, output, ec);
+        if(ec) {
+            std::filesystem::remove(temp_path, ec);
+            eprintf_error("Failed to write to %s", path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+
+        return compressed_size + sizeof(header) + padding_required;
+        #else
+        std::terminate();
+        #endif
+    }
+
     std::size_t decompress_map_data(const std::byte *data, std::size_t data_size, std::byte *output, std::size_t output_size) {
+        #ifndef DISABLE_ZLIB
         // Check the header
+        if(data_size < sizeof(HEK::CacheFileHeader) || output_size < sizeof(HEK::CacheFileHeader)) {
+            throw InvalidMapException();
+        }
         const auto &header = *reinterpret_cast<const HEK::CacheFileHeader *>(data);
-        
-        if(!header.valid()) {
+        check_map_to_decompress(header);
+
+        auto reader = chunked_memory_reader(data + sizeof(header), data_size - sizeof(header));
+        return inflate_chunked(reader, output + sizeof(header), output_size - sizeof(header), false, [](const std::byte *, std::size_t) {}) + sizeof(header);
+        #else
+        std::terminate();
+        #endif
+    }
+
+    std::size_t decompress_map_data(const std::byte *data, std::size_t data_size, const DecompressionSink &sink) {
+        #ifndef DISABLE_ZLIB
+        if(data_size < sizeof(HEK::CacheFileHeader)) {
             throw InvalidMapException();
         }
-        
-        if(header.engine == HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-            #ifndef DISABLE_ZLIB
-            z_stream inflate_stream = {};
-            inflate_stream.zalloc = Z_NULL;
-            inflate_stream.zfree = Z_NULL;
-            inflate_stream.opaque = Z_NULL;
-            inflate_stream.avail_in = data_size - sizeof(header);
-            inflate_stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(data + sizeof(header)));
-            inflate_stream.avail_out = output_size - sizeof(header);
-            inflate_stream.next_out = reinterpret_cast<Bytef *>(output + sizeof(header));
-            if((inflateInit(&inflate_stream) != Z_OK) || (inflate(&inflate_stream, Z_FINISH) != Z_STREAM_END) || (inflateEnd(&inflate_stream) != Z_OK)) {
-                throw DecompressionFailureException();
-            }
-            return inflate_stream.total_out + sizeof(header);
-            #else
-            std::terminate();
-            #endif
+        const auto &header = *reinterpret_cast<const HEK::CacheFileHeader *>(data);
+        check_map_to_decompress(header);
+        sink(data, sizeof(header));
+
+        std::vector<std::byte> window(INFLATE_CHUNK_SIZE);
+        auto reader = chunked_memory_reader(data + sizeof(header), data_size - sizeof(header));
+        return inflate_chunked(reader, window.data(), window.size(), true, sink) + sizeof(header);
+        #else
+        std::terminate();
+        #endif
+    }
+
+    std::size_t decompress_map_file(const char *input, const char *output) {
+        #ifndef DISABLE_ZLIB
+        HEK::CacheFileHeader header;
+        std::FILE *f = open_map_to_decompress(input, header);
+
+        std::FILE *o = std::fopen(output, "wb");
+        if(!o) {
+            std::fclose(f);
+            eprintf_error("Failed to open %s for writing", output);
+            throw FailedToOpenFileException();
         }
-        else {
-            throw UnsupportedMapEngineException();
+
+        bool success = std::fwrite(&header, sizeof(header), 1, o) == 1;
+        std::vector<std::byte> window(INFLATE_CHUNK_SIZE);
+        std::size_t decompressed_size;
+        try {
+            decompressed_size = decompress_map_file_chunked(f, window.data(), window.size(), true, [&o, &success](const std::byte *decompressed_data, std::size_t size) {
+                if(success && std::fwrite(decompressed_data, size, 1, o) != 1) {
+                    success = false;
+                }
+            });
+        }
+        catch(std::exception &) {
+            std::fclose(o);
+            throw;
+        }
+
+        if(std::fclose(o) != 0 || !success) {
+            eprintf_error("Failed to write to %s", output);
+            throw FailedToOpenFileException();
+        }
+
+        return decompressed_size + sizeof(header);
+        #else
+        std::terminate();
+        #endif
+    }
+
+    std::size_t decompress_map_file(const char *input, std::byte *output, std::size_t output_size) {
+        #ifndef DISABLE_ZLIB
+        if(output_size < sizeof(HEK::CacheFileHeader)) {
+            throw DecompressionFailureException();
         }
+
+        HEK::CacheFileHeader header;
+        std::FILE *f = open_map_to_decompress(input, header);
+        std::memcpy(output, &header, sizeof(header));
+        return decompress_map_file_chunked(f, output + sizeof(header), output_size - sizeof(header), false, [](const std::byte *, std::size_t) {}) + sizeof(header);
+        #else
+        std::terminate();
+        #endif
+    }
+
+    std::size_t decompress_map_file(const char *input, const DecompressionSink &sink) {
+        #ifndef DISABLE_ZLIB
+        HEK::CacheFileHeader header;
+        std::FILE *f = open_map_to_decompress(input, header);
+        try {
+            sink(reinterpret_cast<const std::byte *>(&header), sizeof(header));
+        }
+        catch(std::exception &) {
+            std::fclose(f);
+            throw;
+        }
+
+        std::vector<std::byte> window(INFLATE_CHUNK_SIZE);
+        return decompress_map_file_chunked(f, window.data(), window.size(), true, sink) + sizeof(header);
+        #else
+        std::terminate();
+        #endif
     }
 
-    std::vector<std::byte> compress_map_data(const std::byte *data, std::size_t data_size, int compression_level) {
+    std::vector<std::byte> compress_map_data(const std::byte *data, std::size_t data_size, int compression_level, std::size_t thread_count) {
         // Allocate the data
         const auto &header = *reinterpret_cast<const HEK::CacheFileHeader *>(data);
         std::vector<std::byte> new_data;
@@ -114,7 +582,7 @@ namespace Invader::Compression {
         new_data.resize(data_size * 2);
 
         // Compress
-        auto compressed_size = compress_map_data(data, data_size, new_data.data(), new_data.size(), compression_level);
+        auto compressed_size = compress_map_data(data, data_size, new_data.data(), new_data.size(), compression_level, thread_count);
 
         // Resize and return it
         new_data.resize(compressed_size);
@@ -4,6 +4,7 @@
 // - added GPL version 3 only identifier (the original code to this uses the below license, but my modifications are GPL version 3 only, as is Invader itself)
 // - added "crc32.h" include
 // - removed platform specific includes <sys/param.h> and <sys/systm.h>
+// - renamed crc32() to crc32_bytewise(); crc32() is now in crc32_fast.cpp and gives the same results
 
 #include "crc32.h"
 
@@ -98,7 +99,7 @@ static uint32_t crc32_tab[] = {
 	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-uint32_t crc32(uint32_t crc, const void *buf, size_t size)
+uint32_t crc32_bytewise(uint32_t crc, const void *buf, size_t size)
 {
 	const uint8_t *p;
 
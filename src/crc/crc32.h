@@ -9,8 +9,52 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdlib.h>
+
+/**
+ * Calculate the CRC32 of the data, continuing from the given CRC32 (use 0 to start). This uses the fastest
+ * implementation the CPU supports.
+ * @param crc  CRC32 to continue from
+ * @param buf  data
+ * @param size size of data in bytes
+ * @return     CRC32
+ */
 uint32_t crc32(uint32_t crc, const void *buf, size_t size);
 
+/**
+ * Calculate the CRC32 of the data one byte at a time. This gives the same results as crc32(), only slower.
+ * @param crc  CRC32 to continue from
+ * @param buf  data
+ * @param size size of data in bytes
+ * @return     CRC32
+ */
+uint32_t crc32_bytewise(uint32_t crc, const void *buf, size_t size);
+
+/**
+ * Calculate the CRC32 of the data, splitting it across multiple threads if it is large enough to be worth it. This
+ * gives the same results as crc32().
+ * @param crc          CRC32 to continue from
+ * @param buf          data
+ * @param size         size of data in bytes
+ * @param thread_count maximum number of threads to use, or 0 to use one per CPU thread
+ * @return             CRC32
+ */
+uint32_t crc32_parallel(uint32_t crc, const void *buf, size_t size, size_t thread_count);
+
+/**
+ * Combine two CRC32s into the CRC32 of both pieces of data one after another.
+ * @param crc1  CRC32 of the first piece of data
+ * @param crc2  CRC32 of the second piece of data (starting from 0)
+ * @param size2 size of the second piece of data in bytes
+ * @return      CRC32 of the first piece of data followed by the second
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t size2);
+
+/**
+ * Get the name of the implementation crc32() uses on this CPU.
+ * @return name of the implementation
+ */
+const char *crc32_backend_name(void);
+
 #ifdef __cplusplus
 }
 #endif
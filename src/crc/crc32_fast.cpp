@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <array>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <system_error>
+
+#include "crc32.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INVADER_CRC32_PCLMUL
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define INVADER_CRC32_ARMV8
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
+// This is the same CRC32 as crc32_bytewise() (polynomial 0xEDB88320, reflected), just computed faster. Everything here
+// must return exactly what crc32_bytewise() would for the same input.
+
+namespace {
+    constexpr std::uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+    // Don't bother splitting a region across threads unless each thread gets at least this much
+    constexpr std::size_t CRC32_PARALLEL_MINIMUM_CHUNK = 4 * 1024 * 1024;
+
+    // Slicing-by-16 tables; table[k][b] is the CRC of byte b followed by k zero bytes
+    constexpr auto CRC32_SLICING_TABLES = []() {
+        std::array<std::array<std::uint32_t, 256>, 16> tables {};
+        for(std::uint32_t b = 0; b < 256; b++) {
+            std::uint32_t crc = b;
+            for(int i = 0; i < 8; i++) {
+                crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : (crc >> 1);
+            }
+            tables[0][b] = crc;
+        }
+        for(std::size_t k = 1; k < tables.size(); k++) {
+            for(std::size_t b = 0; b < 256; b++) {
+                auto previous = tables[k - 1][b];
+                tables[k][b] = (previous >> 8) ^ tables[0][previous & 0xFF];
+            }
+        }
+        return tables;
+    }();
+
+    std::uint32_t crc32_slicing_by_16(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept {
+        auto &t = CRC32_SLICING_TABLES;
+        crc = ~crc;
+
+        while(size >= 16) {
+            // Bytes are read individually so this works regardless of the host's byte order
+            std::uint32_t first = crc ^ (static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24);
+            crc = t[15][first & 0xFF] ^ t[14][(first >> 8) & 0xFF] ^ t[13][(first >> 16) & 0xFF] ^ t[12][first >> 24] ^
+                  t[11][p[4]] ^ t[10][p[5]] ^ t[9][p[6]] ^ t[8][p[7]] ^
+                  t[7][p[8]] ^ t[6][p[9]] ^ t[5][p[10]] ^ t[4][p[11]] ^
+                  t[3][p[12]] ^ t[2][p[13]] ^ t[1][p[14]] ^ t[0][p[15]];
+            p += 16;
+            size -= 16;
+        }
+
+        while(size--) {
+            crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    #ifdef INVADER_CRC32_PCLMUL
+    __attribute__((target("pclmul,sse4.1"))) inline __m128i crc32_pclmul_load(const std::uint8_t *at) noexcept {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+    }
+
+    // Multiply both halves of x by the constants in k and add the next 128 bits
+    __attribute__((target("pclmul,sse4.1"))) inline __m128i crc32_pclmul_fold_lane(__m128i x, __m128i k, __m128i next) noexcept {
+        auto lo = _mm_clmulepi64_si128(x, k, 0x00);
+        auto hi = _mm_clmulepi64_si128(x, k, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+    }
+
+    // Fold 64 bytes at a time with carry-less multiplication, then Barrett reduce to 32 bits. This is the method described
+    // in Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", using the bit-reflected
+    // constants for this polynomial. size must be at least 64 and a multiple of 16, and crc is not inverted.
+    __attribute__((target("pclmul,sse4.1"))) std::uint32_t crc32_pclmul_fold(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept {
+        alignas(16) static const std::uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };
+        alignas(16) static const std::uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };
+        alignas(16) static const std::uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };
+        alignas(16) static const std::uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };
+
+        __m128i x1 = _mm_xor_si128(crc32_pclmul_load(p + 0x00), _mm_cvtsi32_si128(static_cast<int>(crc)));
+        __m128i x2 = crc32_pclmul_load(p + 0x10);
+        __m128i x3 = crc32_pclmul_load(p + 0x20);
+        __m128i x4 = crc32_pclmul_load(p + 0x30);
+        p += 64;
+        size -= 64;
+
+        // Four lanes in parallel
+        __m128i k = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+        while(size >= 64) {
+            x1 = crc32_pclmul_fold_lane(x1, k, crc32_pclmul_load(p + 0x00));
+            x2 = crc32_pclmul_fold_lane(x2, k, crc32_pclmul_load(p + 0x10));
+            x3 = crc32_pclmul_fold_lane(x3, k, crc32_pclmul_load(p + 0x20));
+            x4 = crc32_pclmul_fold_lane(x4, k, crc32_pclmul_load(p + 0x30));
+            p += 64;
+            size -= 64;
+        }
+
+        // Down to one lane
+        k = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+        x1 = crc32_pclmul_fold_lane(x1, k, x2);
+        x1 = crc32_pclmul_fold_lane(x1, k, x3);
+        x1 = crc32_pclmul_fold_lane(x1, k, x4);
+        while(size >= 16) {
+            x1 = crc32_pclmul_fold_lane(x1, k, crc32_pclmul_load(p));
+            p += 16;
+            size -= 16;
+        }
+
+        // 128 bits to 64 bits
+        __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+        __m128i x2_64 = _mm_clmulepi64_si128(x1, k, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2_64);
+
+        k = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+        __m128i x1_high = _mm_srli_si128(x1, 4);
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00), x1_high);
+
+        // Barrett reduction to 32 bits
+        k = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+        __m128i reduced = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+        reduced = _mm_clmulepi64_si128(_mm_and_si128(reduced, mask), k, 0x00);
+        x1 = _mm_xor_si128(x1, reduced);
+
+        return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+    }
+
+    std::uint32_t crc32_pclmul(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept {
+        if(size >= 64) {
+            std::size_t folded = size & ~static_cast<std::size_t>(15);
+            crc = ~crc32_pclmul_fold(~crc, p, folded);
+            p += folded;
+            size -= folded;
+        }
+        return crc32_slicing_by_16(crc, p, size);
+    }
+
+    bool crc32_pclmul_supported() noexcept {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    }
+    #endif
+
+    #ifdef INVADER_CRC32_ARMV8
+    // ARMv8's CRC32 instructions (not CRC32C) use this polynomial, so they can be used directly
+    #ifdef __clang__
+    __attribute__((target("crc")))
+    #else
+    __attribute__((target("+crc")))
+    #endif
+    std::uint32_t crc32_armv8(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept {
+        crc = ~crc;
+        while(size > 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0) {
+            crc = __crc32b(crc, *p++);
+            size--;
+        }
+        while(size >= 32) {
+            std::uint64_t v[4];
+            std::memcpy(v, p, sizeof(v));
+            crc = __crc32d(crc, v[0]);
+            crc = __crc32d(crc, v[1]);
+            crc = __crc32d(crc, v[2]);
+            crc = __crc32d(crc, v[3]);
+            p += sizeof(v);
+            size -= sizeof(v);
+        }
+        while(size >= 8) {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            crc = __crc32d(crc, v);
+            p += sizeof(v);
+            size -= sizeof(v);
+        }
+        while(size--) {
+            crc = __crc32b(crc, *p++);
+        }
+        return ~crc;
+    }
+
+    bool crc32_armv8_supported() noexcept {
+        #if defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+        return true;
+        #elif defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+        #else
+        return false;
+        #endif
+    }
+    #endif
+
+    struct CRC32Backend {
+        std::uint32_t (*function)(std::uint32_t crc, const std::uint8_t *p, std::size_t size) noexcept;
+        const char *name;
+    };
+
+    // Pick the fastest implementation this CPU supports once, the first time a CRC is calculated
+    const CRC32Backend &crc32_backend() noexcept {
+        static const CRC32Backend backend = []() -> CRC32Backend {
+            #ifdef INVADER_CRC32_PCLMUL
+            if(crc32_pclmul_supported()) {
+                return { crc32_pclmul, "pclmulqdq" };
+            }
+            #endif
+            #ifdef INVADER_CRC32_ARMV8
+            if(crc32_armv8_supported()) {
+                return { crc32_armv8, "armv8-crc32" };
+            }
+            #endif
+            return { crc32_slicing_by_16, "slicing-by-16" };
+        }();
+        return backend;
+    }
+
+    // Multiply two polynomials modulo the CRC polynomial (bit-reflected, so x^0 is the high bit)
+    constexpr std::uint32_t crc32_multiply_mod(std::uint32_t a, std::uint32_t b) noexcept {
+        std::uint32_t product = 0;
+        for(std::uint32_t m = 1U << 31; m != 0; m >>= 1) {
+            if(a & m) {
+                product ^= b;
+            }
+            b = (b & 1) ? (b >> 1) ^ CRC32_POLYNOMIAL : (b >> 1);
+        }
+        return product;
+    }
+
+    // x^(2^n) modulo the CRC polynomial
+    constexpr auto CRC32_X2N_TABLE = []() {
+        std::array<std::uint32_t, 32> table {};
+        std::uint32_t p = 1U << 30; // x^1
+        for(auto &i : table) {
+            i = p;
+            p = crc32_multiply_mod(p, p);
+        }
+        return table;
+    }();
+}
+
+extern "C" {
+    uint32_t crc32(uint32_t crc, const void *buf, size_t size) {
+        return crc32_backend().function(crc, static_cast<const std::uint8_t *>(buf), size);
+    }
+
+    const char *crc32_backend_name(void) {
+        return crc32_backend().name;
+    }
+
+    uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t size2) {
+        // Shift crc1 over size2 zero bytes (multiplying it by x^(8 * size2)), then add crc2
+        std::uint32_t shift = 1U << 31; // x^0
+        std::size_t k = 3; // 2^3 = 8 bits per byte
+        for(std::uint64_t n = size2; n != 0; n >>= 1, k++) {
+            if(n & 1) {
+                shift = crc32_multiply_mod(CRC32_X2N_TABLE[k & 31], shift);
+            }
+        }
+        return crc32_multiply_mod(shift, crc1) ^ crc2;
+    }
+
+    uint32_t crc32_parallel(uint32_t crc, const void *buf, size_t size, size_t thread_count) {
+        if(thread_count == 0) {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        thread_count = std::min(thread_count, size / CRC32_PARALLEL_MINIMUM_CHUNK);
+        if(thread_count <= 1) {
+            return crc32(crc, buf, size);
+        }
+
+        // Each chunk gets its own CRC, and then they're all combined in order
+        const auto *data = static_cast<const std::uint8_t *>(buf);
+        std::size_t chunk_size = size / thread_count;
+        std::vector<std::uint32_t> chunk_crcs(thread_count, 0);
+        auto chunk_length = [&](std::size_t c) {
+            return c + 1 == thread_count ? size - chunk_size * c : chunk_size;
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        std::size_t next_chunk = 1;
+        try {
+            for(; next_chunk < thread_count; next_chunk++) {
+                threads.emplace_back([&chunk_crcs, &chunk_length, data, chunk_size](std::size_t c) {
+                    chunk_crcs[c] = crc32(0, data + chunk_size * c, chunk_length(c));
+                }, next_chunk);
+            }
+        }
+        catch(std::system_error &) {
+            // Whatever we couldn't start a thread for, we'll do ourselves
+        }
+
+        chunk_crcs[0] = crc32(crc, data, chunk_length(0));
+        for(std::size_t c = next_chunk; c < thread_count; c++) {
+            chunk_crcs[c] = crc32(0, data + chunk_size * c, chunk_length(c));
+        }
+        for(auto &t : threads) {
+            t.join();
+        }
+
+        std::uint32_t result = chunk_crcs[0];
+        for(std::size_t c = 1; c < thread_count; c++) {
+            result = crc32_combine(result, chunk_crcs[c], chunk_length(c));
+        }
+        return result;
+    }
+}
@@ -4,6 +4,7 @@
 // - added GPL version 3 only identifier (the original code to this uses the below license, but my modifications are GPL version 3 only, as is Invader itself)
 // - commented out main function
 // - added a fake file handle data type and functions so this can be done with data in memory
+// - split out the patch calculation into crc_spoof_calculate_patch() so it can be used with a CRC-32 calculated elsewhere
 
 /*
  * CRC-32 forcer (C)
@@ -40,6 +41,7 @@
 /* Forward declarations */
 
 const char *crc_spoof_modify_file_crc32(FakeFileHandle *f, uint64_t offset, uint32_t newcrc, bool printstatus);
+uint32_t crc_spoof_calculate_patch(uint32_t crc, uint32_t newcrc, uint64_t distance);
 
 uint32_t get_crc32_and_length(FakeFileHandle *f, uint64_t *length);
 static void fseek64(FakeFileHandle *f, uint64_t offset);
@@ -112,8 +114,7 @@ const char *crc_spoof_modify_file_crc32(FakeFileHandle *f, uint64_t offset, uint
         fprintf(stdout, "Original CRC-32: %08" PRIX32 "\n", crc_spoof_reverse_bits(crc));
 
     // Compute the change to make
-    uint32_t delta = crc ^ newcrc;
-    delta = (uint32_t)multiply_mod(reciprocal_mod(pow_mod(2, (length - offset) * 8)), delta);
+    uint32_t patch = crc_spoof_calculate_patch(crc, newcrc, length - offset);
 
     // Patch 4 bytes in the file
     fseek64(f, offset);
@@ -123,7 +124,7 @@ const char *crc_spoof_modify_file_crc32(FakeFileHandle *f, uint64_t offset, uint
             crc_spoof_fake_fclose(f);
             return "I/O error: fgetc";
         }
-        b ^= (int)((crc_spoof_reverse_bits(delta) >> (i * 8)) & 0xFF);
+        b ^= (int)((patch >> (i * 8)) & 0xFF);
         if (crc_spoof_fake_fseek(f, -1, SEEK_CUR) != 0) {
             crc_spoof_fake_fclose(f);
             return "I/O error: crc_spoof_fake_fseek";
@@ -152,6 +153,16 @@ const char *crc_spoof_modify_file_crc32(FakeFileHandle *f, uint64_t offset, uint
 }
 
 
+// Returns the value (in little endian byte order) to XOR the 4 bytes at a given position with to change the data's
+// CRC-32 from crc to newcrc, where distance is the number of bytes from that position to the end of the data. The data
+// itself isn't needed, so the CRC-32 can be calculated however the caller likes.
+uint32_t crc_spoof_calculate_patch(uint32_t crc, uint32_t newcrc, uint64_t distance) {
+    uint32_t delta = crc ^ newcrc;
+    delta = (uint32_t)multiply_mod(reciprocal_mod(pow_mod(2, distance * 8)), delta);
+    return crc_spoof_reverse_bits(delta);
+}
+
+
 /*---- Utilities ----*/
 
 // Generator polynomial. Do not modify, because there are many dependencies
@@ -29,6 +29,16 @@ size_t crc_spoof_fake_fread(void *ptr, size_t size, size_t count, FakeFileHandle
 const char *crc_spoof_modify_file_crc32(FakeFileHandle *f, uint64_t offset, uint32_t newcrc, bool printstatus);
 uint32_t crc_spoof_reverse_bits(uint32_t x);
 
+/**
+ * Calculate the value to XOR four bytes of data with to change the data's CRC-32 to a new value. Both CRC-32 values are
+ * bit-reversed and inverted as with crc_spoof_modify_file_crc32().
+ * @param crc      current CRC-32 of the data
+ * @param newcrc   desired CRC-32 of the data
+ * @param distance number of bytes from the start of the four bytes to the end of the data
+ * @return         value to XOR the four bytes with, in little endian byte order
+ */
+uint32_t crc_spoof_calculate_patch(uint32_t crc, uint32_t newcrc, uint64_t distance);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,34 +8,26 @@
 #include <invader/map/map.hpp>
 
 namespace Invader {
-    std::uint32_t calculate_map_crc(const Invader::Map &map, const std::uint32_t *new_crc, std::uint32_t *new_random, bool *check_dirty) {
+    std::uint32_t calculate_map_crc(const Invader::Map &map, const std::uint32_t *new_crc, std::uint32_t *new_random, bool *check_dirty, std::size_t thread_count) {
         // Reassign variables if needed
         auto *data = map.get_data();
         auto size = map.get_data_length();
         
-        std::vector<std::byte> data_crc;
         std::uint32_t crc = 0;
+        std::size_t crc_size = 0;
 
         if(new_crc && !new_random) {
             std::terminate();
         }
 
-        if(new_crc) {
-            data_crc.reserve(size);
-        }
-        
         auto engine = map.get_cache_version();
         if(engine == HEK::CacheFileEngine::CACHE_FILE_XBOX) {
             return 0;
         }
 
         #define CRC_DATA(data_start, data_end) \
-            if(new_crc) { \
-                data_crc.insert(data_crc.end(), data + data_start, data + data_end); \
-            } \
-            else { \
-                crc = crc32(crc, data + data_start, data_end - data_start); \
-            }
+            crc = crc32_parallel(crc, data + data_start, data_end - data_start, thread_count); \
+            crc_size += data_end - data_start;
 
         auto &scenario_tag = map.get_tag(map.get_scenario_tag_id());
         auto &scenario = scenario_tag.get_base_struct<HEK::Scenario>();
@@ -89,22 +81,20 @@ namespace Invader {
         // Find out where we're going to be doing CRC32 stuff
         auto *tag_file_checksums = &reinterpret_cast<const HEK::CacheFileTagDataHeader *>(map.get_tag_data_at_offset(0, sizeof(HEK::CacheFileTagDataHeader)))->tag_file_checksums;
         const std::byte *tag_file_checksums_ptr = reinterpret_cast<const std::byte *>(tag_file_checksums);
-        std::size_t tag_file_checksums_offset_in_memory = tag_file_checksums_ptr - tag_data + data_crc.size();
+        std::size_t tag_file_checksums_offset_in_memory = tag_file_checksums_ptr - tag_data + crc_size;
         CRC_DATA(tag_data_start, tag_data_end);
 
-        // Overwrite with new CRC32
+        // Work out what the new random number needs to be to get the new CRC32; nothing after it changes, so this only needs the CRC32 we already have
         if(new_crc) {
-            FakeFileHandle handle = { reinterpret_cast<std::uint8_t *>(data_crc.data()), data_crc.size(), 0 };
-            std::uint32_t newcrc = ~crc_spoof_reverse_bits(*new_crc);
-            crc_spoof_modify_file_crc32(&handle, tag_file_checksums_offset_in_memory, newcrc, false);
-            *new_random = *reinterpret_cast<std::uint32_t *>(data_crc.data() + tag_file_checksums_offset_in_memory);
+            std::uint32_t patch = crc_spoof_calculate_patch(crc_spoof_reverse_bits(crc), ~crc_spoof_reverse_bits(*new_crc), crc_size - tag_file_checksums_offset_in_memory);
+            *new_random = tag_file_checksums->read() ^ patch;
 
             // We have no way of knowing if the map was dirty or not because we just forged the CRC
             if(check_dirty) {
                 *check_dirty = false;
             }
 
-            return ~crc32(0, data_crc.data(), data_crc.size());
+            return *new_crc;
         }
         else {
             std::uint32_t crc_value = ~crc;
@@ -115,7 +105,7 @@ namespace Invader {
         }
     }
     
-    std::uint32_t calculate_map_crc(const std::byte *data, std::size_t size, const std::uint32_t *new_crc, std::uint32_t *new_random, bool *check_dirty) {
-        return calculate_map_crc(Map::map_with_copy(data, size), new_crc, new_random, check_dirty);
+    std::uint32_t calculate_map_crc(const std::byte *data, std::size_t size, const std::uint32_t *new_crc, std::uint32_t *new_random, bool *check_dirty, std::size_t thread_count) {
+        return calculate_map_crc(Map::map_with_copy(data, size), new_crc, new_random, check_dirty, thread_count);
     }
 }
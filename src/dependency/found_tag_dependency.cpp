@@ -10,30 +10,11 @@
 namespace Invader {
     static std::vector<File::TagFilePath> get_dependencies(const std::byte *tag_data, std::size_t tag_data_length) {
         std::vector<File::TagFilePath> dependencies;
-
-        auto recursively_get_dependencies = [&dependencies](const Parser::ParserStruct &st, auto &recursively_get_dependencies) -> void {
-            for(auto &v : st.get_values()) {
-                switch(v.get_type()) {
-                    case Parser::ParserStructValue::ValueType::VALUE_TYPE_REFLEXIVE: {
-                        auto count = v.get_array_size();
-                        for(std::size_t i = 0; i < count; i++) {
-                            recursively_get_dependencies(v.get_object_in_array(i), recursively_get_dependencies);
-                        }
-                        break;
-                    }
-                    case Parser::ParserStructValue::ValueType::VALUE_TYPE_DEPENDENCY: {
-                        auto &dep = v.get_dependency();
-                        if(!dep.path.empty()) {
-                            dependencies.emplace_back(File::halo_path_to_preferred_path(dep.path), dep.tag_fourcc);
-                        }
-                        break;
-                    }
-                    default: break;
-                }
-            }
-        };
-
-        recursively_get_dependencies(*Parser::ParserStruct::parse_hek_tag_file(tag_data, tag_data_length), recursively_get_dependencies);
+        
+        // Only the dependencies are needed, so there's no need to parse the whole tag
+        for(auto &dep : Parser::ParserStruct::scan_hek_tag_file_dependencies(tag_data, tag_data_length)) {
+            dependencies.emplace_back(File::halo_path_to_preferred_path(File::remove_duplicate_slashes(std::string(dep.path))), dep.tag_fourcc);
+        }
 
         return dependencies;
     }
@@ -2,6 +2,7 @@
 
 #include <invader/error.hpp>
 #include <invader/printf.hpp>
+#include <cstdarg>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -52,3 +53,32 @@ void set_up_color_term() noexcept {
 bool is_on_color_term() noexcept {
     return on_color_term;
 }
+
+static thread_local std::string *stderr_capture = nullptr;
+
+void set_stderr_capture(std::string *capture) noexcept {
+    stderr_capture = capture;
+}
+
+int stderr_printf(const char *format, ...) {
+    std::va_list args;
+    va_start(args, format);
+    int result;
+    if(stderr_capture) {
+        std::va_list args_copy;
+        va_copy(args_copy, args);
+        result = std::vsnprintf(nullptr, 0, format, args_copy);
+        va_end(args_copy);
+        if(result > 0) {
+            auto offset = stderr_capture->size();
+            stderr_capture->resize(offset + result + 1);
+            std::vsnprintf(stderr_capture->data() + offset, result + 1, format, args);
+            stderr_capture->resize(offset + result);
+        }
+    }
+    else {
+        result = std::vfprintf(stderr, format, args);
+    }
+    va_end(args);
+    return result;
+}
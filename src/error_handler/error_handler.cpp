@@ -102,33 +102,40 @@ namespace Invader {
             } \
         }
         
+        // Keep the whole report together if something else could be printing, too
+        std::unique_lock<std::mutex> report_lock;
+        if(this->report_mutex) {
+            report_lock = std::unique_lock<std::mutex>(*this->report_mutex);
+        }
+        const char *label = this->report_label.c_str();
+        
         switch(type) {
             case ErrorType::ERROR_TYPE_WARNING_PEDANTIC:
                 if(this->reporting_level <= ReportingLevel::REPORTING_LEVEL_HIDE_ALL_PEDANTIC_WARNINGS) {
                     return;
                 }
-                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_warn_lesser, "WARNING (minor): %s", error);
+                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_warn_lesser, "%sWARNING (minor): %s", label, error);
                 this->warnings++;
                 break;
             case ErrorType::ERROR_TYPE_WARNING:
                 if(this->reporting_level <= ReportingLevel::REPORTING_LEVEL_HIDE_ALL_WARNINGS) {
                     return;
                 }
-                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_warn, "WARNING: %s", error);
+                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_warn, "%sWARNING: %s", label, error);
                 this->warnings++;
                 break;
             case ErrorType::ERROR_TYPE_ERROR:
                 if(this->reporting_level <= ReportingLevel::REPORTING_LEVEL_HIDE_EVERYTHING) {
                     return;
                 }
-                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_error, "ERROR: %s", error);
+                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_error, "%sERROR: %s", label, error);
                 this->errors++;
                 break;
             case ErrorType::ERROR_TYPE_FATAL_ERROR:
                 if(this->reporting_level <= ReportingLevel::REPORTING_LEVEL_HIDE_EVERYTHING) {
                     return;
                 }
-                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_error, "FATAL ERROR: %s", error);
+                WRITE_ERROR_MESSAGE_WRAPPED(eprintf_error, "%sFATAL ERROR: %s", label, error);
                 this->errors++;
                 break;
         }
@@ -141,7 +148,7 @@ namespace Invader {
                 std::terminate();
             }
             auto &tag = this->tag_paths[index];
-            eprintf("...in %s.%s\n", File::halo_path_to_preferred_path(tag.path).c_str(), tag_fourcc_to_extension(tag.fourcc));
+            eprintf("%s...in %s.%s\n", label, File::halo_path_to_preferred_path(tag.path).c_str(), tag_fourcc_to_extension(tag.fourcc));
         }
     }
     
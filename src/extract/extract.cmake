@@ -11,6 +11,14 @@ if(${INVADER_EXTRACT})
 
     target_link_libraries(invader-extract invader ${INVADER_CRT_NOGLOB})
 
+    # Extracting into archives needs libarchive, but nothing else does
+    if(${LibArchive_FOUND})
+        target_include_directories(invader-extract PUBLIC ${LibArchive_INCLUDE_DIRS})
+        target_link_libraries(invader-extract ${LibArchive_LIBRARIES})
+    else()
+        target_compile_definitions(invader-extract PRIVATE DISABLE_LIBARCHIVE)
+    endif()
+
     set(TARGETS_LIST ${TARGETS_LIST} invader-extract)
 
     if(WIN32)
@@ -12,6 +12,13 @@
 #include <invader/tag/parser/parser.hpp>
 #include <regex>
 
+#ifndef DISABLE_LIBARCHIVE
+#include <sys/stat.h>
+#include <archive.h>
+#include <archive_entry.h>
+#include "../archive/archive_format.hpp"
+#endif
+
 int main(int argc, const char **argv) {
     set_up_color_term();
 
@@ -21,6 +28,7 @@ int main(int argc, const char **argv) {
     struct ExtractOptions {
         std::optional<std::string> tags_directory;
         std::optional<std::string> maps_directory;
+        std::optional<std::string> archive;
         std::vector<std::string> tags_to_extract;
 
         std::vector<std::string> search_queries;
@@ -30,19 +38,28 @@ int main(int argc, const char **argv) {
         bool overwrite = false;
         bool non_mp_globals = false;
         bool ignore_resource_maps = false;
+        std::size_t thread_count = 1;
     } extract_options;
 
+    #ifndef DISABLE_LIBARCHIVE
+    std::string archive_argument = std::string("Extract tags into an archive instead of the tags directory. The format is determined by the extension, which must be one of: ") + list_archive_extensions();
+    #endif
+
     // Command line options
     const CommandLineOption options[] {
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_MAPS),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_TAGS),
         CommandLineOption("recursive", 'r', 0, "Extract tag dependencies"),
-        CommandLineOption("overwrite", 'O', 0, "Overwrite tags if they already exist"),
+        CommandLineOption("overwrite", 'O', 0, "Overwrite tags if they already exist. This cannot be used with --archive."),
         CommandLineOption("ignore-resources", 'G', 0, "Ignore resource maps."),
         CommandLineOption("search", 's', 1, "Search for tags (* and ? are wildcards) and extract these. Use multiple times for multiple queries. If unspecified, all tags will be extracted.", "<expr>"),
         CommandLineOption("search-exclude", 'e', 1, "Search for tags (* and ? are wildcards) and ignore these. Use multiple times for multiple queries. This takes precedence over --search.", "<expr>"),
-        CommandLineOption("non-mp-globals", 'n', 0, "Enable extraction of non-multiplayer .globals")
+        CommandLineOption("non-mp-globals", 'n', 0, "Enable extraction of non-multiplayer .globals"),
+        CommandLineOption("threads", 'j', 1, "Set the number of threads to use for extracting tags. This does not change the output. Default: 1", "<count>"),
+        #ifndef DISABLE_LIBARCHIVE
+        CommandLineOption("archive", 'a', 1, archive_argument.c_str(), "<file>"),
+        #endif
     };
 
     static constexpr char DESCRIPTION[] = "Extract data from cache files.";
@@ -57,6 +74,9 @@ int main(int argc, const char **argv) {
             case 'm':
                 extract_options.maps_directory = args[0];
                 break;
+            case 'a':
+                extract_options.archive = args[0];
+                break;
             case 't':
                 if(extract_options.tags_directory.has_value()) {
                     eprintf_error("This tool does not support multiple tags directories.");
@@ -79,6 +99,18 @@ int main(int argc, const char **argv) {
             case 'e':
                 extract_options.search_queries_exclude.emplace_back(File::preferred_path_to_halo_path(args[0]));
                 break;
+            case 'j':
+                try {
+                    extract_options.thread_count = std::stoul(args[0]);
+                    if(extract_options.thread_count < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
             case 'i':
                 Invader::show_version_info();
                 std::exit(EXIT_SUCCESS);
@@ -90,9 +122,15 @@ int main(int argc, const char **argv) {
         extract_options.tags_directory = "tags";
     }
 
-    // Check if the tags directory exists
+    // Archives are always written from scratch, so there's nothing to overwrite
+    if(extract_options.archive.has_value() && extract_options.overwrite) {
+        eprintf_error("--overwrite cannot be used with --archive");
+        return EXIT_FAILURE;
+    }
+
+    // Check if the tags directory exists (unless we aren't using it)
     std::filesystem::path tags(*extract_options.tags_directory);
-    if(!std::filesystem::is_directory(tags)) {
+    if(!extract_options.archive.has_value() && !std::filesystem::is_directory(tags)) {
         if(extract_options.tags_directory == "tags") {
             eprintf_error("No tags directory was given, and \"tags\" was not found or is not a directory.");
         }
@@ -102,7 +140,7 @@ int main(int argc, const char **argv) {
         return EXIT_FAILURE;
     }
 
-    std::vector<std::byte> loc, bitmaps, sounds;
+    std::optional<std::filesystem::path> loc, bitmaps, sounds;
 
     // Find the asset data
     if(!extract_options.maps_directory.has_value()) {
@@ -116,18 +154,12 @@ int main(int argc, const char **argv) {
     // Load resource maps
     if(extract_options.maps_directory.has_value() && !extract_options.ignore_resource_maps) {
         std::filesystem::path maps_directory(*extract_options.maps_directory);
-        auto open_map_possibly = [&maps_directory](const char *map) -> std::vector<std::byte> {
+        auto open_map_possibly = [&maps_directory](const char *map) -> std::optional<std::filesystem::path> {
             auto path = maps_directory / map;
             if(!std::filesystem::exists(path)) {
-                return std::vector<std::byte>();
-            }
-            auto potential_map = Invader::File::open_file(maps_directory / map);
-            if(potential_map.has_value()) {
-                return *potential_map;
-            }
-            else {
-                return std::vector<std::byte>();
+                return std::nullopt;
             }
+            return path;
         };
 
         // Get its header
@@ -166,13 +198,80 @@ int main(int argc, const char **argv) {
     // Load map
     std::unique_ptr<Map> map;
     try {
-        auto file = File::open_file(remaining_arguments[0]).value();
-        map = std::make_unique<Map>(Map::map_with_move(std::move(file), std::move(bitmaps), std::move(loc), std::move(sounds)));
+        map = std::make_unique<Map>(Map::map_with_mapping(remaining_arguments[0], bitmaps, loc, sounds));
     }
     catch (std::exception &e) {
         eprintf_error("Failed to parse %s: %s", remaining_arguments[0], e.what());
         return EXIT_FAILURE;
     }
 
-    ExtractionWorkload::extract_map(*map, *extract_options.tags_directory, extract_options.search_queries, extract_options.search_queries_exclude, extract_options.recursive, extract_options.overwrite, extract_options.non_mp_globals);
+    ExtractionWorkload::TagOutput output;
+
+    #ifndef DISABLE_LIBARCHIVE
+    // Write tags straight into an archive if we want that
+    archive *archive = nullptr;
+    if(extract_options.archive.has_value()) {
+        const auto &archive_path = *extract_options.archive;
+        const auto *format = find_archive_format_by_extension(archive_path);
+        if(!format) {
+            eprintf_error("Invalid output file path %s. This should end with one of: %s", archive_path.c_str(), list_archive_extensions().c_str());
+            return EXIT_FAILURE;
+        }
+
+        archive = archive_write_new();
+        if(format->filter) {
+            format->filter(archive);
+        }
+        if(format->format) {
+            format->format(archive);
+        }
+        if(archive_write_open_filename(archive, archive_path.c_str()) != ARCHIVE_OK) {
+            eprintf_error("Failed to open %s for writing: %s", archive_path.c_str(), archive_error_string(archive));
+            archive_write_free(archive);
+            return EXIT_FAILURE;
+        }
+
+        // Use the map's modified time for every tag so the archive is the same each time
+        struct stat s = {};
+        stat(remaining_arguments[0], &s);
+        auto mtime = s.st_mtime;
+
+        output = [&archive, &mtime](const File::TagFilePath &tag_path, const std::vector<std::byte> &tag_data) -> bool {
+            // libarchive always needs POSIX paths.
+            auto entry_path = tag_path.join();
+            for(char &c : entry_path) {
+                if(c == '\\') {
+                    c = '/';
+                }
+            }
+
+            auto *entry = archive_entry_new();
+            archive_entry_set_pathname(entry, entry_path.c_str());
+            archive_entry_set_perm(entry, 0644);
+            archive_entry_set_filetype(entry, AE_IFREG);
+            archive_entry_set_mtime(entry, mtime, 0);
+            archive_entry_set_size(entry, tag_data.size());
+
+            bool written = archive_write_header(archive, entry) == ARCHIVE_OK && archive_write_data(archive, tag_data.data(), tag_data.size()) == static_cast<la_ssize_t>(tag_data.size());
+            archive_entry_free(entry);
+            return written;
+        };
+    }
+    #endif
+
+    ExtractionWorkload::extract_map(*map, *extract_options.tags_directory, extract_options.search_queries, extract_options.search_queries_exclude, extract_options.recursive, extract_options.overwrite, extract_options.non_mp_globals, ErrorHandler::ReportingLevel::REPORTING_LEVEL_ALL, extract_options.thread_count, output);
+
+    #ifndef DISABLE_LIBARCHIVE
+    if(archive) {
+        bool closed = archive_write_close(archive) == ARCHIVE_OK;
+        if(!closed) {
+            eprintf_error("Failed to save %s: %s", extract_options.archive->c_str(), archive_error_string(archive));
+        }
+        archive_write_free(archive);
+        if(!closed) {
+            return EXIT_FAILURE;
+        }
+        oprintf("Saved %s\n", extract_options.archive->c_str());
+    }
+    #endif
 }
@@ -1,13 +1,44 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include <regex>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <algorithm>
+#include <tuple>
 #include <invader/build/build_workload.hpp>
 #include <invader/extract/extraction.hpp>
 #include <invader/tag/hek/header.hpp>
 #include <invader/tag/parser/parser.hpp>
 
 namespace Invader {
-    void ExtractionWorkload::extract_map(const Map &map, const std::string &tags, const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, bool recursive, bool overwrite, bool non_mp_globals, ReportingLevel reporting_level) {
+    namespace {
+        // Everything extracting a tag produced, held until it's that tag's turn to be reported
+        struct ExtractedTag {
+            bool extracted = false;
+            std::vector<std::size_t> dependencies;
+            std::vector<std::byte> tag_data;
+            std::vector<std::tuple<ErrorHandler::ErrorType, std::string, std::optional<std::size_t>>> reports;
+            std::optional<std::string> exception;
+
+            void report_error(ErrorHandler::ErrorType type, const char *error, std::optional<std::size_t> tag_index = std::nullopt) {
+                this->reports.emplace_back(type, error, tag_index);
+            }
+        };
+
+        template<typename Handler> void report_unsupported_tag_group(Handler &handler, std::size_t tag_index, TagFourCC tag_fourcc) {
+            if(std::strcmp(tag_fourcc_to_extension(tag_fourcc), "unknown") == 0) {
+                REPORT_ERROR_PRINTF(handler, ERROR_TYPE_ERROR, tag_index, "Tag group FourCC 0x%08X is unknown", tag_fourcc);
+            }
+            else {
+                REPORT_ERROR_PRINTF(handler, ERROR_TYPE_ERROR, tag_index, "Tag group \"%s\" is unsupported", tag_fourcc_to_extension(tag_fourcc));
+            }
+        }
+    }
+
+    void ExtractionWorkload::extract_map(const Map &map, const std::string &tags, const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, bool recursive, bool overwrite, bool non_mp_globals, ReportingLevel reporting_level, std::size_t thread_count, const TagOutput &output) {
         // There's no need to extract recursively if we're extracting all tags
         if(queries.size() == 0) {
             recursive = false;
@@ -15,7 +46,7 @@ namespace Invader {
 
         ExtractionWorkload workload(map, reporting_level);
         auto start = std::chrono::steady_clock::now();
-        auto success = workload.perform_extraction(queries, queries_exclude, tags, recursive, overwrite, non_mp_globals);
+        auto success = workload.perform_extraction(queries, queries_exclude, tags, recursive, overwrite, non_mp_globals, thread_count, output);
         auto matched = workload.matched_tags.size();
         auto warnings = workload.get_warnings();
         auto errors = workload.get_errors();
@@ -47,7 +78,7 @@ namespace Invader {
         }
     }
 
-    std::size_t ExtractionWorkload::perform_extraction(const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, const std::filesystem::path &tags, bool recursive, bool overwrite, bool non_mp_globals) {
+    std::size_t ExtractionWorkload::perform_extraction(const std::vector<std::string> &queries, const std::vector<std::string> &queries_exclude, const std::filesystem::path &tags, bool recursive, bool overwrite, bool non_mp_globals, std::size_t thread_count, const TagOutput &output) {
         // Set these variables up
         auto *map = &this->map;
         auto type = map->get_type();
@@ -77,10 +108,8 @@ namespace Invader {
             }
         }
         
-        auto extract_tag = [&extracted_tags, &map, &tags, &all_tags_to_extract, &type, &recursive, &overwrite, &non_mp_globals, &workload, &engine, &jason_jones, &detail_object_modifiers](std::size_t tag_index) -> bool {
-            // Do it
-            extracted_tags[tag_index] = true;
-
+        // This only reads the map, so it can be called from multiple threads at once
+        auto extract_tag = [&map, &tags, &type, &recursive, &overwrite, &non_mp_globals, &engine, &jason_jones, &detail_object_modifiers, &output](std::size_t tag_index, ExtractedTag &result) -> bool {
             // Get the tag path
             const auto &tag = map->get_tag(tag_index);
             if(!tag.data_is_available()) {
@@ -92,30 +121,33 @@ namespace Invader {
 
             // Get the path
             if(tag_path.empty()) {
-                workload.report_error(ErrorType::ERROR_TYPE_ERROR, "Tag path is invalid", tag_index);
+                result.report_error(ErrorType::ERROR_TYPE_ERROR, "Tag path is invalid", tag_index);
                 return false;
             }
 
             // Let's do this
             auto tfp = File::TagFilePath(Invader::File::halo_path_to_preferred_path(tag_path), tag.get_tag_fourcc());
 
-            // Figure out the path we're writing to
-            auto tag_path_to_write_to = Invader::File::tag_path_to_file_path(tfp, tags);
-
-            if(!overwrite && std::filesystem::exists(tag_path_to_write_to)) {
+            // Don't bother if it's already there; this is checked again before saving, since another tag may have the same path
+            if(!output && !overwrite && std::filesystem::exists(Invader::File::tag_path_to_file_path(tfp, tags))) {
                 return false;
             }
 
             // Skip globals
             if(tfp.fourcc == Invader::TagFourCC::TAG_FOURCC_GLOBALS && !non_mp_globals && type != Invader::HEK::CacheFileType::SCENARIO_TYPE_MULTIPLAYER) {
-                workload.report_error(ErrorType::ERROR_TYPE_WARNING_PEDANTIC, "Skipping the non-multiplayer map's globals tag", tag_index);
+                result.report_error(ErrorType::ERROR_TYPE_WARNING_PEDANTIC, "Skipping the non-multiplayer map's globals tag", tag_index);
                 return false;
             }
 
             // Get the tag data
             std::vector<std::byte> new_tag;
             try {
-                new_tag = Invader::ExtractionWorkload::extract_single_tag(tag);
+                auto parsed = parse_tag(tag);
+                if(!parsed) {
+                    report_unsupported_tag_group(result, tag_index, tag.get_tag_fourcc());
+                    throw InvalidTagDataException();
+                }
+                new_tag = parsed->generate_hek_tag_data(tag.get_tag_fourcc());
 
                 // If we're recursive, we want to also get that stuff, too
                 if(recursive) {
@@ -129,14 +161,14 @@ namespace Invader {
                     }
                     for(auto &d : dependencies) {
                         auto tag_index = map->find_tag(d.first->c_str(), d.second);
-                        if(tag_index.has_value() && extracted_tags[*tag_index] == false) {
-                            all_tags_to_extract.push_back(*tag_index);
+                        if(tag_index.has_value()) {
+                            result.dependencies.push_back(*tag_index);
                         }
                     }
                 }
             }
             catch (std::exception &e) {
-                REPORT_ERROR_PRINTF(workload, ERROR_TYPE_ERROR, tag_index, "Failed to extract %s.%s: %s", tfp.path.c_str(), HEK::tag_fourcc_to_extension(tfp.fourcc), e.what());
+                REPORT_ERROR_PRINTF(result, ERROR_TYPE_ERROR, tag_index, "Failed to extract %s.%s: %s", tfp.path.c_str(), HEK::tag_fourcc_to_extension(tfp.fourcc), e.what());
                 return false;
             }
 
@@ -181,7 +213,7 @@ namespace Invader {
                 }
 
                 if(changed) {
-                    REPORT_ERROR_PRINTF(workload, ERROR_TYPE_WARNING_PEDANTIC, tag_index, "Weapon tag was changed due to being altered in singleplayer");
+                    REPORT_ERROR_PRINTF(result, ERROR_TYPE_WARNING_PEDANTIC, tag_index, "Weapon tag was changed due to being altered in singleplayer");
                 }
             }
 
@@ -191,7 +223,6 @@ namespace Invader {
                 if(!bsp.detail_objects.empty()) {
                     auto &detail_objects = bsp.detail_objects[0];
                     for(auto &cell : detail_objects.cells) {
-                        std::printf("%i!\n", __LINE__);
                         auto count_index = static_cast<std::size_t>(cell.count_index);
                         for(std::uint32_t q = cell.valid_layers_flags, bitfield_index = 0; q != 0; q >>= 1, bitfield_index++) {
                             if(!(q & 1)) {
@@ -231,7 +262,7 @@ namespace Invader {
 
                     while(mipmap_count > 0) {
                         if(height < 4 && width < 4) {
-                            REPORT_ERROR_PRINTF(workload, ERROR_TYPE_WARNING_PEDANTIC, tag_index, "Bitmap was missing mipmaps which had to be generated");
+                            REPORT_ERROR_PRINTF(result, ERROR_TYPE_WARNING_PEDANTIC, tag_index, "Bitmap was missing mipmaps which had to be generated");
                             break;
                         }
 
@@ -244,13 +275,25 @@ namespace Invader {
                 }
             }
 
+            // Writing it out is done in order once it's reported, since maps can have more than one tag with the same path and class
+            result.tag_data = std::move(new_tag);
+            return true;
+        };
+
+        // Save a tag, unless an earlier tag with the same path and class was already saved (or it was already there)
+        auto save_tag = [&workload, &tags, &overwrite](std::size_t tag_index, const File::TagFilePath &tfp, const std::vector<std::byte> &tag_data) -> bool {
+            auto tag_path_to_write_to = Invader::File::tag_path_to_file_path(tfp, tags);
+            if(!overwrite && std::filesystem::exists(tag_path_to_write_to)) {
+                return false;
+            }
+
             // Create directories along the way
             std::error_code ec;
             std::filesystem::create_directories(tag_path_to_write_to.parent_path(), ec);
 
             // Save it
             auto tag_path_str = tag_path_to_write_to.string();
-            if(!Invader::File::save_file(tag_path_str.c_str(), new_tag)) {
+            if(!Invader::File::save_file(tag_path_str.c_str(), tag_data)) {
                 REPORT_ERROR_PRINTF(workload, ERROR_TYPE_ERROR, tag_index, "Failed to save %s", tag_path_str.c_str());
                 return false;
             }
@@ -283,28 +326,128 @@ namespace Invader {
             }
         }
 
-        // Extract tags
+        // Extract tags on the worker threads. Dependencies are queued as soon as they're found, since every tag found will be extracted eventually.
+        std::mutex extraction_mutex;
+        std::condition_variable extraction_condition;
+        std::deque<std::size_t> queue;
+        std::vector<bool> queued(tag_count);
+        std::vector<bool> taken(tag_count);
+        std::vector<std::optional<ExtractedTag>> results(tag_count);
+        bool done = false;
+
+        // Finished tags are held until they're reported, so don't let the workers get too far ahead
+        std::size_t pending = 0;
+        const std::size_t max_pending = thread_count * 4;
+
+        for(auto t : all_tags_to_extract) {
+            if(!queued[t]) {
+                queued[t] = true;
+                queue.push_back(t);
+            }
+        }
+
+        // Extract a tag and queue its dependencies; the lock is held when calling this and when it returns
+        auto extract_queued_tag = [&](std::size_t tag, std::unique_lock<std::mutex> &lock) -> ExtractedTag {
+            lock.unlock();
+            ExtractedTag result;
+            try {
+                result.extracted = extract_tag(tag, result);
+            }
+            catch(std::exception &e) {
+                result.extracted = false;
+                result.exception = e.what();
+            }
+            lock.lock();
+
+            for(auto d : result.dependencies) {
+                if(!queued[d]) {
+                    queued[d] = true;
+                    queue.push_back(d);
+                }
+            }
+            extraction_condition.notify_all();
+            return result;
+        };
+
+        auto extraction_worker = [&]() {
+            std::unique_lock<std::mutex> lock(extraction_mutex);
+            while(true) {
+                extraction_condition.wait(lock, [&]() { return done || (!queue.empty() && pending < max_pending); });
+                if(done) {
+                    return;
+                }
+
+                std::size_t tag = queue.front();
+                queue.pop_front();
+                taken[tag] = true;
+                pending++;
+                results[tag] = extract_queued_tag(tag, lock);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for(std::size_t i = 0; i < thread_count; i++) {
+            threads.emplace_back(extraction_worker);
+        }
+
+        // Report the results in the same order as extracting them one at a time would, so the output doesn't depend on the number of threads
         std::size_t total = 0;
         std::size_t extracted = 0;
+        std::set<File::TagFilePath> output_paths;
         while(all_tags_to_extract.size() > 0) {
             std::size_t tag = all_tags_to_extract[0];
             all_tags_to_extract.erase(all_tags_to_extract.begin());
             if(extracted_tags[tag]) {
                 continue;
             }
+            extracted_tags[tag] = true;
             const auto &tag_map = map->get_tag(tag);
             auto path_dot = File::TagFilePath(File::halo_path_to_preferred_path(tag_map.get_path()), tag_map.get_tag_fourcc());
 
-            // Do it!
-            bool result;
-            try {
-                result = extract_tag(tag);
+            // If no worker has gotten to it yet (or there aren't any), do it ourselves rather than wait
+            std::unique_lock<std::mutex> lock(extraction_mutex);
+            ExtractedTag result;
+            if(!taken[tag]) {
+                taken[tag] = true;
+                if(auto q = std::find(queue.begin(), queue.end(), tag); q != queue.end()) {
+                    queue.erase(q);
+                }
+                result = extract_queued_tag(tag, lock);
             }
-            catch(std::exception &e) {
-                eprintf_error("Error while extracting %s: %s", path_dot.join().c_str(), e.what());
-                result = false;
+            else {
+                extraction_condition.wait(lock, [&results, &tag]() { return results[tag].has_value(); });
+                result = std::move(*results[tag]);
+                results[tag] = std::nullopt;
+                pending--;
+                extraction_condition.notify_all();
+            }
+            lock.unlock();
+
+            for(auto &r : result.reports) {
+                workload.report_error(std::get<0>(r), std::get<1>(r).c_str(), std::get<2>(r));
             }
-            if(result) {
+            for(auto d : result.dependencies) {
+                if(!extracted_tags[d]) {
+                    all_tags_to_extract.push_back(d);
+                }
+            }
+
+            if(result.exception.has_value()) {
+                eprintf_error("Error while extracting %s: %s", path_dot.join().c_str(), result.exception->c_str());
+            }
+            // Only give the first tag with a path and class to the output, like save_tag() does with the tags directory
+            if(result.extracted && output && !output_paths.emplace(tag_map.get_path(), tag_map.get_tag_fourcc()).second) {
+                result.extracted = false;
+            }
+            else if(result.extracted && output && !output(File::TagFilePath(tag_map.get_path(), tag_map.get_tag_fourcc()), result.tag_data)) {
+                REPORT_ERROR_PRINTF(workload, ERROR_TYPE_ERROR, tag, "Failed to write %s", path_dot.join().c_str());
+                result.extracted = false;
+            }
+            else if(result.extracted && !output) {
+                result.extracted = save_tag(tag, path_dot, result.tag_data);
+            }
+            if(result.extracted) {
                 oprintf_success("Extracted %s", path_dot.join().c_str());
                 extracted++;
             }
@@ -313,6 +456,15 @@ namespace Invader {
             }
         }
 
+        {
+            std::scoped_lock<std::mutex> lock(extraction_mutex);
+            done = true;
+        }
+        extraction_condition.notify_all();
+        for(auto &i : threads) {
+            i.join();
+        }
+
         this->matched_tags.reserve(total);
         for(std::size_t i = 0; i < tag_count; i++) {
             if(extracted_tags[i]) {
@@ -346,6 +498,15 @@ namespace Invader {
 
     std::optional<std::unique_ptr<Parser::ParserStruct>> ExtractionWorkload::extract_tag(std::size_t tag_index) {
         auto &tag = this->map.get_tag(tag_index);
+        auto parsed = parse_tag(tag);
+        if(!parsed) {
+            report_unsupported_tag_group(*this, tag_index, tag.get_tag_fourcc());
+            return std::nullopt;
+        }
+        return parsed;
+    }
+
+    std::unique_ptr<Parser::ParserStruct> ExtractionWorkload::parse_tag(const Tag &tag) {
         auto tag_fourcc = tag.get_tag_fourcc();
 
         #define EXTRACT_TAG_GROUP(class_struct, fourcc) case TagFourCC::fourcc: { \
@@ -453,12 +614,6 @@ namespace Invader {
             case TagFourCC::TAG_FOURCC_SPHEROID:
                 break;
         }
-        if(std::strcmp(tag_fourcc_to_extension(tag_fourcc), "unknown") == 0) {
-            REPORT_ERROR_PRINTF(*this, ERROR_TYPE_ERROR, tag_index, "Tag group FourCC 0x%08X is unknown", tag_fourcc);
-        }
-        else {
-            REPORT_ERROR_PRINTF(*this, ERROR_TYPE_ERROR, tag_index, "Tag group \"%s\" is unsupported", tag_fourcc_to_extension(tag_fourcc));
-        }
-        return std::nullopt;
+        return nullptr;
     }
 }
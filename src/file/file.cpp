@@ -2,6 +2,11 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <invader/file/file.hpp>
@@ -12,6 +17,7 @@
 #include <filesystem>
 #include <cstring>
 #include <climits>
+#include <cstdint>
 
 namespace Invader::File {
     std::optional<std::vector<std::byte>> open_file(const std::filesystem::path &path) {
@@ -93,6 +99,145 @@ namespace Invader::File {
         return true;
     }
     
+    std::optional<MemoryMappedFile> MemoryMappedFile::scratch(std::size_t size) {
+        // Nothing to map
+        if(size == 0) {
+            return std::nullopt;
+        }
+
+        #ifdef _WIN32
+        wchar_t directory[MAX_PATH + 1];
+        wchar_t path[MAX_PATH + 1];
+        if(GetTempPathW(sizeof(directory) / sizeof(*directory), directory) == 0 || GetTempFileNameW(directory, L"inv", 0, path) == 0) {
+            return std::nullopt;
+        }
+
+        // GetTempFileNameW() already made the file, so reopen it to be deleted when the mapping goes away
+        HANDLE file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            DeleteFileW(path);
+            return std::nullopt;
+        }
+
+        // Views hold their own reference to the file, so we can close the handles once it's mapped
+        ULARGE_INTEGER mapping_size;
+        mapping_size.QuadPart = size;
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, mapping_size.HighPart, mapping_size.LowPart, nullptr);
+        void *mapped_data = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if(mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        if(mapped_data == nullptr) {
+            return std::nullopt;
+        }
+        #else
+        auto path_string = (std::filesystem::temp_directory_path() / "invader-XXXXXX").string();
+        int file = mkstemp(path_string.data());
+        if(file == -1) {
+            return std::nullopt;
+        }
+
+        // Unlink it now so it's gone once it's unmapped, even if we crash
+        unlink(path_string.c_str());
+
+        // Reserve the space up front if we can, since running out of it while writing to the mapping is a crash rather than an error
+        #ifdef __linux__
+        bool resized = posix_fallocate(file, 0, static_cast<off_t>(size)) == 0;
+        #else
+        bool resized = ftruncate(file, static_cast<off_t>(size)) == 0;
+        #endif
+        void *mapped_data = resized ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+        close(file);
+        if(mapped_data == MAP_FAILED) {
+            return std::nullopt;
+        }
+        #endif
+
+        return MemoryMappedFile(reinterpret_cast<std::byte *>(mapped_data), size);
+    }
+
+    std::optional<MemoryMappedFile> MemoryMappedFile::open(const std::filesystem::path &path) {
+        #ifdef _WIN32
+        HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            return std::nullopt;
+        }
+
+        LARGE_INTEGER file_size;
+        if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || static_cast<unsigned long long>(file_size.QuadPart) > SIZE_MAX) {
+            CloseHandle(file);
+            return std::nullopt;
+        }
+        auto size = static_cast<std::size_t>(file_size.QuadPart);
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        void *mapped_data = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, size);
+        if(mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        if(mapped_data == nullptr) {
+            return std::nullopt;
+        }
+        #else
+        int file = ::open(path.string().c_str(), O_RDONLY);
+        if(file == -1) {
+            return std::nullopt;
+        }
+
+        struct stat file_stat;
+        if(fstat(file, &file_stat) != 0 || file_stat.st_size <= 0) {
+            close(file);
+            return std::nullopt;
+        }
+        auto size = static_cast<std::size_t>(file_stat.st_size);
+
+        void *mapped_data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        close(file);
+        if(mapped_data == MAP_FAILED) {
+            return std::nullopt;
+        }
+        #endif
+
+        return MemoryMappedFile(reinterpret_cast<std::byte *>(mapped_data), size);
+    }
+
+    MemoryMappedFile::MemoryMappedFile(MemoryMappedFile &&move) noexcept : mapped_data(move.mapped_data), mapped_size(move.mapped_size) {
+        move.mapped_data = nullptr;
+        move.mapped_size = 0;
+    }
+
+    MemoryMappedFile &MemoryMappedFile::operator=(MemoryMappedFile &&move) noexcept {
+        if(this != &move) {
+            this->unmap();
+            this->mapped_data = move.mapped_data;
+            this->mapped_size = move.mapped_size;
+            move.mapped_data = nullptr;
+            move.mapped_size = 0;
+        }
+        return *this;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile() {
+        this->unmap();
+    }
+
+    void MemoryMappedFile::unmap() noexcept {
+        if(this->mapped_data == nullptr) {
+            return;
+        }
+
+        #ifdef _WIN32
+        UnmapViewOfFile(this->mapped_data);
+        #else
+        munmap(this->mapped_data, this->mapped_size);
+        #endif
+
+        this->mapped_data = nullptr;
+        this->mapped_size = 0;
+    }
+
     std::optional<std::filesystem::path> tag_path_to_file_path(const std::string &tag_path, const std::vector<std::filesystem::path> &tags) {
         for(auto &i : tags) {
             auto path = tag_path_to_file_path(tag_path, i);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <algorithm>
+#include <invader/file/tag_path_index.hpp>
+
+namespace Invader::File {
+    void TagPathIndex::insert(std::string_view path, HEK::TagFourCC tag_fourcc, std::size_t index) {
+        auto path_it = this->paths.find(path);
+        if(path_it == this->paths.end()) {
+            path_it = this->paths.emplace(std::string(path), static_cast<std::uint32_t>(this->paths.size())).first;
+        }
+
+        auto key = tag_key(path_it->second, tag_fourcc);
+        auto [tag_it, inserted] = this->tags.try_emplace(key, index);
+        if(!inserted && index != tag_it->second) {
+            auto &others = this->duplicates[key];
+            if(index < tag_it->second) {
+                others.emplace_back(tag_it->second);
+                tag_it->second = index;
+            }
+            else {
+                others.emplace_back(index);
+            }
+        }
+    }
+
+    void TagPathIndex::erase(std::string_view path, HEK::TagFourCC tag_fourcc, std::size_t index) noexcept {
+        auto path_it = this->paths.find(path);
+        if(path_it == this->paths.end()) {
+            return;
+        }
+
+        // The path stays interned, since it is likely to come back
+        auto key = tag_key(path_it->second, tag_fourcc);
+        auto tag_it = this->tags.find(key);
+        if(tag_it == this->tags.end()) {
+            return;
+        }
+
+        auto duplicates_it = this->duplicates.find(key);
+        if(tag_it->second == index) {
+            if(duplicates_it == this->duplicates.end()) {
+                this->tags.erase(tag_it);
+                return;
+            }
+
+            // Fall back to the next lowest tag with the same path and class
+            auto &others = duplicates_it->second;
+            auto lowest = std::min_element(others.begin(), others.end());
+            tag_it->second = *lowest;
+            others.erase(lowest);
+        }
+        else if(duplicates_it != this->duplicates.end()) {
+            auto &others = duplicates_it->second;
+            if(auto other = std::find(others.begin(), others.end(), index); other != others.end()) {
+                others.erase(other);
+            }
+        }
+        else {
+            return;
+        }
+
+        if(duplicates_it->second.empty()) {
+            this->duplicates.erase(duplicates_it);
+        }
+    }
+
+    std::optional<std::size_t> TagPathIndex::find(std::string_view path, HEK::TagFourCC tag_fourcc) const noexcept {
+        auto path_it = this->paths.find(path);
+        if(path_it == this->paths.end()) {
+            return std::nullopt;
+        }
+
+        auto tag_it = this->tags.find(tag_key(path_it->second, tag_fourcc));
+        if(tag_it == this->tags.end()) {
+            return std::nullopt;
+        }
+        return tag_it->second;
+    }
+
+    void TagPathIndex::clear() noexcept {
+        this->paths.clear();
+        this->tags.clear();
+        this->duplicates.clear();
+    }
+
+    void TagPathIndex::reserve(std::size_t count) {
+        this->paths.reserve(count);
+        this->tags.reserve(count);
+    }
+}
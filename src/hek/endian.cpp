@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include <cstring>
+
+#include <invader/hek/endian.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define INVADER_ENDIAN_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define INVADER_ENDIAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+    using SwapFunction = void (*)(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept;
+
+    // Swap whatever is left (less than a block) one byte at a time; the pattern is at the start of this block
+    void swap_big_endian_tail(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern) noexcept {
+        std::uint8_t block[16];
+        std::memcpy(block, input, size);
+        for(std::size_t i = 0; i < size; i++) {
+            output[i] = block[pattern[i]];
+        }
+    }
+
+    void swap_big_endian_bytewise(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept {
+        std::size_t p = 0;
+        while(size > 0) {
+            std::size_t block_size = size < 16 ? size : 16;
+            swap_big_endian_tail(input, output, block_size, pattern + p);
+            input += block_size;
+            output += block_size;
+            size -= block_size;
+            p = (p + 16) % pattern_size;
+        }
+    }
+
+    #ifdef INVADER_ENDIAN_X86
+    __attribute__((target("ssse3"))) void swap_big_endian_ssse3(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept {
+        std::size_t p = 0;
+        while(size >= 16) {
+            auto mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + p));
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_shuffle_epi8(block, mask));
+            input += 16;
+            output += 16;
+            size -= 16;
+            p = (p + 16) % pattern_size;
+        }
+        swap_big_endian_tail(input, output, size, pattern + p);
+    }
+
+    // vpshufb shuffles each 16 byte half separately, so the pattern works as-is
+    __attribute__((target("avx2"))) void swap_big_endian_avx2(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept {
+        std::size_t p = 0;
+        while(size >= 32) {
+            std::size_t p_high = (p + 16) % pattern_size;
+            auto mask = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + p))), _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + p_high)), 1);
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(output), _mm256_shuffle_epi8(block, mask));
+            input += 32;
+            output += 32;
+            size -= 32;
+            p = (p_high + 16) % pattern_size;
+        }
+        if(size >= 16) {
+            auto mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern + p));
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_shuffle_epi8(block, mask));
+            input += 16;
+            output += 16;
+            size -= 16;
+            p = (p + 16) % pattern_size;
+        }
+        swap_big_endian_tail(input, output, size, pattern + p);
+    }
+    #endif
+
+    #ifdef INVADER_ENDIAN_NEON
+    void swap_big_endian_neon(const std::uint8_t *input, std::uint8_t *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept {
+        std::size_t p = 0;
+        while(size >= 16) {
+            vst1q_u8(output, vqtbl1q_u8(vld1q_u8(input), vld1q_u8(pattern + p)));
+            input += 16;
+            output += 16;
+            size -= 16;
+            p = (p + 16) % pattern_size;
+        }
+        swap_big_endian_tail(input, output, size, pattern + p);
+    }
+    #endif
+
+    // Pick the fastest implementation this CPU supports once, the first time anything is swapped
+    SwapFunction swap_big_endian_backend() noexcept {
+        static const SwapFunction backend = []() -> SwapFunction {
+            #ifdef INVADER_ENDIAN_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")) {
+                return swap_big_endian_avx2;
+            }
+            if(__builtin_cpu_supports("ssse3")) {
+                return swap_big_endian_ssse3;
+            }
+            #endif
+            #ifdef INVADER_ENDIAN_NEON
+            return swap_big_endian_neon;
+            #endif
+            return swap_big_endian_bytewise;
+        }();
+        return backend;
+    }
+}
+
+namespace Invader::HEK {
+    void swap_big_endian_array(const std::byte *input, std::byte *output, std::size_t size, const std::uint8_t *pattern, std::size_t pattern_size) noexcept {
+        if(size == 0) {
+            return;
+        }
+
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        // Already native endian
+        (void)pattern;
+        (void)pattern_size;
+        if(input != output) {
+            std::memmove(output, input, size);
+        }
+        #else
+        swap_big_endian_backend()(reinterpret_cast<const std::uint8_t *>(input), reinterpret_cast<std::uint8_t *>(output), size, pattern, pattern_size);
+        #endif
+    }
+}
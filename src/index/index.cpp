@@ -36,21 +36,21 @@ int main(int argc, const char **argv) {
     const char *output = remaining_arguments[1];
     const char *input = remaining_arguments[0];
 
-    auto input_map_data = File::open_file(input);
-
-    // Open input map
-    if(!input_map_data.has_value()) {
+    // Open input map, only reading enough to tell what it is
+    std::uint32_t input_map_type = 0;
+    std::FILE *input_file = std::fopen(input, "rb");
+    if(!input_file) {
         eprintf_error("Failed to read %s", input);
         return EXIT_FAILURE;
     }
-
-    auto input_map = std::move(*input_map_data);
+    bool input_map_type_read = std::fread(&input_map_type, sizeof(input_map_type), 1, input_file) == 1;
+    std::fclose(input_file);
 
     // If it's a resource map, try parsing that
-    if(input_map.size() >= 4 && *reinterpret_cast<std::uint32_t *>(input_map.data()) <= 3) {
+    if(input_map_type_read && input_map_type <= 3) {
         try {
-            auto map = load_resource_map(input_map.data(), input_map.size());
-            auto &header = *reinterpret_cast<ResourceMapHeader *>(input_map.data());
+            auto map = ResourceMapView::view_file(input);
+            auto &header = *reinterpret_cast<const ResourceMapHeader *>(map.get_data());
             
             // Get our extension
             const char *extension;
@@ -69,7 +69,7 @@ int main(int argc, const char **argv) {
             }
             
             auto tag_count = map.size();
-            int skip = *reinterpret_cast<std::uint32_t *>(input_map.data()) != 3 ? 1 : 0;
+            int skip = input_map_type != 3 ? 1 : 0;
 
             // Open the output!
             std::FILE *f = std::fopen(output, "wb");
@@ -78,7 +78,7 @@ int main(int argc, const char **argv) {
             try {
                 for(std::size_t i = skip; i < tag_count; i+= 1 + skip) {
                     auto &tag = map[i];
-                    std::fprintf(f, "%s%s\n", tag.path.c_str(), extension);
+                    std::fprintf(f, "%s%s\n", tag.path().c_str(), extension);
                 }
             }
             catch(std::exception &) {
@@ -96,7 +96,7 @@ int main(int argc, const char **argv) {
     // If not, it's probably a cache file
     else {
         try {
-            auto map = Map::map_with_move(std::move(input_map));
+            auto map = Map::map_with_mapping(input);
 
             // Open output
             std::FILE *f = std::fopen(output, "wb");
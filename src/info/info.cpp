@@ -1,6 +1,11 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
 #include <optional>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <variant>
 #include <invader/map/map.hpp>
 #include <invader/file/file.hpp>
 #include "../command_line_option.hpp"
@@ -13,247 +18,153 @@
 #include "language/language.hpp"
 #include "info_def.hpp"
 
-#define BYTES_TO_MiB(bytes) ((bytes) / 1024.0 / 1024.0)
-
 struct DisplayValue {
     const char * const name;
-    void (* const calculate_value)(const Invader::Map &map);
+    Invader::Info::Value (* const calculate_value)(Invader::Info::MapInfo &info);
 };
 
 #define MAKE_DISPLAY_VALUE(name) {# name, Invader::Info::name }
 
-static std::byte header_cache[sizeof(Invader::HEK::NativeCacheFileHeader)];
-static std::size_t file_size = 0;
-
-// Calculating compression ratio:
-//
-//     1. Take the length of the data after the header, since that's what's compressed
-//     2. Divide the length of that data by the length of the data after the header when uncompressed.
-//
-//        So, if a map is 15 MiB compressed and 20 MiB uncompressed, the compression ratio is 0.75.
-//
-static double calculate_compression_ratio(const Invader::Map &map) {
-    auto uncompressed_length = map.get_data_length() - sizeof(Invader::HEK::CacheFileHeader);
-    auto compressed_length = file_size - sizeof(Invader::HEK::CacheFileHeader);
-    return static_cast<double>(compressed_length) / uncompressed_length;
-}
-
-namespace Invader::Info {
-    void compression_ratio(const Invader::Map &map) {
-        oprintf("%f\n", calculate_compression_ratio(map));
+// Get the length of the valid UTF-8 sequence at the given byte, or 0 if there isn't one
+static std::size_t utf8_sequence_length(const unsigned char *c) {
+    std::size_t length;
+    unsigned char min = 0x80, max = 0xBF;
+    if(*c >= 0xC2 && *c <= 0xDF) {
+        length = 2;
+    }
+    else if(*c >= 0xE0 && *c <= 0xEF) {
+        length = 3;
+        min = *c == 0xE0 ? 0xA0 : 0x80; // overlong
+        max = *c == 0xED ? 0x9F : 0xBF; // surrogates
+    }
+    else if(*c >= 0xF0 && *c <= 0xF4) {
+        length = 4;
+        min = *c == 0xF0 ? 0x90 : 0x80; // overlong
+        max = *c == 0xF4 ? 0x8F : 0xBF; // past U+10FFFF
+    }
+    else {
+        return 0;
     }
     
-    void overview(const Invader::Map &map) {
-        #define PRINT_LINE(function, key, format, ...) function("%-19s" format, key, __VA_ARGS__)
-        
-        // Basic metadata
-        PRINT_LINE(oprintf, "Scenario name:", "%s\n", map.get_scenario_name());
-        
-        auto cache_version = map.get_cache_version();
-        auto &game_engine_info = HEK::GameEngineInfo::get_game_engine_info(map.get_game_engine());
-        PRINT_LINE(oprintf, "Engine:", "%s\n", game_engine_info.name);
-        
-        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
-            PRINT_LINE(oprintf, "Timestamp:", "%s\n", reinterpret_cast<Invader::HEK::NativeCacheFileHeader *>(header_cache)->timestamp.string);
+    for(std::size_t i = 1; i < length; i++) {
+        if(c[i] < (i == 1 ? min : 0x80) || c[i] > (i == 1 ? max : 0xBF)) {
+            return 0;
         }
-        
-        auto build_string = map.get_build();
-        
-        if(std::strlen(build_string) != 0) {
-            PRINT_LINE(oprintf, "Build string:", "%s\n", build_string);
+    }
+    return length;
+}
+
+static void print_json_string(const char *string) {
+    oprintf("\"");
+    for(const char *c = string; *c; c++) {
+        auto byte = static_cast<unsigned char>(*c);
+        switch(*c) {
+            case '"':
+                oprintf("\\\"");
+                break;
+            case '\\':
+                oprintf("\\\\");
+                break;
+            default:
+                // Map paths are passed through as UTF-8, but anything that isn't valid UTF-8 (such as Latin-1 strings in
+                // the map) is escaped byte by byte so the output is still valid JSON
+                if(byte < 0x20) {
+                    oprintf("\\u%04x", byte);
+                }
+                else if(byte < 0x80) {
+                    std::fputc(*c, stdout);
+                }
+                else if(auto length = utf8_sequence_length(reinterpret_cast<const unsigned char *>(c)); length > 0) {
+                    std::fwrite(c, 1, length, stdout);
+                    c += length - 1;
+                }
+                else {
+                    oprintf("\\u%04x", byte);
+                }
+                break;
         }
+    }
+    oprintf("\"");
+}
+
+static void print_value(const Invader::Info::Value &value, bool json) {
+    using namespace Invader::Info;
+    
+    std::visit([json](const auto &v) {
+        using T = std::decay_t<decltype(v)>;
         
-        auto map_type = map.get_type();
-        
-        if(map_type == map.get_header_type()) {
-            PRINT_LINE(oprintf_success, "Map type:", "%s (matches header)", type_name(map_type));
+        if constexpr(std::is_same_v<T, bool>) {
+            oprintf(json ? "%s" : "%s\n", json ? (v ? "true" : "false") : (v ? "1" : "0"));
         }
-        else {
-            PRINT_LINE(oprintf_success_warn, "Map type:", "%s (mismatched)", type_name(map_type));
+        else if constexpr(std::is_same_v<T, std::uint64_t>) {
+            oprintf(json ? "%llu" : "%llu\n", static_cast<unsigned long long>(v));
         }
-        
-        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_MCC_CEA) {
-            if(reinterpret_cast<Invader::HEK::CacheFileHeaderCEA *>(header_cache)->flags & HEK::CacheFileHeaderCEAFlags::CACHE_FILE_HEADER_CEA_FLAGS_CLASSIC_ONLY) {
-                PRINT_LINE(oprintf_success, "Classic:", "%s", "Yes");
+        else if constexpr(std::is_same_v<T, double>) {
+            if(json && !std::isfinite(v)) {
+                oprintf("null");
             }
             else {
-                PRINT_LINE(oprintf_success_lesser_warn, "Classic:", "%s", "No");
+                oprintf(json ? "%f" : "%f\n", v);
             }
         }
-        
-        // Tag count, are any stubbed?
-        auto tag_count = map.get_tag_count();
-        auto tag_data_size = BYTES_TO_MiB(map.get_tag_data_length());
-        auto stub_count = calculate_stub_count(map);
-        
-        if(stub_count == 0) {
-            PRINT_LINE(oprintf_success, "Tags:", "%zu / %zu (%.02f MiB)", tag_count, HEK::CacheFileLimits::CACHE_FILE_MAX_TAG_COUNT, tag_data_size);
-        }
-        else {
-            PRINT_LINE(oprintf_success_lesser_warn, "Tags:", "%zu / %zu (%.02f MiB), %zu stubbed", tag_count, HEK::CacheFileLimits::CACHE_FILE_MAX_TAG_COUNT, tag_data_size, stub_count);
-        }
-        
-        auto crc = map.get_crc32();
-        auto crc_matches = map.get_header_crc32() == crc;
-        
-        // TODODILE: Figure out how to check an Xbox map's integrity
-        if(cache_version != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-            // CRC32
-            if(crc_matches) {
-                PRINT_LINE(oprintf_success, "CRC32:", "0x%08X (matches header)", crc);
+        else if constexpr(std::is_same_v<T, std::string>) {
+            if(json) {
+                print_json_string(v.c_str());
             }
             else {
-                PRINT_LINE(oprintf_success_warn, "CRC32:", "0x%08X (mismatched)", crc);
+                oprintf("%s\n", v.c_str());
             }
-            
-            // Dirty?
-            if(map.is_clean()) {
-                PRINT_LINE(oprintf_success, "Integrity:", "%s", "Clean");
-            }
-            else {
-                PRINT_LINE(oprintf_success_warn, "Integrity:", "%s", "Dirty (map may be corrupted or modified)");
-            }
-        }
-        
-        // Protected?
-        std::vector<std::string> protection_reasons;
-        if(!map.is_protected(protection_reasons)) {
-            PRINT_LINE(oprintf_success, "Protected:", "%s", "No (probably)");
         }
-        else {
-            PRINT_LINE(oprintf_success_warn, "Protected:", "%s (probably - %zu issue%s)", "Yes", protection_reasons.size(), protection_reasons.size() == 1 ? "" : "s");
-        }
-        
-        std::size_t external_bitmaps = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true).size();
-        std::size_t external_sounds = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true).size();
-        std::size_t external_loc = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, true).size();
-        std::size_t total_external = external_bitmaps + external_sounds + external_loc;
-        
-        if(cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE && cache_version != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
-            if(total_external == 0) {
-                PRINT_LINE(oprintf_success, "External tags:", "%s", "None");
-            }
-            else if(cache_version == HEK::CacheFileEngine::CACHE_FILE_CUSTOM_EDITION) {
-                PRINT_LINE(oprintf_success_lesser_warn, "External tags:", "%zu (%zu bitmap%s, %zu loc, %zu sound%s)", total_external, external_bitmaps, external_bitmaps == 1 ? "" : "s", external_loc, external_sounds, external_sounds == 1 ? "" : "s");
-                
-                // If we're custom edition we need to see if they're at least all indexed
-                std::size_t indexed_bitmaps = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, false).size();
-                std::size_t indexed_sounds = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, false).size();
-                std::size_t indexed_loc = find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, false).size();
-                std::size_t total_indexed = indexed_bitmaps + indexed_sounds + indexed_loc;
-                
-                // If not, that's bad
-                if(total_indexed != total_external) {
-                    PRINT_LINE(oprintf_success_warn, "Indexed tags:", "%zu (%zu bitmap%s, %zu loc, %zu sound%s)", total_indexed, indexed_bitmaps, indexed_bitmaps == 1 ? "" : "s", indexed_loc, indexed_sounds, indexed_sounds == 1 ? "" : "s");
-                }
-                else {
-                    PRINT_LINE(oprintf_success, "Indexed tags:", "%zu (%zu bitmap%s, %zu loc, %zu sound%s)", total_indexed, indexed_bitmaps, indexed_bitmaps == 1 ? "" : "s", indexed_loc, indexed_sounds, indexed_sounds == 1 ? "" : "s");
+        else if constexpr(std::is_same_v<T, std::vector<std::string>>) {
+            if(json) {
+                oprintf("[");
+                for(std::size_t i = 0; i < v.size(); i++) {
+                    if(i) {
+                        oprintf(",");
+                    }
+                    print_json_string(v[i].c_str());
                 }
+                oprintf("]");
             }
-            else {
-                PRINT_LINE(oprintf_success_warn, "External tags:", "%zu (%zu bitmap%s, %zu sound%s)", total_external, external_bitmaps, external_bitmaps == 1 ? "" : "s", external_sounds, external_sounds == 1 ? "" : "s");
+            else for(auto &i : v) {
+                oprintf("%s\n", i.c_str());
             }
         }
-        
-        // Check tag order
-        switch(check_tag_order(map)) {
-            case CHECK_TAG_ORDER_RESULT_UNKNOWN:
-                break;
-            case CHECK_TAG_ORDER_RESULT_MATCHED:
-                PRINT_LINE(oprintf_success, "Stock tag order:", "%s", "Matched");
-                break;
-            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED:
-                PRINT_LINE(oprintf_success_lesser_warn, "Stock tag order:", "%s", "Network compatible (probably) but tags do not match");
-                break;
-            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_HOST:
-                PRINT_LINE(oprintf_success_warn, "Stock tag order:", "%s", "Host only (may crash if joining a stock host as a client)");
-                break;
-            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_CLIENT:
-                PRINT_LINE(oprintf_success_warn, "Stock tag order:", "%s", "Client only (may crash clients if joining with stock map)");
-                break;
-            case CHECK_TAG_ORDER_RESULT_MISMATCHED_TAGS:
-                PRINT_LINE(oprintf_fail, "Stock tag order:", "%s", "Mismatched (game may crash)");
-                break;
-        }
-        
-        // Languages?
-        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_CUSTOM_EDITION) {
-            bool any;
-            auto languages = find_languages_for_map(map, any);
-            if(any) {
-                PRINT_LINE(oprintf_success, "Valid languages:", "%s", "Any (map will work on all original releases of the game)");
-            }
-            else if(languages.size() == 0) {
-                if(!check_if_valid_indexed_tags_for_stock_custom_edition(map)) {
-                    PRINT_LINE(oprintf_success_warn, "Valid languages:", "%s", "None (map contains invalid indices for stock resource maps)");
-                }
-                else {
-                    PRINT_LINE(oprintf_success_warn, "Valid languages:", "%s", "None (map was built against custom resource maps)");
-                }
-            }
-            else {
-                std::string list;
-                for(auto &i : languages) {
-                    if(list.size() == 0) {
-                        list = i;
-                    }
-                    else {
-                        list += ", ";
-                        list += i;
+        else if constexpr(std::is_same_v<T, std::vector<OverviewLine>>) {
+            if(json) {
+                oprintf("{");
+                for(std::size_t i = 0; i < v.size(); i++) {
+                    if(i) {
+                        oprintf(",");
                     }
+                    print_json_string(v[i].key);
+                    oprintf(":");
+                    print_json_string(v[i].value.c_str());
                 }
-                PRINT_LINE(oprintf_success_warn, "Valid languages:", "%s", list.c_str());
-            }
-        }
-        
-        // Compressed?
-        Map::CompressionType compression_type;
-        if((compression_type = map.get_compression_algorithm())) {
-            const char *compression_algorithm = "";
-            
-            switch(compression_type) {
-                case Map::CompressionType::COMPRESSION_TYPE_NONE:
-                    std::terminate();
-                case Map::CompressionType::COMPRESSION_TYPE_DEFLATE:
-                    compression_algorithm = "Deflate";
-                    break;
-            }
-            
-            PRINT_LINE(oprintf, "Compressed:", "Yes (%.02f %%) via %s\n", calculate_compression_ratio(map) * 100.0, compression_algorithm);
-        }
-        else {
-            PRINT_LINE(oprintf, "Compressed:", "%s\n", "No");
-        }
-        
-        // Uncompressed size
-        auto max_uncompressed_size = game_engine_info.get_maximum_file_size(map_type);
-        bool size_mismatched = map.get_data_length() != map.get_header_decompressed_file_size();
-        
-        if(max_uncompressed_size <= UINT32_MAX) {
-            auto num = BYTES_TO_MiB(map.get_data_length());
-            auto den = BYTES_TO_MiB(max_uncompressed_size);
-            
-            char uncompressed_size[128];
-            std::snprintf(uncompressed_size, sizeof(uncompressed_size), "%.02f / %.02f MiB (%.02f %%)%s", num, den, 100.0 * num / den, size_mismatched ? " (mismatched)" : " (matches header)");
-            
-            if(num > den || size_mismatched) {
-                PRINT_LINE(oprintf_success_warn, "Uncompressed size:", "%s", uncompressed_size);
-            }
-            else {
-                PRINT_LINE(oprintf_success, "Uncompressed size:", "%s", uncompressed_size);
-            }
-        }
-        else {
-            if(size_mismatched) {
-                PRINT_LINE(oprintf_success_warn, "Uncompressed size:", "%.02f MiB (mismatched)", BYTES_TO_MiB(map.get_data_length()));
+                oprintf("}");
             }
-            else {
-                PRINT_LINE(oprintf_success, "Uncompressed size:", "%.02f MiB (matches header)", BYTES_TO_MiB(map.get_data_length()));
+            else for(auto &i : v) {
+                auto key = std::string(i.key) + ":";
+                switch(i.level) {
+                    case OverviewLine::LEVEL_PLAIN:
+                        oprintf("%-19s%s\n", key.c_str(), i.value.c_str());
+                        break;
+                    case OverviewLine::LEVEL_SUCCESS:
+                        oprintf_success("%-19s%s", key.c_str(), i.value.c_str());
+                        break;
+                    case OverviewLine::LEVEL_LESSER_WARN:
+                        oprintf_success_lesser_warn("%-19s%s", key.c_str(), i.value.c_str());
+                        break;
+                    case OverviewLine::LEVEL_WARN:
+                        oprintf_success_warn("%-19s%s", key.c_str(), i.value.c_str());
+                        break;
+                    case OverviewLine::LEVEL_FAIL:
+                        oprintf_fail("%-19s%s", key.c_str(), i.value.c_str());
+                        break;
+                }
             }
         }
-        
-        #undef PRINT_LINE
-    }
+    }, value);
 }
 
 static DisplayValue all_values[] = {
@@ -321,7 +232,9 @@ int main(int argc, const char **argv) {
 
     // Options struct
     struct MapInfoOptions {
-        const DisplayValue *type = &all_values[0];
+        std::vector<const DisplayValue *> types;
+        std::size_t thread_count = 1;
+        bool json = false;
     } map_info_options;
     
     // Form the options list
@@ -329,7 +242,7 @@ int main(int argc, const char **argv) {
     bool overview_added = false;
     for(auto &i : all_values) {
         if(!overview_added) {
-            options_list += "Set the type of data to show. Can be overview (default)";
+            options_list += "Set the type of data to show. Use multiple times to show more types. Can be overview (default)";
             overview_added = true;
         }
         else {
@@ -341,21 +254,23 @@ int main(int argc, const char **argv) {
     // Command line options
     const CommandLineOption options[] = {
         CommandLineOption("type", 'T', 1, options_list.c_str(), "<type>"),
+        CommandLineOption("json", 'J', 0, "Show the data as JSON, with one object per map on each line."),
+        CommandLineOption("threads", 'j', 1, "Set the number of maps to check at once. This does not change the output. Default: 1", "<count>"),
         CommandLineOption::from_preset(CommandLineOption::PRESET_COMMAND_LINE_OPTION_INFO)
     };
 
     static constexpr char DESCRIPTION[] = "Display map metadata.";
-    static constexpr char USAGE[] = "[option] <map>";
+    static constexpr char USAGE[] = "[options] <map> [<map> ...]";
 
     // Do it!
-    auto remaining_arguments = Invader::CommandLineOption::parse_arguments<MapInfoOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 1, map_info_options, [](char opt, const auto &args, auto &map_info_options) {
+    auto remaining_arguments = Invader::CommandLineOption::parse_arguments<MapInfoOptions &>(argc, argv, options, USAGE, DESCRIPTION, 1, 65535, map_info_options, [](char opt, const auto &args, auto &map_info_options) {
         switch(opt) {
             case 'T': {
                 bool found = false;
                 
                 for(auto &i : all_values) {
                     if(std::strcmp(args[0], i.name) == 0) {
-                        map_info_options.type = &i;
+                        map_info_options.types.push_back(&i);
                         found = true;
                         break;
                     }
@@ -367,30 +282,133 @@ int main(int argc, const char **argv) {
                 }
                 break;
             }
+            case 'J':
+                map_info_options.json = true;
+                break;
+            case 'j':
+                try {
+                    map_info_options.thread_count = std::stoul(args[0]);
+                    if(map_info_options.thread_count < 1) {
+                        throw std::exception();
+                    }
+                }
+                catch(std::exception &) {
+                    eprintf_error("Invalid number of threads %s", args[0]);
+                    std::exit(EXIT_FAILURE);
+                }
+                break;
             case 'i':
                 Invader::show_version_info();
                 std::exit(EXIT_SUCCESS);
         }
     });
-
-    // Load it
-    std::unique_ptr<Map> map;
-    try {
-        auto file = File::open_file(remaining_arguments[0]).value();
-        file_size = file.size();
-        if(file_size >= sizeof(header_cache)) {
-            std::memcpy(header_cache, file.data(), sizeof(header_cache));
+    
+    auto &types = map_info_options.types;
+    if(types.empty()) {
+        types.push_back(&all_values[0]);
+    }
+    
+    bool json = map_info_options.json;
+    std::size_t map_count = remaining_arguments.size();
+    
+    // Each map is loaded, checked, and unloaded by one thread, and then its values are shown once every map before it
+    // has been shown. A thread does not take another map until its values are shown, so no more than one map per thread
+    // is ever loaded at once.
+    std::mutex mutex;
+    std::condition_variable shown;
+    std::size_t next_map = 0;
+    std::size_t next_shown = 0;
+    bool failed = false;
+    
+    // The CRC32 is calculated with every CPU thread unless we're already checking maps on several threads
+    std::size_t thread_count = std::min(map_info_options.thread_count, map_count);
+    std::size_t crc_thread_count = thread_count > 1 ? 1 : 0;
+    
+    auto check_maps = [&]() {
+        while(true) {
+            std::size_t m;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if(next_map == map_count) {
+                    return;
+                }
+                m = next_map++;
+            }
+            
+            const char *path = remaining_arguments[m];
+            std::vector<Info::Value> values;
+            std::optional<std::string> error;
+            
+            // Anything printed while loading and checking the map is held until it's this map's turn
+            std::string errors_printed;
+            set_stderr_capture(&errors_printed);
+            try {
+                Info::MapInfo info(path, crc_thread_count);
+                values.reserve(types.size());
+                for(auto *type : types) {
+                    values.emplace_back(type->calculate_value(info));
+                }
+            }
+            catch(std::exception &e) {
+                error = e.what();
+            }
+            set_stderr_capture(nullptr);
+            
+            std::unique_lock<std::mutex> lock(mutex);
+            shown.wait(lock, [&]() { return next_shown == m; });
+            
+            std::fputs(errors_printed.c_str(), stderr);
+            
+            if(error.has_value()) {
+                failed = true;
+                if(json) {
+                    oprintf("{\"map\":");
+                    print_json_string(path);
+                    oprintf(",\"error\":");
+                    print_json_string(error->c_str());
+                    oprintf("}\n");
+                }
+                else {
+                    eprintf_error("Failed to parse %s: %s", path, error->c_str());
+                }
+            }
+            else if(json) {
+                oprintf("{\"map\":");
+                print_json_string(path);
+                for(std::size_t t = 0; t < types.size(); t++) {
+                    oprintf(",");
+                    print_json_string(types[t]->name);
+                    oprintf(":");
+                    print_value(values[t], true);
+                }
+                oprintf("}\n");
+            }
+            else {
+                if(map_count > 1) {
+                    oprintf("%s==> %s <==\n", m == 0 ? "" : "\n", path);
+                }
+                for(std::size_t t = 0; t < types.size(); t++) {
+                    if(types.size() > 1) {
+                        oprintf("%s:\n", types[t]->name);
+                    }
+                    print_value(values[t], false);
+                }
+            }
+            oflush();
+            
+            next_shown++;
+            shown.notify_all();
         }
-        
-        map = std::make_unique<Map>(Map::map_with_move(std::move(file)));
+    };
+    
+    std::vector<std::thread> threads;
+    for(std::size_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(check_maps);
     }
-    catch (std::exception &e) {
-        eprintf_error("Failed to parse %s: %s", remaining_arguments[0], e.what());
-        return EXIT_FAILURE;
+    check_maps();
+    for(auto &t : threads) {
+        t.join();
     }
     
-    // Do it!
-    map_info_options.type->calculate_value(*map);
-    
-    return EXIT_SUCCESS;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
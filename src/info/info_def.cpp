@@ -1,5 +1,8 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <invader/map/map.hpp>
 #include <invader/printf.hpp>
 #include <invader/file/file.hpp>
@@ -10,11 +13,18 @@
 #include "info_def.hpp"
 
 namespace Invader::Info {
-    static void print_all_indices(const Invader::Map &map, const std::vector<std::size_t> &indices) {
+    static std::string tag_path_for_index(const Invader::Map &map, std::size_t index) {
+        auto &tag = map.get_tag(index);
+        return File::halo_path_to_preferred_path(tag.get_path()) + "." + HEK::tag_fourcc_to_extension(tag.get_tag_fourcc());
+    }
+    
+    static std::vector<std::string> all_indices(const Invader::Map &map, const std::vector<std::size_t> &indices) {
+        std::vector<std::string> paths;
+        paths.reserve(indices.size());
         for(auto i : indices) {
-            auto &tag = map.get_tag(i);
-            oprintf("%s.%s\n", File::halo_path_to_preferred_path(tag.get_path()).c_str(), HEK::tag_fourcc_to_extension(tag.get_tag_fourcc()));
+            paths.emplace_back(tag_path_for_index(map, i));
         }
+        return paths;
     }
     
     static std::vector<std::pair<std::size_t, std::size_t>> resource_offsets_for_tag(const Invader::Tag &tag) {
@@ -287,22 +297,20 @@ namespace Invader::Info {
                 return {};
             }
             
-            // Now compile a list of offsets
-            std::vector<std::size_t> bitmap_offsets, bitmap_sizes, sound_offsets, sound_sizes;
-            for(std::size_t i = 0; i < tag_count; i++) {
+            // Narrow down the languages in one pass, stopping once nothing matches
+            auto matched = get_all_languages();
+            for(std::size_t i = 0; i < tag_count && matched != 0; i++) {
                 auto &tag = map.get_tag(i);
                 switch(tag.get_tag_fourcc()) {
                     case HEK::TagFourCC::TAG_FOURCC_SOUND:
                         for(auto &i : resource_offsets_for_tag(tag)) {
-                            sound_offsets.push_back(i.first);
-                            sound_sizes.push_back(i.second);
+                            matched &= get_languages_for_sound_resource(i.first, i.second);
                         }
                         break;
                     
                     case HEK::TagFourCC::TAG_FOURCC_BITMAP:
                         for(auto &i : resource_offsets_for_tag(tag)) {
-                            bitmap_offsets.push_back(i.first);
-                            bitmap_sizes.push_back(i.second);
+                            matched &= get_languages_for_bitmap_resource(i.first, i.second);
                         }
                         break;
                     
@@ -311,196 +319,490 @@ namespace Invader::Info {
                 }
             }
             
-            // Crunch it
-            languages = get_languages_for_resources(bitmap_offsets.data(), bitmap_sizes.data(), bitmap_sizes.size(), sound_offsets.data(), sound_sizes.data(), sound_sizes.size(), all);
+            all = matched == get_all_languages();
+            languages = get_language_names(matched);
         }
         
         return languages;
     }
     
-    void build(const Invader::Map &map) {
-        oprintf("%s\n", map.get_build());
+    MapInfo::MapInfo(const std::filesystem::path &path, std::size_t crc_thread_count) : map(Map::map_with_mapping(path)), crc_thread_count(crc_thread_count) {
+        // Only read the header ourselves; the map itself is mapped or, if compressed, decompressed straight from the file
+        std::FILE *f = std::fopen(path.string().c_str(), "rb");
+        if(!f) {
+            throw FailedToOpenFileException();
+        }
+        if(std::fread(this->header, sizeof(this->header), 1, f) != 1) {
+            std::memset(this->header, 0, sizeof(this->header));
+        }
+        std::fclose(f);
+        this->file_size = std::filesystem::file_size(path);
+    }
+    
+    // Calculating compression ratio:
+    //
+    //     1. Take the length of the data after the header, since that's what's compressed
+    //     2. Divide the length of that data by the length of the data after the header when uncompressed.
+    //
+    //        So, if a map is 15 MiB compressed and 20 MiB uncompressed, the compression ratio is 0.75.
+    //
+    double MapInfo::get_compression_ratio() const noexcept {
+        auto uncompressed_length = this->map.get_data_length() - sizeof(HEK::CacheFileHeader);
+        auto compressed_length = this->file_size - sizeof(HEK::CacheFileHeader);
+        return static_cast<double>(compressed_length) / uncompressed_length;
+    }
+    
+    std::uint32_t MapInfo::get_crc32() {
+        if(!this->crc32.has_value()) {
+            this->crc32 = this->map.get_crc32(this->crc_thread_count);
+        }
+        return *this->crc32;
+    }
+    
+    bool MapInfo::is_clean() {
+        if(!this->clean.has_value()) {
+            this->clean = this->map.is_clean(this->crc_thread_count);
+        }
+        return *this->clean;
+    }
+    
+    const std::vector<std::size_t> &MapInfo::get_external_tags_indices(std::optional<Map::DataMapType> data_type, bool by_index, bool by_resource, bool inverted) {
+        auto key = std::make_tuple(data_type, by_index, by_resource, inverted);
+        auto found = this->external_tags_indices.find(key);
+        if(found == this->external_tags_indices.end()) {
+            found = this->external_tags_indices.emplace(key, find_external_tags_indices(this->map, data_type, by_index, by_resource, inverted)).first;
+        }
+        return found->second;
+    }
+    
+    std::size_t MapInfo::get_stub_count() {
+        if(!this->stub_count.has_value()) {
+            this->stub_count = calculate_stub_count(this->map);
+        }
+        return *this->stub_count;
+    }
+    
+    bool MapInfo::has_valid_indexed_tags_for_stock_custom_edition() {
+        if(!this->valid_indexed_tags.has_value()) {
+            this->valid_indexed_tags = check_if_valid_indexed_tags_for_stock_custom_edition(this->map);
+        }
+        return *this->valid_indexed_tags;
     }
     
-    void crc32(const Invader::Map &map) {
-        oprintf("0x%08X\n", map.get_crc32());
+    const std::vector<std::string> &MapInfo::get_languages(bool &all) {
+        if(!this->languages.has_value()) {
+            this->languages = find_languages_for_map(this->map, this->all_languages);
+        }
+        all = this->all_languages;
+        return *this->languages;
     }
-    void crc32_mismatched(const Invader::Map &map) {
-        oprintf("%i\n", map.get_crc32() != map.get_header_crc32());
+    
+    CheckTagOrderResult MapInfo::get_tag_order() {
+        if(!this->tag_order.has_value()) {
+            this->tag_order = check_tag_order(this->map);
+        }
+        return *this->tag_order;
     }
     
-    void engine(const Invader::Map &map) {
-        oprintf("%s\n", HEK::GameEngineInfo::get_game_engine_info(map.get_game_engine()).name);
+    const std::vector<std::string> &MapInfo::get_protection_issues() {
+        if(!this->protection_issues.has_value()) {
+            this->map.is_protected(this->protection_issues.emplace());
+        }
+        return *this->protection_issues;
     }
     
-    void external_bitmap_indices_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, false).size());
+    #define BYTES_TO_MiB(bytes) ((bytes) / 1024.0 / 1024.0)
+    
+    static void add_overview_line(std::vector<OverviewLine> &lines, OverviewLine::Level level, const char *key, const char *format, ...) {
+        char value[512];
+        std::va_list args;
+        va_start(args, format);
+        std::vsnprintf(value, sizeof(value), format, args);
+        va_end(args);
+        lines.emplace_back(OverviewLine { level, key, value });
     }
-    void external_bitmaps_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true).size());
+    
+    Value overview(MapInfo &info) {
+        #define ADD_LINE(level, key, ...) add_overview_line(lines, level, key, __VA_ARGS__)
+        
+        auto &map = info.get_map();
+        std::vector<OverviewLine> lines;
+        using enum OverviewLine::Level;
+        
+        // Basic metadata
+        ADD_LINE(LEVEL_PLAIN, "Scenario name", "%s", map.get_scenario_name());
+        
+        auto cache_version = map.get_cache_version();
+        auto &game_engine_info = HEK::GameEngineInfo::get_game_engine_info(map.get_game_engine());
+        ADD_LINE(LEVEL_PLAIN, "Engine", "%s", game_engine_info.name);
+        
+        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
+            ADD_LINE(LEVEL_PLAIN, "Timestamp", "%s", reinterpret_cast<const HEK::NativeCacheFileHeader *>(info.get_header())->timestamp.string);
+        }
+        
+        auto build_string = map.get_build();
+        
+        if(std::strlen(build_string) != 0) {
+            ADD_LINE(LEVEL_PLAIN, "Build string", "%s", build_string);
+        }
+        
+        auto map_type = map.get_type();
+        
+        if(map_type == map.get_header_type()) {
+            ADD_LINE(LEVEL_SUCCESS, "Map type", "%s (matches header)", type_name(map_type));
+        }
+        else {
+            ADD_LINE(LEVEL_WARN, "Map type", "%s (mismatched)", type_name(map_type));
+        }
+        
+        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_MCC_CEA) {
+            if(reinterpret_cast<const HEK::CacheFileHeaderCEA *>(info.get_header())->flags & HEK::CacheFileHeaderCEAFlags::CACHE_FILE_HEADER_CEA_FLAGS_CLASSIC_ONLY) {
+                ADD_LINE(LEVEL_SUCCESS, "Classic", "%s", "Yes");
+            }
+            else {
+                ADD_LINE(LEVEL_LESSER_WARN, "Classic", "%s", "No");
+            }
+        }
+        
+        // Tag count, are any stubbed?
+        auto tag_count = map.get_tag_count();
+        auto tag_data_size = BYTES_TO_MiB(map.get_tag_data_length());
+        auto stub_count = info.get_stub_count();
+        
+        if(stub_count == 0) {
+            ADD_LINE(LEVEL_SUCCESS, "Tags", "%zu / %zu (%.02f MiB)", tag_count, HEK::CacheFileLimits::CACHE_FILE_MAX_TAG_COUNT, tag_data_size);
+        }
+        else {
+            ADD_LINE(LEVEL_LESSER_WARN, "Tags", "%zu / %zu (%.02f MiB), %zu stubbed", tag_count, HEK::CacheFileLimits::CACHE_FILE_MAX_TAG_COUNT, tag_data_size, stub_count);
+        }
+        
+        // TODODILE: Figure out how to check an Xbox map's integrity
+        if(cache_version != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
+            auto crc = info.get_crc32();
+            auto crc_matches = map.get_header_crc32() == crc;
+            
+            // CRC32
+            if(crc_matches) {
+                ADD_LINE(LEVEL_SUCCESS, "CRC32", "0x%08X (matches header)", crc);
+            }
+            else {
+                ADD_LINE(LEVEL_WARN, "CRC32", "0x%08X (mismatched)", crc);
+            }
+            
+            // Dirty?
+            if(info.is_clean()) {
+                ADD_LINE(LEVEL_SUCCESS, "Integrity", "%s", "Clean");
+            }
+            else {
+                ADD_LINE(LEVEL_WARN, "Integrity", "%s", "Dirty (map may be corrupted or modified)");
+            }
+        }
+        
+        // Protected?
+        auto &protection_reasons = info.get_protection_issues();
+        if(protection_reasons.empty()) {
+            ADD_LINE(LEVEL_SUCCESS, "Protected", "%s", "No (probably)");
+        }
+        else {
+            ADD_LINE(LEVEL_WARN, "Protected", "%s (probably - %zu issue%s)", "Yes", protection_reasons.size(), protection_reasons.size() == 1 ? "" : "s");
+        }
+        
+        if(cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE && cache_version != HEK::CacheFileEngine::CACHE_FILE_XBOX) {
+            std::size_t external_bitmaps = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true).size();
+            std::size_t external_sounds = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true).size();
+            std::size_t external_loc = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, true).size();
+            std::size_t total_external = external_bitmaps + external_sounds + external_loc;
+            
+            if(total_external == 0) {
+                ADD_LINE(LEVEL_SUCCESS, "External tags", "%s", "None");
+            }
+            else if(cache_version == HEK::CacheFileEngine::CACHE_FILE_CUSTOM_EDITION) {
+                ADD_LINE(LEVEL_LESSER_WARN, "External tags", "%zu (%zu bitmap%s, %zu loc, %zu sound%s)", total_external, external_bitmaps, external_bitmaps == 1 ? "" : "s", external_loc, external_sounds, external_sounds == 1 ? "" : "s");
+                
+                // If we're custom edition we need to see if they're at least all indexed
+                std::size_t indexed_bitmaps = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, false).size();
+                std::size_t indexed_sounds = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, false).size();
+                std::size_t indexed_loc = info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, false).size();
+                std::size_t total_indexed = indexed_bitmaps + indexed_sounds + indexed_loc;
+                
+                // If not, that's bad
+                ADD_LINE(total_indexed != total_external ? LEVEL_WARN : LEVEL_SUCCESS, "Indexed tags", "%zu (%zu bitmap%s, %zu loc, %zu sound%s)", total_indexed, indexed_bitmaps, indexed_bitmaps == 1 ? "" : "s", indexed_loc, indexed_sounds, indexed_sounds == 1 ? "" : "s");
+            }
+            else {
+                ADD_LINE(LEVEL_WARN, "External tags", "%zu (%zu bitmap%s, %zu sound%s)", total_external, external_bitmaps, external_bitmaps == 1 ? "" : "s", external_sounds, external_sounds == 1 ? "" : "s");
+            }
+        }
+        
+        // Check tag order
+        switch(info.get_tag_order()) {
+            case CHECK_TAG_ORDER_RESULT_UNKNOWN:
+                break;
+            case CHECK_TAG_ORDER_RESULT_MATCHED:
+                ADD_LINE(LEVEL_SUCCESS, "Stock tag order", "%s", "Matched");
+                break;
+            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED:
+                ADD_LINE(LEVEL_LESSER_WARN, "Stock tag order", "%s", "Network compatible (probably) but tags do not match");
+                break;
+            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_HOST:
+                ADD_LINE(LEVEL_WARN, "Stock tag order", "%s", "Host only (may crash if joining a stock host as a client)");
+                break;
+            case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_CLIENT:
+                ADD_LINE(LEVEL_WARN, "Stock tag order", "%s", "Client only (may crash clients if joining with stock map)");
+                break;
+            case CHECK_TAG_ORDER_RESULT_MISMATCHED_TAGS:
+                ADD_LINE(LEVEL_FAIL, "Stock tag order", "%s", "Mismatched (game may crash)");
+                break;
+        }
+        
+        // Languages?
+        if(cache_version == HEK::CacheFileEngine::CACHE_FILE_CUSTOM_EDITION) {
+            bool any;
+            auto &languages = info.get_languages(any);
+            if(any) {
+                ADD_LINE(LEVEL_SUCCESS, "Valid languages", "%s", "Any (map will work on all original releases of the game)");
+            }
+            else if(languages.size() == 0) {
+                if(!info.has_valid_indexed_tags_for_stock_custom_edition()) {
+                    ADD_LINE(LEVEL_WARN, "Valid languages", "%s", "None (map contains invalid indices for stock resource maps)");
+                }
+                else {
+                    ADD_LINE(LEVEL_WARN, "Valid languages", "%s", "None (map was built against custom resource maps)");
+                }
+            }
+            else {
+                std::string list;
+                for(auto &i : languages) {
+                    if(list.size() == 0) {
+                        list = i;
+                    }
+                    else {
+                        list += ", ";
+                        list += i;
+                    }
+                }
+                ADD_LINE(LEVEL_WARN, "Valid languages", "%s", list.c_str());
+            }
+        }
+        
+        // Compressed?
+        Map::CompressionType compression_type;
+        if((compression_type = map.get_compression_algorithm())) {
+            const char *compression_algorithm = "";
+            
+            switch(compression_type) {
+                case Map::CompressionType::COMPRESSION_TYPE_NONE:
+                    std::terminate();
+                case Map::CompressionType::COMPRESSION_TYPE_DEFLATE:
+                    compression_algorithm = "Deflate";
+                    break;
+            }
+            
+            ADD_LINE(LEVEL_PLAIN, "Compressed", "Yes (%.02f %%) via %s", info.get_compression_ratio() * 100.0, compression_algorithm);
+        }
+        else {
+            ADD_LINE(LEVEL_PLAIN, "Compressed", "%s", "No");
+        }
+        
+        // Uncompressed size
+        auto max_uncompressed_size = game_engine_info.get_maximum_file_size(map_type);
+        bool size_mismatched = map.get_data_length() != map.get_header_decompressed_file_size();
+        
+        if(max_uncompressed_size <= UINT32_MAX) {
+            auto num = BYTES_TO_MiB(map.get_data_length());
+            auto den = BYTES_TO_MiB(max_uncompressed_size);
+            ADD_LINE((num > den || size_mismatched) ? LEVEL_WARN : LEVEL_SUCCESS, "Uncompressed size", "%.02f / %.02f MiB (%.02f %%)%s", num, den, 100.0 * num / den, size_mismatched ? " (mismatched)" : " (matches header)");
+        }
+        else {
+            ADD_LINE(size_mismatched ? LEVEL_WARN : LEVEL_SUCCESS, "Uncompressed size", "%.02f MiB %s", BYTES_TO_MiB(map.get_data_length()), size_mismatched ? "(mismatched)" : "(matches header)");
+        }
+        
+        #undef ADD_LINE
+        
+        return lines;
     }
     
-    void external_bitmaps(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true));
+    #undef BYTES_TO_MiB
+    
+    Value build(MapInfo &info) {
+        return std::string(info.get_map().get_build());
     }
-    void external_sounds(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true));
+    
+    Value compression_ratio(MapInfo &info) {
+        return info.get_compression_ratio();
     }
     
-    void internal_bitmaps(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true, true));
+    Value crc32(MapInfo &info) {
+        char crc[11];
+        std::snprintf(crc, sizeof(crc), "0x%08X", info.get_crc32());
+        return std::string(crc);
     }
-    void internal_sounds(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true, true));
+    Value crc32_mismatched(MapInfo &info) {
+        return info.get_crc32() != info.get_map().get_header_crc32();
     }
-    void internal_bitmaps_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true, true).size());
+    
+    Value engine(MapInfo &info) {
+        return std::string(HEK::GameEngineInfo::get_game_engine_info(info.get_map().get_game_engine()).name);
+    }
+    
+    Value external_bitmap_indices_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, false).size());
     }
-    void internal_sounds_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true, true).size());
+    Value external_bitmaps_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true).size());
     }
     
-    void external_tags(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map,std::nullopt, true, true));
+    Value external_bitmaps(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true));
+    }
+    Value external_sounds(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true));
     }
     
-    void external_loc_indices_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, false).size());
+    Value internal_bitmaps(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true, true));
+    }
+    Value internal_sounds(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true, true));
+    }
+    Value internal_bitmaps_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true, true).size());
+    }
+    Value internal_sounds_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true, true).size());
     }
     
-    void external_sound_indices_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, false).size());
+    Value external_tags(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(std::nullopt, true, true));
     }
     
-    void external_sounds_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true).size());
+    Value external_loc_indices_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, false).size());
     }
     
-    void external_tags_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true).size() + find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, true).size() + find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, true).size());
+    Value external_sound_indices_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, false).size());
     }
-    void external_indices_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, true).size() + find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, false).size() + find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, false).size());
+    
+    Value external_sounds_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true).size());
     }
     
-    void external_loc_indices(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_LOC, true, false));
+    Value external_tags_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true).size() + info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, true).size() + info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, true).size());
     }
-    void external_pointers(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, std::nullopt, false, true));
+    Value external_indices_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, true).size() + info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, false).size() + info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, false).size());
     }
-    void external_bitmap_indices(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, true, false));
+    
+    Value external_loc_indices(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_LOC, true, false));
+    }
+    Value external_bitmap_indices(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, true, false));
     }
-    void external_sound_indices(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, true, false));
+    Value external_sound_indices(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, true, false));
     }
-    void external_indices(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, std::nullopt, true, false));
+    Value external_indices(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(std::nullopt, true, false));
     }
     
-    void external_bitmap_pointers(const Invader::Map &map) {
-        std::printf("A\n");
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, false, true));
+    Value external_bitmap_pointers(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, false, true));
     }
-    void external_bitmap_pointers_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_BITMAP, false, true).size());
+    Value external_bitmap_pointers_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_BITMAP, false, true).size());
     }
-    void external_sound_pointers(const Invader::Map &map) {
-        print_all_indices(map, find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, false, true));
+    Value external_sound_pointers(MapInfo &info) {
+        return all_indices(info.get_map(), info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, false, true));
     }
-    void external_sound_pointers_count(const Invader::Map &map) {
-        oprintf("%zu\n", find_external_tags_indices(map, Map::DataMapType::DATA_MAP_SOUND, false, true).size());
+    Value external_sound_pointers_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_external_tags_indices(Map::DataMapType::DATA_MAP_SOUND, false, true).size());
     }
     
-    void languages(const Invader::Map &map) {
+    Value languages(MapInfo &info) {
         bool all;
-        auto languages = find_languages_for_map(map, all);
+        auto &languages = info.get_languages(all);
         if(all) {
-            oprintf("all\n");
+            return std::vector<std::string> { "all" };
         }
         else if(languages.size() == 0) {
-            oprintf("unknown\n");
+            return std::vector<std::string> { "unknown" };
         }
-        else for(auto &i : languages) {
-            oprintf("%s\n", i.c_str());
+        else {
+            return languages;
         }
     }
     
-    void map_type(const Invader::Map &map) {
-        oprintf("%s\n", type_name(map.get_type()));
+    Value map_type(MapInfo &info) {
+        return std::string(type_name(info.get_map().get_type()));
     }
     
-    void is_compressed(const Invader::Map &map) {
-        oprintf("%i\n", map.get_compression_algorithm());
+    Value is_compressed(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_map().get_compression_algorithm());
     }
-    void is_dirty(const Invader::Map &map) {
-        oprintf("%i\n", !map.is_clean());
+    Value is_dirty(MapInfo &info) {
+        return !info.is_clean();
     }
-    void is_protected(const Invader::Map &map) {
-        oprintf("%i\n", map.is_protected());
+    Value is_protected(MapInfo &info) {
+        return !info.get_protection_issues().empty();
     }
     
-    void protection_issues(const Invader::Map &map) {
-        std::vector<std::string> list;
-        map.is_protected(list);
-        for(auto &i : list) {
-            oprintf("%s\n", i.c_str());
-        }
+    Value protection_issues(MapInfo &info) {
+        return info.get_protection_issues();
     }
     
-    void scenario(const Invader::Map &map) {
-        oprintf("%s\n", map.get_scenario_name());
+    Value scenario(MapInfo &info) {
+        return std::string(info.get_map().get_scenario_name());
     }
     
-    void scenario_path(const Invader::Map &map) {
-        oprintf("%s\n", File::halo_path_to_preferred_path(map.get_tag(map.get_scenario_tag_id()).get_path()).c_str());
+    Value scenario_path(MapInfo &info) {
+        auto &map = info.get_map();
+        return File::halo_path_to_preferred_path(map.get_tag(map.get_scenario_tag_id()).get_path());
     }
     
-    void tags_count(const Invader::Map &map) {
-        oprintf("%zu\n", map.get_tag_count());
+    Value tags_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_map().get_tag_count());
     }
     
-    void stub_count(const Invader::Map &map) {
-        oprintf("%zu\n", calculate_stub_count(map));
+    Value stub_count(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_stub_count());
     }
     
-    void tags(const Invader::Map &map) {
+    Value tags(MapInfo &info) {
+        auto &map = info.get_map();
         auto tag_count = map.get_tag_count();
+        std::vector<std::string> paths;
+        paths.reserve(tag_count);
         for(std::size_t i = 0; i < tag_count; i++) {
-            auto &tag = map.get_tag(i);
-            oprintf("%s.%s\n", File::halo_path_to_preferred_path(tag.get_path()).c_str(), HEK::tag_fourcc_to_extension(tag.get_tag_fourcc()));
+            paths.emplace_back(tag_path_for_index(map, i));
         }
+        return paths;
     }
     
-    void uncompressed_size(const Invader::Map &map) {
-        oprintf("%zu\n", map.get_data_length());
+    Value uncompressed_size(MapInfo &info) {
+        return static_cast<std::uint64_t>(info.get_map().get_data_length());
     }
     
-    void tag_order_match(const Invader::Map &map) {
-        switch(check_tag_order(map)) {
+    Value tag_order_match(MapInfo &info) {
+        switch(info.get_tag_order()) {
             case CHECK_TAG_ORDER_RESULT_UNKNOWN:
-                oprintf("unknown\n");
-                break;
+                return std::string("unknown");
             case CHECK_TAG_ORDER_RESULT_MISMATCHED_TAGS:
-                oprintf("mismatched\n");
-                break;
+                return std::string("mismatched");
             case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_CLIENT:
-                oprintf("client-only\n");
-                break;
+                return std::string("client-only");
             case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED_AS_HOST:
-                oprintf("host-only\n");
-                break;
+                return std::string("host-only");
             case CHECK_TAG_ORDER_RESULT_NETWORK_MATCHED:
-                oprintf("network-matched\n");
-                break;
+                return std::string("network-matched");
             case CHECK_TAG_ORDER_RESULT_MATCHED:
-                oprintf("matched\n");
-                break;
+                return std::string("matched");
         }
+        std::terminate();
     }
     
-    void uses_external_pointers(const Invader::Map &map) {
-        oprintf("%i\n", !find_external_tags_indices(map, std::nullopt, false, true).empty());
+    Value uses_external_pointers(MapInfo &info) {
+        return !info.get_external_tags_indices(std::nullopt, false, true).empty();
     }
 }
@@ -5,10 +5,13 @@
 
 #include <vector>
 #include <optional>
-
-namespace Invader {
-    class Map;
-}
+#include <string>
+#include <variant>
+#include <map>
+#include <tuple>
+#include <filesystem>
+#include <invader/map/map.hpp>
+#include <invader/hek/map.hpp>
 
 namespace Invader::Info {
     /**
@@ -71,47 +74,186 @@ namespace Invader::Info {
      */
     CheckTagOrderResult check_tag_order(const Invader::Map &map);
     
-    void overview(const Invader::Map &);
-    void build(const Invader::Map &);
-    void crc32(const Invader::Map &);
-    void crc32_mismatched(const Invader::Map &);
-    void engine(const Invader::Map &);
-    void external_bitmap_indices(const Invader::Map &);
-    void external_bitmap_indices_count(const Invader::Map &);
-    void external_bitmap_pointers(const Invader::Map &);
-    void external_bitmap_pointers_count(const Invader::Map &);
-    void external_bitmaps(const Invader::Map &);
-    void external_bitmaps_count(const Invader::Map &);
-    void external_indices(const Invader::Map &);
-    void external_indices_count(const Invader::Map &);
-    void external_loc_indices(const Invader::Map &);
-    void external_loc_indices_count(const Invader::Map &);
-    void external_sound_indices(const Invader::Map &);
-    void external_sound_indices_count(const Invader::Map &);
-    void external_sound_pointers(const Invader::Map &);
-    void external_sound_pointers_count(const Invader::Map &);
-    void external_sounds(const Invader::Map &);
-    void external_sounds_count(const Invader::Map &);
-    void external_tags(const Invader::Map &);
-    void external_tags_count(const Invader::Map &);
-    void internal_bitmaps(const Invader::Map &);
-    void internal_bitmaps_count(const Invader::Map &);
-    void internal_sounds(const Invader::Map &);
-    void internal_sounds_count(const Invader::Map &);
-    void is_compressed(const Invader::Map &);
-    void is_dirty(const Invader::Map &);
-    void is_protected(const Invader::Map &);
-    void languages(const Invader::Map &);
-    void map_type(const Invader::Map &);
-    void protection_issues(const Invader::Map &);
-    void scenario(const Invader::Map &);
-    void scenario_path(const Invader::Map &);
-    void stub_count(const Invader::Map &);
-    void tags(const Invader::Map &);
-    void tags_count(const Invader::Map &);
-    void tag_order_match(const Invader::Map &);
-    void uncompressed_size(const Invader::Map &);
-    void uses_external_pointers(const Invader::Map &);
+    /**
+     * Line of the overview, shown in a color depending on its level
+     */
+    struct OverviewLine {
+        enum Level {
+            LEVEL_PLAIN,
+            LEVEL_SUCCESS,
+            LEVEL_LESSER_WARN,
+            LEVEL_WARN,
+            LEVEL_FAIL
+        };
+        
+        /** Level of the line */
+        Level level;
+        
+        /** Name of the line (e.g. "Scenario name") */
+        const char *key;
+        
+        /** Text to display */
+        std::string value;
+    };
+    
+    /**
+     * Calculated value; lists are shown one item per line
+     */
+    using Value = std::variant<bool, std::uint64_t, double, std::string, std::vector<std::string>, std::vector<OverviewLine>>;
+    
+    /**
+     * Loaded map along with any checks done on it so far. Checks shared between values (such as the languages or the
+     * tag order) are only done once no matter how many values are requested. This is not thread-safe, so each thread
+     * should use its own MapInfo.
+     */
+    class MapInfo {
+    public:
+        /**
+         * Load the map at the given path
+         * @param path             path to the map
+         * @param crc_thread_count number of threads to use for calculating the CRC32, or 0 to use one per CPU thread
+         * @throws                 FailedToOpenFileException if the map could not be opened
+         */
+        MapInfo(const std::filesystem::path &path, std::size_t crc_thread_count = 0);
+        
+        /**
+         * Get the map
+         * @return map
+         */
+        const Map &get_map() const noexcept {
+            return this->map;
+        }
+        
+        /**
+         * Get the raw header as read from the file (before any decompression)
+         * @return header
+         */
+        const std::byte *get_header() const noexcept {
+            return this->header;
+        }
+        
+        /**
+         * Get the size of the file on disk
+         * @return file size in bytes
+         */
+        std::size_t get_file_size() const noexcept {
+            return this->file_size;
+        }
+        
+        /**
+         * Get the compression ratio (size of the compressed data divided by the size of the uncompressed data)
+         * @return compression ratio
+         */
+        double get_compression_ratio() const noexcept;
+        
+        /**
+         * Get the CRC32 of the map
+         * @return CRC32
+         */
+        std::uint32_t get_crc32();
+        
+        /**
+         * Get whether the map is clean
+         * @return true if clean
+         */
+        bool is_clean();
+        
+        /**
+         * Get the indices of the external tags with the given parameters; see find_external_tags_indices()
+         * @return indices
+         */
+        const std::vector<std::size_t> &get_external_tags_indices(std::optional<Map::DataMapType> data_type, bool by_index, bool by_resource, bool inverted = false);
+        
+        /**
+         * Get the number of stubbed tags
+         * @return stub count
+         */
+        std::size_t get_stub_count();
+        
+        /**
+         * Get whether the indices are valid for stock Halo Custom Edition
+         * @return true if valid
+         */
+        bool has_valid_indexed_tags_for_stock_custom_edition();
+        
+        /**
+         * Get the languages that match the map
+         * @param all set to true if it matches every language
+         * @return    languages
+         */
+        const std::vector<std::string> &get_languages(bool &all);
+        
+        /**
+         * Get whether the tag order matches
+         * @return result
+         */
+        CheckTagOrderResult get_tag_order();
+        
+        /**
+         * Get the reasons the map is believed to be protected
+         * @return reasons (empty if not protected)
+         */
+        const std::vector<std::string> &get_protection_issues();
+        
+    private:
+        Map map;
+        std::byte header[sizeof(HEK::NativeCacheFileHeader)] = {};
+        std::size_t file_size;
+        std::size_t crc_thread_count;
+        
+        std::optional<std::uint32_t> crc32;
+        std::optional<bool> clean;
+        std::map<std::tuple<std::optional<Map::DataMapType>, bool, bool, bool>, std::vector<std::size_t>> external_tags_indices;
+        std::optional<std::size_t> stub_count;
+        std::optional<bool> valid_indexed_tags;
+        std::optional<std::vector<std::string>> languages;
+        bool all_languages = false;
+        std::optional<CheckTagOrderResult> tag_order;
+        std::optional<std::vector<std::string>> protection_issues;
+    };
+    
+    Value overview(MapInfo &);
+    Value build(MapInfo &);
+    Value compression_ratio(MapInfo &);
+    Value crc32(MapInfo &);
+    Value crc32_mismatched(MapInfo &);
+    Value engine(MapInfo &);
+    Value external_bitmap_indices(MapInfo &);
+    Value external_bitmap_indices_count(MapInfo &);
+    Value external_bitmap_pointers(MapInfo &);
+    Value external_bitmap_pointers_count(MapInfo &);
+    Value external_bitmaps(MapInfo &);
+    Value external_bitmaps_count(MapInfo &);
+    Value external_indices(MapInfo &);
+    Value external_indices_count(MapInfo &);
+    Value external_loc_indices(MapInfo &);
+    Value external_loc_indices_count(MapInfo &);
+    Value external_sound_indices(MapInfo &);
+    Value external_sound_indices_count(MapInfo &);
+    Value external_sound_pointers(MapInfo &);
+    Value external_sound_pointers_count(MapInfo &);
+    Value external_sounds(MapInfo &);
+    Value external_sounds_count(MapInfo &);
+    Value external_tags(MapInfo &);
+    Value external_tags_count(MapInfo &);
+    Value internal_bitmaps(MapInfo &);
+    Value internal_bitmaps_count(MapInfo &);
+    Value internal_sounds(MapInfo &);
+    Value internal_sounds_count(MapInfo &);
+    Value is_compressed(MapInfo &);
+    Value is_dirty(MapInfo &);
+    Value is_protected(MapInfo &);
+    Value languages(MapInfo &);
+    Value map_type(MapInfo &);
+    Value protection_issues(MapInfo &);
+    Value scenario(MapInfo &);
+    Value scenario_path(MapInfo &);
+    Value stub_count(MapInfo &);
+    Value tags(MapInfo &);
+    Value tags_count(MapInfo &);
+    Value tag_order_match(MapInfo &);
+    Value uncompressed_size(MapInfo &);
+    Value uses_external_pointers(MapInfo &);
 }
 
 #endif
@@ -3,11 +3,39 @@
 #ifndef INVADER__INFO__LANGUAGE_HPP
 #define INVADER__INFO__LANGUAGE_HPP
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
 namespace Invader {
-    std::vector<std::string> get_languages_for_resources(const std::size_t *bitmaps_offsets, const std::size_t *bitmaps_sizes, std::size_t bitmap_count, const std::size_t *sounds_offsets, const std::size_t *sounds_sizes, std::size_t sounds_count, bool &all_languages);
+    /**
+     * Get the languages whose stock bitmaps.map has the given data
+     * @param offset offset of the data
+     * @param size   size of the data
+     * @return       bitset of languages (see get_language_names()), or 0 if no language has it
+     */
+    std::uint32_t get_languages_for_bitmap_resource(std::size_t offset, std::size_t size) noexcept;
+
+    /**
+     * Get the languages whose stock sounds.map has the given data
+     * @param offset offset of the data
+     * @param size   size of the data
+     * @return       bitset of languages (see get_language_names()), or 0 if no language has it
+     */
+    std::uint32_t get_languages_for_sound_resource(std::size_t offset, std::size_t size) noexcept;
+
+    /**
+     * Get the bitset of every known language
+     * @return bitset of languages
+     */
+    std::uint32_t get_all_languages() noexcept;
+
+    /**
+     * Get the names of the languages in the bitset
+     * @param languages bitset of languages
+     * @return          names of the languages
+     */
+    std::vector<std::string> get_language_names(std::uint32_t languages);
 }
 
 #endif
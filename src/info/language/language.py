@@ -3,7 +3,7 @@ import json
 import os
 
 if len(sys.argv) < 3:
-    printf("Usage: {} <output.cpp> <a.json> [b.json] [...]")
+    print("Usage: {} <output.cpp> <a.json> [b.json] [...]".format(sys.argv[0]))
     sys.exit(1)
 
 READER_VERSION = 1
@@ -14,67 +14,131 @@ for i in sys.argv[2:]:
     with open(i) as f:
         d = json.load(f)
         if d["version"] != READER_VERSION:
-            printf("Version ({}) does not match reader ({})".format(d["version"], READER_VERSION))
+            print("Version ({}) does not match reader ({})".format(d["version"], READER_VERSION))
             sys.exit(1)
         languages[os.path.basename(i).split(".")[0]] = d
 
+if len(languages) > 32:
+    print("Too many languages ({} > 32)".format(len(languages)))
+    sys.exit(1)
+
+MASK64 = 0xFFFFFFFFFFFFFFFF
+
+# Must match language_resource_hash() in the generated code
+def resource_hash(offset, size, seed):
+    x = ((offset << 32) | size) ^ ((seed * 0x9E3779B97F4A7C15) & MASK64)
+    x ^= x >> 33
+    x = (x * 0xFF51AFD7ED558CCD) & MASK64
+    x ^= x >> 33
+    x = (x * 0xC4CEB3FE1A85EC53) & MASK64
+    x ^= x >> 33
+    return x
+
+def next_power_of_two(n):
+    p = 1
+    while p < n:
+        p *= 2
+    return p
+
+# Combine every language's resources into one set of (offset, size) -> bitset of languages that have it
+def combine_resources(what):
+    resources = {}
+    for q, language in enumerate(languages):
+        for k in languages[language][what]:
+            key = (k["offset"], k["size"])
+            if k["offset"] > 0xFFFFFFFF or k["size"] > 0xFFFFFFFF:
+                print("Resource ({}, {}) in {} is out of range".format(k["offset"], k["size"], language))
+                sys.exit(1)
+            resources[key] = resources.get(key, 0) | (1 << q)
+    return resources
+
+# Make a perfect hash table (hash and displace): each resource is put in a bucket, and each bucket gets a seed
+# that places all of its resources in unused slots, so a lookup is always one bucket and one slot
+def make_table(resources):
+    keys = list(resources)
+    slot_count = next_power_of_two(max(len(keys) * 5 // 4, 1))
+    bucket_count = next_power_of_two(max(len(keys) // 4, 1))
+
+    buckets = [[] for _ in range(bucket_count)]
+    for k in keys:
+        buckets[resource_hash(k[0], k[1], 0) & (bucket_count - 1)].append(k)
+
+    seeds = [0] * bucket_count
+    slots = [None] * slot_count
+    for b in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+        if len(buckets[b]) == 0:
+            continue
+        seed = 1
+        while True:
+            placed = [resource_hash(k[0], k[1], seed) & (slot_count - 1) for k in buckets[b]]
+            if len(set(placed)) == len(placed) and all(slots[s] is None for s in placed):
+                break
+            seed += 1
+            if seed > 0xFFFF:
+                print("Failed to make a perfect hash table")
+                sys.exit(1)
+        seeds[b] = seed
+        for k, s in zip(buckets[b], placed):
+            slots[s] = k
+
+    return seeds, [(k[0], k[1], resources[k]) if k is not None else (0, 0, 0) for k in slots]
+
 with open(sys.argv[1], "w") as f:
     f.write("// This value was auto-generated. Changes made to this file may get overwritten.\n")
+    f.write("#include <cstdint>\n")
     f.write("#include <string>\n")
     f.write("#include <vector>\n")
     f.write("namespace Invader {\n")
+    f.write("    struct LanguageResource {\n")
+    f.write("        std::uint32_t offset;\n")
+    f.write("        std::uint32_t size;\n")
+    f.write("        std::uint32_t languages;\n")
+    f.write("    };\n\n")
+    f.write("    static constexpr std::uint64_t language_resource_hash(std::uint64_t offset, std::uint64_t size, std::uint64_t seed) noexcept {\n")
+    f.write("        std::uint64_t x = ((offset << 32) | size) ^ (seed * 0x9E3779B97F4A7C15);\n")
+    f.write("        x ^= x >> 33;\n")
+    f.write("        x *= 0xFF51AFD7ED558CCD;\n")
+    f.write("        x ^= x >> 33;\n")
+    f.write("        x *= 0xC4CEB3FE1A85EC53;\n")
+    f.write("        x ^= x >> 33;\n")
+    f.write("        return x;\n")
+    f.write("    }\n\n")
+    f.write("    template<std::size_t seed_count, std::size_t resource_count>\n")
+    f.write("    static std::uint32_t find_languages_for_resource(const std::uint16_t (&seeds)[seed_count], const LanguageResource (&resources)[resource_count], std::size_t offset, std::size_t size) noexcept {\n")
+    f.write("        auto seed = seeds[language_resource_hash(offset, size, 0) & (seed_count - 1)];\n")
+    f.write("        auto &resource = resources[language_resource_hash(offset, size, seed) & (resource_count - 1)];\n")
+    f.write("        return (resource.offset == offset && resource.size == size) ? resource.languages : 0;\n")
+    f.write("    }\n\n")
+    f.write("    static const char *language_names[] = {\n")
     for q in languages:
-        def write_offsets(what):
-            for k in what:
-                f.write("        {{0x{:08X},0x{:08X}}},\n".format(k["offset"], k["size"]))
-        f.write("    static std::size_t {}_bitmaps[][2] = {{\n".format(q))
-        write_offsets(languages[q]["bitmaps"])
-        f.write("    };\n")
-        f.write("    static std::size_t {}_sounds[][2] = {{\n".format(q))
-        write_offsets(languages[q]["sounds"])
+        f.write("        \"{}\",\n".format(q))
+    f.write("    };\n\n")
+    for what in ["bitmaps", "sounds"]:
+        seeds, slots = make_table(combine_resources(what))
+        f.write("    static const std::uint16_t {}_seeds[] = {{\n".format(what))
+        for s in range(0, len(seeds), 16):
+            f.write("        {},\n".format(",".join(str(k) for k in seeds[s:s+16])))
         f.write("    };\n")
-    f.write("    std::vector<std::string> get_languages_for_resources(const std::size_t *bitmaps_offsets, const std::size_t *bitmaps_sizes, std::size_t bitmap_count, const std::size_t *sounds_offsets, const std::size_t *sounds_sizes, std::size_t sounds_count, bool &all_languages) {\n")
-    f.write("        std::vector<std::string> languages;\n")
-    f.write("        all_languages = true;\n")
-    for q in languages:
-        f.write("        languages.emplace_back(\"{}\");\n".format(q))
-    f.write("        auto remove_language = [&languages, &all_languages](const char *language) {\n")
-    f.write("            for(auto &l : languages) {\n")
-    f.write("                if(l == language) {\n")
-    f.write("                    languages.erase(languages.begin() + (&l - languages.data()));\n")
-    f.write("                    all_languages = false;\n")
-    f.write("                    return;\n")
-    f.write("                }\n")
+        f.write("    static const LanguageResource {}_resources[] = {{\n".format(what))
+        for k in slots:
+            f.write("        {{0x{:08X},0x{:08X},0x{:08X}}},\n".format(k[0], k[1], k[2]))
+        f.write("    };\n\n")
+    f.write("    std::uint32_t get_languages_for_bitmap_resource(std::size_t offset, std::size_t size) noexcept {\n")
+    f.write("        return find_languages_for_resource(bitmaps_seeds, bitmaps_resources, offset, size);\n")
+    f.write("    }\n\n")
+    f.write("    std::uint32_t get_languages_for_sound_resource(std::size_t offset, std::size_t size) noexcept {\n")
+    f.write("        return find_languages_for_resource(sounds_seeds, sounds_resources, offset, size);\n")
+    f.write("    }\n\n")
+    f.write("    std::uint32_t get_all_languages() noexcept {\n")
+    f.write("        return 0x{:08X};\n".format((1 << len(languages)) - 1))
+    f.write("    }\n\n")
+    f.write("    std::vector<std::string> get_language_names(std::uint32_t languages) {\n")
+    f.write("        std::vector<std::string> names;\n")
+    f.write("        for(std::size_t i = 0; i < sizeof(language_names) / sizeof(*language_names); i++) {\n")
+    f.write("            if(languages & (static_cast<std::uint32_t>(1) << i)) {\n")
+    f.write("                names.emplace_back(language_names[i]);\n")
     f.write("            }\n")
-    f.write("        };\n\n")
-    f.write("        for(std::size_t b = 0; b < bitmap_count; b++) {\n")
-    f.write("            bool found = false;\n")
-    for q in languages:
-        f.write("            for(auto &l : {}_bitmaps) {{\n".format(q))
-        f.write("                if(l[0] == bitmaps_offsets[b]) {\n")
-        f.write("                    found = l[1] == bitmaps_sizes[b];\n")
-        f.write("                    break;\n")
-        f.write("                }\n")
-        f.write("            }\n")
-        f.write("            if(!found) {\n")
-        f.write("                remove_language(\"{}\");\n".format(q))
-        f.write("            }\n")
-        f.write("            found = false;\n")
-    f.write("        }\n\n")
-    f.write("        for(std::size_t s = 0; s < sounds_count; s++) {\n")
-    f.write("            bool found = false;\n")
-    for q in languages:
-        f.write("            for(auto &l : {}_sounds) {{\n".format(q))
-        f.write("                if(l[0] == sounds_offsets[s]) {\n")
-        f.write("                    found = l[1] == sounds_sizes[s];\n")
-        f.write("                    break;\n")
-        f.write("                }\n")
-        f.write("            }\n")
-        f.write("            if(!found) {\n")
-        f.write("                remove_language(\"{}\");\n".format(q))
-        f.write("            }\n")
-        f.write("            found = false;\n")
     f.write("        }\n")
-    f.write("        return languages;\n".format(i))
+    f.write("        return names;\n")
     f.write("    }\n")
     f.write("}\n")
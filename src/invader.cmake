@@ -16,6 +16,8 @@ set(INVADER_PARSER_FILES
     "${CMAKE_CURRENT_BINARY_DIR}/parser-normalize.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-read-hek-file.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-padding.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-dependencies.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-view.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/bitfield.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/enum.cpp"
 )
@@ -42,6 +44,8 @@ set(INVADER_SOURCE_FILES
     "${CMAKE_CURRENT_BINARY_DIR}/parser-normalize.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-read-hek-file.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-padding.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-scan-dependencies.cpp"
+    "${CMAKE_CURRENT_BINARY_DIR}/parser-view.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/bitfield.cpp"
     "${CMAKE_CURRENT_BINARY_DIR}/enum.cpp"
 
@@ -60,14 +64,21 @@ set(INVADER_SOURCE_FILES
     src/error.cpp
     src/hek/fourcc.cpp
     src/hek/data_type.cpp
+    src/hek/endian.cpp
     src/hek/map.cpp
     src/resource/resource_map.cpp
     src/dependency/found_tag_dependency.cpp
     src/map/map.cpp
     src/map/tag.cpp
     src/file/file.cpp
+    src/file/tag_path_index.cpp
     src/build/build_workload.cpp
+    src/build/build_workload_batch.cpp
+    src/build/build_workload_cache.cpp
     src/build/build_workload_dedupe.cpp
+    src/build/build_workload_output.cpp
+    src/build/build_workload_preload.cpp
+    src/build/build_workload_profile.cpp
     src/bitmap/bcdec/bcdec.c
     src/bitmap/swizzle.cpp
     src/bitmap/bitmap_encode.cpp
@@ -120,6 +131,7 @@ set(INVADER_SOURCE_FILES
     src/tag/parser/compile/ui_widget_definition.cpp
 
     src/crc/crc32.c
+    src/crc/crc32_fast.cpp
     src/crc/crc_spoof.c
     src/crc/hek/crc.cpp
 
@@ -232,7 +244,7 @@ file(GLOB INVADER_LOCALIZED_RESOURCE_DATA_OFFSETS "${CMAKE_CURRENT_SOURCE_DIR}/s
 add_custom_command(
     OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/language.cpp"
     COMMAND "${Python3_EXECUTABLE}" "${CMAKE_CURRENT_SOURCE_DIR}/src/info/language/language.py" "${CMAKE_CURRENT_BINARY_DIR}/language.cpp" ${INVADER_LOCALIZED_RESOURCE_DATA_OFFSETS}
-    DEPENDS "${CMAKE_CURRENT_SOURCE_DIR}/src/info/language/language.py"
+    DEPENDS "${CMAKE_CURRENT_SOURCE_DIR}/src/info/language/language.py" ${INVADER_LOCALIZED_RESOURCE_DATA_OFFSETS}
 )
 
 # Build the resource list
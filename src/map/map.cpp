@@ -10,6 +10,7 @@
 #include <invader/map/map.hpp>
 #include <invader/file/file.hpp>
 #include <invader/crc/hek/crc.hpp>
+#include <cstring>
 
 namespace Invader {
     Map Map::map_with_copy(const std::byte *data, std::size_t data_size,
@@ -49,6 +50,131 @@ namespace Invader {
         return map;
     }
 
+    Map Map::map_with_path(const std::filesystem::path &path,
+                           std::vector<std::byte> &&bitmaps_data,
+                           std::vector<std::byte> &&loc_data,
+                           std::vector<std::byte> &&sounds_data) {
+        Map map;
+        map.read_map_file(path, false);
+        try {
+            map.bitmap_data = std::move(bitmaps_data);
+            map.sound_data = std::move(sounds_data);
+            map.loc_data = std::move(loc_data);
+            map.load_map();
+        }
+        catch(Exception &) {
+            throw InvalidMapException();
+        }
+        return map;
+    }
+
+    Map Map::map_with_path(const std::filesystem::path &path,
+                           std::shared_ptr<const ResourceMapView> bitmaps_data,
+                           std::shared_ptr<const ResourceMapView> loc_data,
+                           std::shared_ptr<const ResourceMapView> sounds_data) {
+        Map map;
+        map.read_map_file(path, false);
+        try {
+            map.bitmap_view = std::move(bitmaps_data);
+            map.sound_view = std::move(sounds_data);
+            map.loc_view = std::move(loc_data);
+            map.load_map();
+        }
+        catch(Exception &) {
+            throw InvalidMapException();
+        }
+        return map;
+    }
+
+    Map Map::map_with_mapping(const std::filesystem::path &path,
+                              const std::optional<std::filesystem::path> &bitmaps_path,
+                              const std::optional<std::filesystem::path> &loc_path,
+                              const std::optional<std::filesystem::path> &sounds_path) {
+        // Resource maps we can't read are left out, the same as if they were empty
+        auto view_if_possible = [](const std::optional<std::filesystem::path> &path) -> std::shared_ptr<const ResourceMapView> {
+            if(!path.has_value() || !std::filesystem::is_regular_file(*path)) {
+                return nullptr;
+            }
+            try {
+                return std::make_shared<const ResourceMapView>(ResourceMapView::view_file(*path));
+            }
+            catch(std::exception &) {
+                return nullptr;
+            }
+        };
+
+        Map map;
+        map.read_map_file(path, true);
+        try {
+            map.bitmap_view = view_if_possible(bitmaps_path);
+            map.sound_view = view_if_possible(sounds_path);
+            map.loc_view = view_if_possible(loc_path);
+            map.load_map();
+        }
+        catch(Exception &) {
+            throw InvalidMapException();
+        }
+        return map;
+    }
+
+    void Map::read_map_file(const std::filesystem::path &path, bool map_file) {
+        using namespace Invader::HEK;
+
+        // Check if it's compressed first
+        auto path_string = path.string();
+        CacheFileHeader header;
+        std::FILE *f = std::fopen(path_string.c_str(), "rb");
+        if(!f) {
+            eprintf_error("Failed to open %s for reading", path_string.c_str());
+            throw FailedToOpenFileException();
+        }
+        bool header_read = std::fread(&header, sizeof(header), 1, f) == 1;
+        std::fclose(f);
+        if(!header_read) {
+            throw InvalidMapException();
+        }
+
+        if(!header.valid() || header.engine != CacheFileEngine::CACHE_FILE_XBOX) {
+            // Use the file as-is if we can map it; otherwise, read it
+            if(map_file) {
+                this->mapped_data = File::MemoryMappedFile::open(path);
+                if(this->mapped_data.has_value()) {
+                    this->mapped_data_size = this->mapped_data->size();
+                    return;
+                }
+            }
+
+            auto file = File::open_file(path);
+            if(!file.has_value()) {
+                throw FailedToOpenFileException();
+            }
+            this->data = std::move(*file);
+            return;
+        }
+
+        std::size_t decompressed_file_size = header.decompressed_file_size;
+        if(decompressed_file_size < sizeof(header)) {
+            throw InvalidMapException();
+        }
+
+        try {
+            // If we can't make a scratch file, decompress into memory instead
+            auto scratch = File::MemoryMappedFile::scratch(decompressed_file_size);
+            if(scratch.has_value()) {
+                this->mapped_data_size = Compression::decompress_map_file(path_string.c_str(), scratch->data(), scratch->size());
+                this->mapped_data = std::move(scratch);
+            }
+            else {
+                this->data.resize(decompressed_file_size);
+                this->data.resize(Compression::decompress_map_file(path_string.c_str(), this->data.data(), this->data.size()));
+            }
+            this->compressed = CompressionType::COMPRESSION_TYPE_DEFLATE;
+        }
+        catch(Exception &) {
+            throw InvalidMapException();
+        }
+    }
+
     bool Map::decompress_if_needed(const std::byte *data, std::size_t data_size) {
         using namespace Invader::HEK;
         
@@ -119,13 +245,13 @@ namespace Invader {
         
         switch(map_type) {
             case DATA_MAP_CACHE:
-                return this->data.data();
+                return this->mapped_data.has_value() ? this->mapped_data->data() : this->data.data();
             case DATA_MAP_BITMAP:
-                return this->bitmap_data.data();
+                return this->bitmap_view ? const_cast<std::byte *>(this->bitmap_view->get_data()) : this->bitmap_data.data();
             case DATA_MAP_SOUND:
-                return this->sound_data.data();
+                return this->sound_view ? const_cast<std::byte *>(this->sound_view->get_data()) : this->sound_data.data();
             case DATA_MAP_LOC:
-                return this->loc_data.data();
+                return this->loc_view ? const_cast<std::byte *>(this->loc_view->get_data()) : this->loc_data.data();
             default:
                 std::terminate();
         }
@@ -140,13 +266,13 @@ namespace Invader {
         
         switch(map_type) {
             case DATA_MAP_CACHE:
-                return this->data.size();
+                return this->mapped_data.has_value() ? this->mapped_data_size : this->data.size();
             case DATA_MAP_BITMAP:
-                return this->bitmap_data.size();
+                return this->bitmap_view ? this->bitmap_view->get_data_length() : this->bitmap_data.size();
             case DATA_MAP_SOUND:
-                return this->sound_data.size();
+                return this->sound_view ? this->sound_view->get_data_length() : this->sound_data.size();
             case DATA_MAP_LOC:
-                return this->loc_data.size();
+                return this->loc_view ? this->loc_view->get_data_length() : this->loc_data.size();
         }
         std::terminate();
     }
@@ -270,8 +396,8 @@ namespace Invader {
         this->populate_tag_array();
     }
     
-    std::uint32_t Map::get_crc32() const noexcept {
-        return calculate_map_crc(*const_cast<Map *>(this));
+    std::uint32_t Map::get_crc32(std::size_t thread_count) const noexcept {
+        return calculate_map_crc(*const_cast<Map *>(this), nullptr, nullptr, nullptr, thread_count);
     }
 
     void Map::populate_tag_array() {
@@ -306,6 +432,10 @@ namespace Invader {
             set_model_stuff(*reinterpret_cast<const CacheFileTagDataHeaderPC *>(this->get_tag_data_at_offset(0, sizeof(CacheFileTagDataHeaderPC))));
         }
 
+        // Paths and data locations are loaded when they're first needed, since most tools only look at a few tags
+        this->tag_path_loaded = std::make_unique<std::once_flag[]>(tag_count);
+        this->tag_data_loaded = std::make_unique<std::once_flag[]>(tag_count);
+
         auto do_populate_the_array = [&map, &tag_count](auto *tags) {
             // Have a pointer for the end of the tag data so we can check to make sure things aren't null terminated
             const char *tag_data_end = reinterpret_cast<const char *>(map.tag_data) + map.tag_data_length;
@@ -322,175 +452,15 @@ namespace Invader {
                     map.type = reinterpret_cast<Scenario<LittleEndian> *>(map.resolve_tag_data_pointer(tags[i].tag_data, sizeof(Scenario<LittleEndian>)))->type;
                 }
 
+                // Find the path, leaving it empty if it isn't null-terminated
                 try {
                     const auto *path = reinterpret_cast<const char *>(map.resolve_tag_data_pointer(tags[i].tag_path));
-
-                    // Make sure the path is null-terminated and it doesn't contain whitespace that isn't an ASCII space (0x20) or forward slash characters
-                    bool null_terminated = false;
-                    for(auto *path_test = path; path < tag_data_end; path_test++) {
-                        if(*path_test == 0) {
-                            null_terminated = true;
-                            
-                            // Did we even start?
-                            if(path_test == path) {
-                                throw InvalidTagPathException();
-                            }
-                            
-                            break;
-                        }
-                        else if(*path_test == '/') {
-                            throw InvalidTagPathException();
-                        }
-                        else {
-                            // Control characters?
-                            auto latin1 = static_cast<std::uint8_t>(*path_test);
-                            if(latin1 < 0x20 || (latin1 > 0x7E && latin1 < 0xA0)) {
-                                throw InvalidTagPathException();
-                            }
-                        }
-                    }
-
-                    // If it was null terminated and it does NOT start with a dot, use it. Otherwise, don't.
-                    if(null_terminated && *path != '.') {
-                        tag.path = Invader::File::remove_duplicate_slashes(path);
-                    }
-                    else {
-                        throw InvalidTagPathException();
-                    }
-                    
-                    // Lowercase everything
-                    for(char &c : tag.path) {
-                        c = std::tolower(c);
-                    }
-                }
-                catch (std::exception &) {
-                    char new_path[64];
-                    std::snprintf(new_path, sizeof(new_path), "corrupted\\tag_%zu", i);
-                    map.invalid_paths_detected = true;
-                    tag.path = new_path;
-                }
-
-                if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP && map.cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
-                    continue;
-                }
-                else if(sizeof(tags->tag_data) == sizeof(HEK::Pointer) && reinterpret_cast<const CacheFileTagDataTag *>(tags)[i].indexed) {
-                    tag.indexed = true;
-
-                    // Indexed sound tags still use tag data (until you use reflexives)
-                    if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SOUND) {
-                        tag.base_struct_pointer = tags[i].tag_data;
-                    }
-                    else {
-                        tag.base_struct_pointer = 0;
-                        tag.resource_index = tags[i].tag_data;
-                    }
-
-                    // Find where it's located
-                    DataMapType type;
-                    bool unavailable = false;
-                    switch(tag.tag_fourcc) {
-                        case TagFourCC::TAG_FOURCC_BITMAP:
-                            type = DataMapType::DATA_MAP_BITMAP;
-                            unavailable = map.bitmap_data.size() == 0;
-                            break;
-                        case TagFourCC::TAG_FOURCC_SOUND:
-                            type = DataMapType::DATA_MAP_SOUND;
-                            unavailable = map.sound_data.size() == 0;
-                            break;
-                        default:
-                            type = DataMapType::DATA_MAP_LOC;
-                            unavailable = map.loc_data.size() == 0;
-                            break;
-                    }
-                    
-                    // If we don't have the corresponding map, continue
-                    if(unavailable) {
-                        continue;
-                    }
-
-                    // Let's begin.
-                    auto &header = *reinterpret_cast<ResourceMapHeader *>(map.get_data_at_offset(0, sizeof(ResourceMapHeader), type));
-                    auto count = header.resource_count.read();
-                    auto *indices = reinterpret_cast<ResourceMapResource *>(map.get_data_at_offset(header.resources, count * sizeof(ResourceMapResource), type));
-
-                    // Find that index if we're a sounds.map file
-                    if(!tag.resource_index.has_value()) {
-                        auto *paths = reinterpret_cast<const char *>(map.get_data_at_offset(header.paths, 0, type));
-                        for(std::uint32_t i = 1; i < count; i+=2) {
-                            auto *path = paths + indices[i].path_offset;
-                            if(tag.path == path) {
-                                tag.resource_index = i;
-                                break;
-                            }
-                        }
-                    }
-                    
-                    // Do we even have an index?
-                    if(!tag.resource_index.has_value()) {
-                        eprintf_error("Tag %s.%s could not be found in the resource map file", File::halo_path_to_preferred_path(tag.path).c_str(), HEK::tag_fourcc_to_extension(tag.tag_fourcc));
-                        throw OutOfBoundsException();
-                    }
-
-                    // Make sure it's valid
-                    if(*tag.resource_index >= count) {
-                        eprintf_error("Tag %s.%s is out-of-bounds for the resource map(s) provided (%zu >= %zu)", File::halo_path_to_preferred_path(tag.path).c_str(), HEK::tag_fourcc_to_extension(tag.tag_fourcc), *tag.resource_index, static_cast<std::size_t>(count));
-                        throw OutOfBoundsException();
-                    }
-
-                    // Set it all
-                    auto &index = indices[*tag.resource_index];
-                    tag.tag_data_size = index.size;
-                    if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SOUND) {
-                        tag.base_struct_offset = index.data_offset + sizeof(HEK::Sound<HEK::LittleEndian>);
-                    }
-                    else {
-                        tag.base_struct_offset = index.data_offset;
-                    }
-                }
-                else {
-                    tag.base_struct_pointer = tags[i].tag_data;
-                    
-                    // Check if there are external pointers
-                    switch(tag.tag_fourcc) {
-                        case TagFourCC::TAG_FOURCC_BITMAP: {
-                            auto &base_struct = tag.get_base_struct<HEK::Bitmap>();
-                            std::size_t bitmap_data_count = base_struct.bitmap_data.count;
-                            if(bitmap_data_count) {
-                                auto *bitmaps = tag.resolve_reflexive(base_struct.bitmap_data);
-                                for(std::size_t b = 0; b < bitmap_data_count; b++) {
-                                    if(bitmaps[b].flags & BitmapDataFlagsFlag::BITMAP_DATA_FLAGS_FLAG_EXTERNAL) {
-                                        tag.external_pointers = true;
-                                        break;
-                                    }
-                                }
-                            }
-                            break;
-                        }
-                        case TagFourCC::TAG_FOURCC_SOUND: {
-                            auto &base_struct = tag.get_base_struct<HEK::Sound>();
-                            std::size_t pitch_range_count = base_struct.pitch_ranges.count;
-                            if(pitch_range_count) {
-                                auto *pitch_ranges = tag.resolve_reflexive(base_struct.pitch_ranges);
-                                for(std::size_t pr = 0; pr < pitch_range_count && !tag.external_pointers; pr++) {
-                                    auto &pitch_range = pitch_ranges[pr];
-                                    std::size_t permutation_count = pitch_range.permutations.count;
-                                    if(permutation_count) {
-                                        auto *permutations = tag.resolve_reflexive(pitch_range.permutations);
-                                        for(std::size_t p = 0; p < permutation_count; p++) {
-                                            if(permutations[p].samples.external & 1) {
-                                                tag.external_pointers = true;
-                                                break; // breaks out of outer loop too due to the check
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                            break;
-                        }
-                        default:
-                            break;
+                    const auto *path_end = reinterpret_cast<const char *>(std::memchr(path, 0, tag_data_end - path));
+                    if(path_end) {
+                        tag.raw_path = std::string_view(path, path_end - path);
                     }
                 }
+                catch (std::exception &) {}
             }
         };
 
@@ -511,6 +481,20 @@ namespace Invader {
                 eprintf_error("Failed to populate the tag array");
                 throw;
             }
+            // Indexed tags are found in their resource maps now rather than on first use, so a missing or out-of-bounds
+            // resource index still fails loading the map
+            try {
+                for(auto &tag : this->tags) {
+                    if(reinterpret_cast<const CacheFileTagDataTag *>(this->tag_data + tag.tag_data_index_offset)->indexed) {
+                        std::call_once(this->tag_data_loaded[tag.tag_index], [this, &tag]() { this->load_tag_data(tag); });
+                    }
+                }
+            }
+            catch(std::exception &) {
+                eprintf_error("Failed to populate the tag array");
+                throw;
+            }
+
             try {
                 this->get_bsps();
             }
@@ -521,6 +505,173 @@ namespace Invader {
         }
     }
 
+    // Paths that are valid and already lowercase without duplicate slashes can be used as-is
+    static bool tag_path_is_valid(std::string_view path, bool &normalized) noexcept {
+        normalized = true;
+        if(path.empty() || path[0] == '.') {
+            return false;
+        }
+
+        auto is_separator = [](char c) { return c == '\\' || c == INVADER_PREFERRED_PATH_SEPARATOR; };
+        for(std::size_t c = 0; c < path.size(); c++) {
+            // No forward slashes or control characters
+            auto latin1 = static_cast<std::uint8_t>(path[c]);
+            if(path[c] == '/' || latin1 < 0x20 || (latin1 > 0x7E && latin1 < 0xA0)) {
+                return false;
+            }
+            if((path[c] >= 'A' && path[c] <= 'Z') || (c > 0 && is_separator(path[c - 1]) && is_separator(path[c]))) {
+                normalized = false;
+            }
+        }
+
+        return true;
+    }
+
+    void Map::load_tag_path(Tag &tag) noexcept {
+        bool normalized;
+        if(tag_path_is_valid(tag.raw_path, normalized)) {
+            tag.path = normalized ? std::string(tag.raw_path) : Invader::File::remove_duplicate_slashes(std::string(tag.raw_path));
+
+            // Lowercase everything
+            for(char &c : tag.path) {
+                c = std::tolower(c);
+            }
+        }
+        else {
+            char new_path[64];
+            std::snprintf(new_path, sizeof(new_path), "corrupted\\tag_%zu", tag.tag_index);
+            this->invalid_paths_detected = true;
+            tag.path = new_path;
+        }
+    }
+
+    void Map::load_tag_data(Tag &tag) {
+        using namespace Invader::HEK;
+
+        // BSPs are found through the scenario tag when the map is loaded
+        if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SCENARIO_STRUCTURE_BSP && this->cache_version != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
+            return;
+        }
+
+        if(this->cache_version == HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
+            tag.base_struct_pointer = reinterpret_cast<const NativeCacheFileTagDataTag *>(this->tag_data + tag.tag_data_index_offset)->tag_data;
+            return;
+        }
+
+        const auto &tag_array_tag = *reinterpret_cast<const CacheFileTagDataTag *>(this->tag_data + tag.tag_data_index_offset);
+        if(!tag_array_tag.indexed) {
+            tag.base_struct_pointer = tag_array_tag.tag_data;
+            return;
+        }
+
+        tag.indexed = true;
+
+        // Indexed sound tags still use tag data (until you use reflexives)
+        if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SOUND) {
+            tag.base_struct_pointer = tag_array_tag.tag_data;
+        }
+        else {
+            tag.base_struct_pointer = 0;
+            tag.resource_index = tag_array_tag.tag_data;
+        }
+
+        // Find where it's located
+        DataMapType type;
+        const ResourceMapView *view;
+        bool unavailable;
+        switch(tag.tag_fourcc) {
+            case TagFourCC::TAG_FOURCC_BITMAP:
+                type = DataMapType::DATA_MAP_BITMAP;
+                view = this->bitmap_view.get();
+                unavailable = this->bitmap_data.size() == 0 && !view;
+                break;
+            case TagFourCC::TAG_FOURCC_SOUND:
+                type = DataMapType::DATA_MAP_SOUND;
+                view = this->sound_view.get();
+                unavailable = this->sound_data.size() == 0 && !view;
+                break;
+            default:
+                type = DataMapType::DATA_MAP_LOC;
+                view = this->loc_view.get();
+                unavailable = this->loc_data.size() == 0 && !view;
+                break;
+        }
+        
+        // If we don't have the corresponding map, the data isn't available
+        if(unavailable) {
+            return;
+        }
+
+        const auto &path = tag.get_path();
+
+        try {
+            auto &header = *reinterpret_cast<ResourceMapHeader *>(this->get_data_at_offset(0, sizeof(ResourceMapHeader), type));
+            auto count = header.resource_count.read();
+            auto *indices = reinterpret_cast<ResourceMapResource *>(this->get_data_at_offset(header.resources, count * sizeof(ResourceMapResource), type));
+
+            // Find that index if we're a sounds.map file
+            if(!tag.resource_index.has_value()) {
+                if(view) {
+                    tag.resource_index = view->find(path, true);
+                }
+                else {
+                    auto *paths = reinterpret_cast<const char *>(this->get_data_at_offset(header.paths, 0, type));
+                    for(std::uint32_t i = 1; i < count; i+=2) {
+                        if(path == paths + indices[i].path_offset) {
+                            tag.resource_index = i;
+                            break;
+                        }
+                    }
+                }
+            }
+            
+            // Do we even have an index?
+            if(!tag.resource_index.has_value()) {
+                eprintf_error("Tag %s.%s could not be found in the resource map file", File::halo_path_to_preferred_path(path).c_str(), HEK::tag_fourcc_to_extension(tag.tag_fourcc));
+                throw OutOfBoundsException();
+            }
+
+            // Make sure it's valid
+            if(*tag.resource_index >= count) {
+                eprintf_error("Tag %s.%s is out-of-bounds for the resource map(s) provided (%zu >= %zu)", File::halo_path_to_preferred_path(path).c_str(), HEK::tag_fourcc_to_extension(tag.tag_fourcc), *tag.resource_index, static_cast<std::size_t>(count));
+                throw OutOfBoundsException();
+            }
+
+            // Set it all
+            auto &index = indices[*tag.resource_index];
+            tag.tag_data_size = index.size;
+            if(tag.tag_fourcc == TagFourCC::TAG_FOURCC_SOUND) {
+                tag.base_struct_offset = index.data_offset + sizeof(HEK::Sound<HEK::LittleEndian>);
+            }
+            else {
+                tag.base_struct_offset = index.data_offset;
+            }
+            tag.resource_available = true;
+        }
+        catch(OutOfBoundsException &) {
+            throw;
+        }
+        catch(std::exception &) {
+            eprintf_error("Tag %s.%s could not be read from the resource map file", File::halo_path_to_preferred_path(path).c_str(), HEK::tag_fourcc_to_extension(tag.tag_fourcc));
+            throw;
+        }
+    }
+
+    void Map::build_tag_path_index() {
+        this->tag_path_index.clear();
+        this->tag_path_index.reserve(this->tags.size());
+        for(auto &tag : this->tags) {
+            // Skip loading the path if the one in the cache file is already what it would be
+            bool normalized;
+            if(tag_path_is_valid(tag.raw_path, normalized) && normalized) {
+                this->tag_path_index.insert(tag.raw_path, tag.tag_fourcc, tag.tag_index);
+            }
+            else {
+                this->tag_path_index.insert(tag.get_path(), tag.tag_fourcc, tag.tag_index);
+            }
+        }
+    }
+
     void Map::get_bsps() {
         using namespace Invader::HEK;
 
@@ -558,7 +709,10 @@ namespace Invader {
         
         reasons.clear();
         
-        // Invalid paths?
+        // Invalid paths? We have to check all of them first.
+        for(auto &tag : this->tags) {
+            tag.get_path();
+        }
         if(this->invalid_paths_detected) {
             reasons.emplace_back("invalid paths detected");
         }
@@ -597,35 +751,30 @@ namespace Invader {
                 ADD_PROT_REASON("tag #%zu has an empty path", t);
             }
 
-            // Go through each tag and see if we have any duplicates
-            for(std::size_t t2 = 0; t2 < t; t2++) {
-                auto &tag2 = this->get_tag(t2);
-                if(tag_class != tag2.get_tag_fourcc()) {
-                    continue;
-                }
-                if(tag2.get_path() == tag_path) {
-                    ADD_PROT_REASON("tag \"%s\" (tag #%zu) shares a path and fourCC with tag #%zu", tag_merged.c_str(), t, t2);
-                    break;
-                }
+            // See if an earlier tag has the same path and fourCC, since the index keeps the first one
+            auto t2 = this->find_tag(tag_path.c_str(), tag_class);
+            if(t2.has_value() && *t2 < t) {
+                ADD_PROT_REASON("tag \"%s\" (tag #%zu) shares a path and fourCC with tag #%zu", tag_merged.c_str(), t, *t2);
             }
         }
         return !reasons.empty();
     }
 
     std::optional<std::size_t> Map::find_tag(const char *tag_path, TagFourCC tag_fourcc) const noexcept {
-        for(auto &tag : tags) {
-            if(tag.get_tag_fourcc() == tag_fourcc && tag.get_path() == tag_path) {
-                return &tag - tags.data();
-            }
-        }
-        return std::nullopt;
+        std::call_once(this->tag_path_index_built, [this]() { const_cast<Map *>(this)->build_tag_path_index(); });
+        return this->tag_path_index.find(tag_path, tag_fourcc);
     }
 
     Map::Map(Map &&move) {
         this->data = std::move(move.data);
+        this->mapped_data = std::move(move.mapped_data);
+        this->mapped_data_size = move.mapped_data_size;
         this->bitmap_data = std::move(move.bitmap_data);
         this->loc_data = std::move(move.loc_data);
         this->sound_data = std::move(move.sound_data);
+        this->bitmap_view = std::move(move.bitmap_view);
+        this->loc_view = std::move(move.loc_view);
+        this->sound_view = std::move(move.sound_view);
         this->cache_version = move.cache_version;
         this->load_map();
         this->compressed = move.compressed;
@@ -643,8 +792,8 @@ namespace Invader {
         return this->get_data_at_offset(offset, minimum_size);
     }
     
-    bool Map::is_clean() const noexcept {
-        if(this->get_crc32() != this->get_header_crc32() || this->is_protected() || this->data.size() != this->get_header_decompressed_file_size() || this->get_type() != this->get_header_type()) {
+    bool Map::is_clean(std::size_t thread_count) const noexcept {
+        if(this->get_crc32(thread_count) != this->get_header_crc32() || this->is_protected() || this->get_data_length() != this->get_header_decompressed_file_size() || this->get_type() != this->get_header_type()) {
             return false;
         }
         else if(this->get_cache_version() != HEK::CacheFileEngine::CACHE_FILE_NATIVE) {
@@ -3,6 +3,9 @@
 #include <invader/map/tag.hpp>
 #include <invader/map/map.hpp>
 #include <invader/tag/hek/definition.hpp>
+#include <mutex>
+
+#include "../util/assert.hpp"
 
 namespace Invader {
     bool Tag::data_is_available() const noexcept {
@@ -10,14 +13,7 @@ namespace Invader {
 
         // If it's indexed, check if the corresponding data is available
         if(this->is_indexed()) {
-            switch(this->tag_fourcc) {
-                case TagFourCC::TAG_FOURCC_BITMAP:
-                    return !this->map.bitmap_data.empty();
-                case TagFourCC::TAG_FOURCC_SOUND:
-                    return !this->map.sound_data.empty();
-                default:
-                    return !this->map.loc_data.empty();
-            }
+            return this->resource_available;
         }
 
         // If the base struct pointer is 0xFFFFFFFF, well... lol
@@ -49,6 +45,8 @@ namespace Invader {
     
     std::byte *Tag::data(HEK::Pointer64 pointer, std::size_t minimum) {
         using namespace HEK;
+
+        this->load_data();
         
         auto engine = this->get_map().get_cache_version();
 
@@ -112,5 +110,18 @@ namespace Invader {
         return const_cast<Tag *>(this)->get_tag_data_index();
     }
 
+    void Tag::load_path() const noexcept {
+        std::call_once(this->map.tag_path_loaded[this->tag_index], [this]() { this->map.load_tag_path(const_cast<Tag &>(*this)); });
+    }
+
+    void Tag::load_data() const noexcept {
+        // Map::load_tag_data() only throws when looking up indexed tags in their resource maps, and those are all loaded when
+        // the map is loaded, so what is left to do here can't throw
+        std::call_once(this->map.tag_data_loaded[this->tag_index], [this]() {
+            invader_assert(this->map.get_cache_version() == HEK::CacheFileEngine::CACHE_FILE_NATIVE || !this->get_tag_data_index().indexed);
+            this->map.load_tag_data(const_cast<Tag &>(*this));
+        });
+    }
+
     Tag::Tag(Map &map) : map(map) {}
 }
@@ -3,9 +3,26 @@
 #include <invader/resource/resource_map.hpp>
 #include <invader/resource/hek/resource_map.hpp>
 #include <invader/file/file.hpp>
+#include <invader/printf.hpp>
+#include <cstring>
 
 namespace Invader {
-    std::vector<Resource> load_resource_map(const std::byte *data, std::size_t size) {
+    std::string ResourceView::path() const {
+        return File::remove_duplicate_slashes(this->raw_path);
+    }
+
+    bool ResourceView::path_equals(const std::string &path) const {
+        // Almost no paths have duplicate slashes, so only bother removing them if we find some
+        auto is_separator = [](char c) { return c == '\\' || c == '/' || c == INVADER_PREFERRED_PATH_SEPARATOR; };
+        for(const char *c = this->raw_path; *c; c++) {
+            if(is_separator(c[0]) && is_separator(c[1])) {
+                return this->path() == path;
+            }
+        }
+        return path == this->raw_path;
+    }
+
+    std::vector<ResourceView> view_resource_map(const std::byte *data, std::size_t size) {
         using namespace HEK;
         if(size < sizeof(ResourceMapHeader)) {
             throw OutOfBoundsException();
@@ -30,7 +47,8 @@ namespace Invader {
         }
         const auto *resources = reinterpret_cast<const ResourceMapResource *>(data + resource_offset);
 
-        std::vector<Resource> returned_resources;
+        std::vector<ResourceView> returned_resources;
+        returned_resources.reserve(resource_count);
 
         for(std::size_t r = 0; r < resource_count; r++) {
             std::size_t resource_data_offset = resources[r].data_offset;
@@ -48,7 +66,7 @@ namespace Invader {
             }
             const auto *resource_path = reinterpret_cast<const char *>(data + resource_path_offset);
             for(;;resource_path_length++) {
-                if(resource_path_length >= size) {
+                if(resource_path_offset + resource_path_length >= size) {
                     throw OutOfBoundsException();
                 }
                 else if(resource_path[resource_path_length] == 0) {
@@ -56,15 +74,80 @@ namespace Invader {
                 }
             }
 
-            Resource resource;
-            resource.path = Invader::File::remove_duplicate_slashes(resource_path);
-            resource.data = std::vector<std::byte>(resource_data, resource_data + resource_data_size);
+            auto &resource = returned_resources.emplace_back();
+            resource.data = std::span<const std::byte>(resource_data, resource_data_size);
+            resource.raw_path = resource_path;
             resource.path_offset = resource_path_offset;
             resource.data_offset = resource_data_offset;
+        }
 
-            returned_resources.push_back(resource);
+        return returned_resources;
+    }
+
+    std::vector<Resource> load_resource_map(const std::byte *data, std::size_t size) {
+        auto views = view_resource_map(data, size);
+
+        std::vector<Resource> returned_resources;
+        returned_resources.reserve(views.size());
+
+        for(auto &view : views) {
+            auto &resource = returned_resources.emplace_back();
+            resource.path = view.path();
+            resource.data = std::vector<std::byte>(view.data.begin(), view.data.end());
+            resource.path_offset = view.path_offset;
+            resource.data_offset = view.data_offset;
         }
 
         return returned_resources;
     }
+
+    ResourceMapView ResourceMapView::view_file(const std::filesystem::path &path) {
+        ResourceMapView view;
+
+        // If we can't map it (e.g. it's empty), read it instead
+        view.mapped_data = File::MemoryMappedFile::open(path);
+        if(!view.mapped_data.has_value()) {
+            auto file = File::open_file(path);
+            if(!file.has_value()) {
+                throw FailedToOpenFileException();
+            }
+            view.data = std::move(*file);
+        }
+
+        view.read_resources();
+        return view;
+    }
+
+    ResourceMapView ResourceMapView::view_data(std::vector<std::byte> &&data) {
+        ResourceMapView view;
+        view.data = std::move(data);
+        view.read_resources();
+        return view;
+    }
+
+    void ResourceMapView::read_resources() {
+        this->resources = view_resource_map(this->get_data(), this->get_data_length());
+
+        std::size_t resource_count = this->resources.size();
+        this->path_index.reserve(resource_count);
+        this->odd_path_index.reserve(resource_count / 2);
+
+        // emplace() keeps the existing entry, so earlier resources take priority just like a linear search would
+        for(std::size_t r = 0; r < resource_count; r++) {
+            auto path = this->resources[r].path();
+            if(r % 2 == 1) {
+                this->odd_path_index.emplace(path, r);
+            }
+            this->path_index.emplace(std::move(path), r);
+        }
+    }
+
+    std::optional<std::size_t> ResourceMapView::find(const std::string &path, bool odd_only) const noexcept {
+        const auto &index = odd_only ? this->odd_path_index : this->path_index;
+        auto found = index.find(path);
+        if(found == index.end()) {
+            return std::nullopt;
+        }
+        return found->second;
+    }
 }
@@ -35,8 +35,7 @@ int main(int argc, char * const *argv) {
         }
     });
     
-    auto map_data = File::open_file(remaining_arguments[0]).value();
-    auto map = Map::map_with_copy(map_data.data(), map_data.size());
+    auto map = Map::map_with_mapping(remaining_arguments[0]);
     auto tag_count = map.get_tag_count();
     
     for(std::size_t t = 0; t < tag_count; t++) {
@@ -13,8 +13,10 @@ from check_invalid_ranges import make_check_invalid_ranges
 from check_invalid_indices import make_check_invalid_indices
 from check_normalize import make_normalize
 from scan_padding import make_scan_padding
+from scan_dependencies import make_scan_hek_tag_dependencies
+from view import make_view
 
-def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp, cpp_save_hek_data, cpp_read_hek_data, cpp_read_cache_file_data, cpp_cache_format_data, cpp_cache_deformat_data, cpp_refactor_reference, cpp_struct_value, cpp_check_invalid_ranges, cpp_check_invalid_indices, cpp_normalize, cpp_read_hek_file, cpp_scan_padding):
+def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp, cpp_save_hek_data, cpp_read_hek_data, cpp_read_cache_file_data, cpp_cache_format_data, cpp_cache_deformat_data, cpp_refactor_reference, cpp_struct_value, cpp_check_invalid_ranges, cpp_check_invalid_indices, cpp_normalize, cpp_read_hek_file, cpp_scan_padding, cpp_scan_dependencies, cpp_view):
     def write_for_all_cpps(what):
         cpp_save_hek_data.write(what)
         cpp_read_cache_file_data.write(what)
@@ -28,6 +30,8 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
         cpp_normalize.write(what)
         cpp_read_hek_file.write(what)
         cpp_scan_padding.write(what)
+        cpp_scan_dependencies.write(what)
+        cpp_view.write(what)
 
     hpp.write("// SPDX-License-Identifier: GPL-3.0-only\n\n// This file was auto-generated.\n// If you want to edit this, edit the .json definitions and rerun the generator script, instead.\n\n")
     write_for_all_cpps("// SPDX-License-Identifier: GPL-3.0-only\n\n// This file was auto-generated.\n// If you want to edit this, edit the .json definitions and rerun the generator script, instead.\n\n")
@@ -51,6 +55,11 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
     cpp_cache_format_data.write("#include <invader/build/build_workload.hpp>\n")
     cpp_read_cache_file_data.write("#include <invader/file/file.hpp>\n")
     cpp_read_hek_data.write("#include <invader/file/file.hpp>\n")
+    cpp_scan_dependencies.write("#include <cstring>\n")
+    cpp_view.write("#include <cstring>\n")
+    cpp_view.write("#include <exception>\n")
+    cpp_save_hek_data.write("#include <algorithm>\n")
+    cpp_save_hek_data.write("#include <cstring>\n")
     cpp_save_hek_data.write("extern \"C\" std::uint32_t crc32(std::uint32_t crc, const void *buf, std::size_t size) noexcept;\n")
     write_for_all_cpps("namespace Invader::Parser {\n")
 
@@ -187,6 +196,8 @@ def make_parser(all_enums, all_bitfields, all_structs_arranged, all_structs, hpp
         make_parse_cache_file_data(post_cache_parse, all_bitfields, all_used_structs, struct_name, hpp, cpp_read_cache_file_data)
         make_parse_hek_tag_data(postprocess_hek_data, all_bitfields, struct_name, all_used_structs, hpp, cpp_read_hek_data)
         make_parse_hek_tag_file(struct_name, hpp, cpp_read_hek_file)
+        make_scan_hek_tag_dependencies(all_used_structs, struct_name, all_structs, hpp, cpp_scan_dependencies)
+        make_view(all_used_structs, struct_name, struct["class"] if "class" in struct else None, all_structs, hpp, cpp_view)
         make_refactor_reference(all_used_structs, struct_name, hpp, cpp_refactor_reference)
         make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_structs, all_used_groups, hpp, struct_name, read_only, title)
         make_check_invalid_ranges(all_used_structs, struct_name, hpp, cpp_check_invalid_ranges)
@@ -8,6 +8,11 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
     cpp_struct_value.write("    std::vector<ParserStructValue> values;\n")
     cpp_struct_value.write("    values.reserve({});\n".format(len(all_used_structs)))
 
+    # Describe the same fields for visit_fields(); these are (member name, value type, count, volatile, allowed classes, enum count, excluded options, bitmask)
+    fields = []
+    def add_field(member_name, value_type, count = 1, volatile = False, classes = None, enum_count = 0, excluded = None, bitmask = 0):
+        fields.append((member_name, value_type, count, volatile, classes, enum_count, excluded, bitmask))
+
     for struct in all_used_structs:
         if "hidden" in struct and struct["hidden"]:
             continue
@@ -40,7 +45,9 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
 
             if classes[0] == "*":
                 cpp_struct_value.write("    values.emplace_back({}, nullptr, 0, {});\n".format(first_arguments, struct_read_only))
+                add_field(member_name, "DEPENDENCY")
             else:
+                add_field(member_name, "DEPENDENCY", classes = classes)
                 cpp_struct_value.write("    TagFourCC {}_types[] = {{".format(member_name));
                 for c in range(0, classes_len):
                     if c != 0:
@@ -58,9 +65,11 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
                 maximum = struct["maximum"]
 
             vstruct = "std::vector<{}>".format(struct["struct"])
+            add_field(member_name, "REFLEXIVE")
             cpp_struct_value.write("    values.emplace_back({}, ParserStructValue::get_object_in_array_template<{}>, ParserStructValue::get_array_size_template<{}>, ParserStructValue::delete_objects_in_array_template<{}>, ParserStructValue::insert_object_in_array_template<{}>, ParserStructValue::duplicate_object_in_array_template<{}>, ParserStructValue::swap_object_in_array_template<{}>, static_cast<std::size_t>({}), static_cast<std::size_t>({}), {});\n".format(first_arguments, vstruct, vstruct, vstruct, vstruct, vstruct, vstruct, minimum, maximum, struct_read_only))
         elif type == "TagDataOffset" or type == "TagString":
             cpp_struct_value.write("    values.emplace_back({}, {});\n".format(first_arguments, struct_read_only))
+            add_field(member_name, "TAGDATAOFFSET" if type == "TagDataOffset" else "TAGSTRING")
         elif type == "ScenarioScriptNodeValue" or type == "ScenarioStructureBSPArrayVertex":
             pass
         else:
@@ -92,6 +101,8 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
                     if mask == 0:
                         break
 
+                    add_field(member_name, "BITMASK", bitmask = mask)
+
                     cpp_struct_value.write("    values.emplace_back({}, ParserStructValue::list_bitmask_template<HEK::{}, HEK::{}_to_string, {}, 0x{:X}>, ParserStructValue::list_bitmask_template<HEK::{}, HEK::{}_to_string_pretty, {}, 0x{:X}>, ParserStructValue::read_bitfield_template<HEK::{}, HEK::{}_from_string>, ParserStructValue::write_bitfield_template<HEK::{}, HEK::{}_from_string>, {});\n".format(first_arguments, type, type, len(b["fields_formatted"]), mask, type, type, len(b["fields_formatted"]), mask, type, type, type, type, struct_read_only))
                     break
             if found:
@@ -99,6 +110,7 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
             for e in all_enums:
                 if type == e["name"]:
                     found = True
+                    add_field(member_name, "ENUM", enum_count = len(e["options_formatted"]), excluded = struct["__excluded"] if "__excluded" in struct else None)
                     cpp_struct_value.write("    {\n")
                     ignorelist_params = ""
 
@@ -127,10 +139,13 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
             volatile = "true" if ("volatile" in struct and struct["volatile"]) else "false"
 
             cpp_struct_value.write("    values.emplace_back({}, ParserStructValue::ValueType::VALUE_TYPE_{}, {}, {}, {}, {}, {}, {}, {});\n".format(first_arguments, type.upper(), unit, count, bounds, volatile, struct_read_only, minimum, maximum))
+            add_field(member_name, type.upper(), count = count, volatile = volatile == "true")
 
     cpp_struct_value.write("    return values;\n")
     cpp_struct_value.write("}\n")
 
+    make_fields(fields, struct_name, hpp, cpp_struct_value)
+
     hpp.write("        const char *struct_name() const override;\n")
     cpp_struct_value.write("const char *{}::struct_name() const {{\n".format(struct_name))
     cpp_struct_value.write("    return \"{}\";\n".format(struct_name))
@@ -158,3 +173,70 @@ def make_parser_struct(cpp_struct_value, all_enums, all_bitfields, all_used_stru
                 else:
                     raise Exception("ohno")
         cpp_struct_value.write("}\n")
+
+def make_fields(fields, struct_name, hpp, cpp_struct_value):
+    hpp.write("    private:\n")
+    for f in fields:
+        (member_name, value_type, count, volatile, classes, enum_count, excluded, bitmask) = f
+        if classes is not None:
+            hpp.write("        static constexpr TagFourCC fields_{}_classes[] = {{ {} }};\n".format(member_name, ", ".join("TagFourCC::TAG_FOURCC_{}".format(c.upper()) for c in classes)))
+        if excluded is not None:
+            hpp.write("        static constexpr std::uint16_t fields_{}_excluded[] = {{ {} }};\n".format(member_name, ", ".join(str(e) for e in excluded)))
+    hpp.write("    public:\n")
+    hpp.write("        /**\n")
+    hpp.write("         * Fields of the struct; these are the same ones get_values() returns, without the groups\n")
+    hpp.write("         */\n")
+    hpp.write("        static constexpr std::array<ParserStructField, {}> fields = {{{{\n".format(len(fields)))
+    for f in fields:
+        (member_name, value_type, count, volatile, classes, enum_count, excluded, bitmask) = f
+        hpp.write("            {{ \"{}\", ParserStructValue::ValueType::VALUE_TYPE_{}, {}, {}, {}, {}, {}, 0x{:X} }},\n".format(
+            member_name,
+            value_type,
+            count,
+            "true" if volatile else "false",
+            "{}" if classes is None else "fields_{}_classes".format(member_name),
+            enum_count,
+            "{}" if excluded is None else "fields_{}_excluded".format(member_name),
+            bitmask
+        ))
+    hpp.write("        }};\n\n")
+
+    hpp.write("        /**\n")
+    hpp.write("         * Call the visitor for each field with the field's description and the field's member in each struct, stopping if the visitor returns false\n")
+    hpp.write("         * @param visitor visitor to call\n")
+    hpp.write("         * @param structs structs to get the members from\n")
+    hpp.write("         * @return        true if every field was visited\n")
+    hpp.write("         */\n")
+    hpp.write("        template <typename Visitor, typename... Structs>\n")
+    if len(fields) == 0:
+        hpp.write("        static bool visit_fields(Visitor &&, Structs &...) {\n")
+        hpp.write("            return true;\n")
+    else:
+        hpp.write("        static bool visit_fields(Visitor &&visitor, Structs &... structs) {\n")
+        hpp.write("            return")
+        for i in range(len(fields)):
+            hpp.write("{}\n                visitor(fields[{}], structs.{}...)".format(" &&" if i > 0 else "", i, fields[i][0]))
+        hpp.write(";\n")
+    hpp.write("        }\n")
+
+    hpp.write("        bool check_for_broken_enums(bool reset_enums) override;\n")
+    hpp.write("        bool check_for_invalid_references(bool null_references) override;\n")
+    hpp.write("        std::vector<const Dependency *> get_dependencies() override;\n")
+    cpp_struct_value.write("bool {}::check_for_broken_enums(bool reset_enums) {{\n".format(struct_name))
+    cpp_struct_value.write("    return check_for_broken_enums_template(*this, reset_enums);\n")
+    cpp_struct_value.write("}\n")
+    cpp_struct_value.write("bool {}::check_for_invalid_references(bool null_references) {{\n".format(struct_name))
+    cpp_struct_value.write("    return check_for_invalid_references_template(*this, null_references);\n")
+    cpp_struct_value.write("}\n")
+    cpp_struct_value.write("std::vector<const Dependency *> {}::get_dependencies() {{\n".format(struct_name))
+    cpp_struct_value.write("    std::vector<const Dependency *> dependencies;\n")
+    cpp_struct_value.write("    get_dependencies_template(*this, dependencies);\n")
+    cpp_struct_value.write("    return dependencies;\n")
+    cpp_struct_value.write("}\n")
+
+    hpp.write("    protected:\n")
+    hpp.write("        bool compare_fields(const ParserStruct &what, bool precision, bool ignore_volatile) const override;\n")
+    hpp.write("    public:\n")
+    cpp_struct_value.write("bool {}::compare_fields(const ParserStruct &what, bool precision, bool ignore_volatile) const {{\n".format(struct_name))
+    cpp_struct_value.write("    return compare_template(*this, static_cast<const {} &>(what), precision, ignore_volatile);\n".format(struct_name))
+    cpp_struct_value.write("}\n")
@@ -0,0 +1,91 @@
+# SPDX-License-Identifier: GPL-3.0-only
+
+# Find out if a struct has anything stored after it (dependency paths, reflexives, or data); if not, an array of them can be skipped over in one go
+def has_trailing_data(name, all_structs):
+    for s in all_structs:
+        if s["name"] == name:
+            if "inherits" in s and has_trailing_data(s["inherits"], all_structs):
+                return True
+            for f in s["fields"]:
+                if f["type"] == "TagDependency" or f["type"] == "TagReflexive" or f["type"] == "TagDataOffset":
+                    return True
+            return False
+    return False
+
+def make_scan_hek_tag_dependencies(all_used_structs, struct_name, all_structs, hpp, cpp_scan_dependencies):
+    hpp.write("\n        /**\n")
+    hpp.write("         * Scan the HEK tag data for dependencies without parsing it.\n")
+    hpp.write("         * @param data         Data to read from for structs, tag references, and reflexives; if data_this is nullptr, this must point to the struct\n")
+    hpp.write("         * @param data_size    Size of the buffer\n")
+    hpp.write("         * @param data_read    This will be set to the amount of data read. If data_this is null, then the initial struct will also be added\n")
+    hpp.write("         * @param dependencies Dependencies with a path are added to this; if this is null, then the data is only skipped over\n")
+    hpp.write("         * @param data_this    Pointer to the struct; if this is null, then data will be used instead\n")
+    hpp.write("         */\n")
+    hpp.write("        static void scan_hek_tag_dependencies(const std::byte *data, std::size_t data_size, std::size_t &data_read, std::vector<ScannedDependency> *dependencies, const std::byte *data_this = nullptr);\n")
+    cpp_scan_dependencies.write("    void {}::scan_hek_tag_dependencies([[maybe_unused]] const std::byte *data, std::size_t data_size, std::size_t &data_read, [[maybe_unused]] std::vector<ScannedDependency> *dependencies, const std::byte *data_this) {{\n".format(struct_name))
+    cpp_scan_dependencies.write("        data_read = 0;\n")
+    cpp_scan_dependencies.write("        if(data_this == nullptr) {\n")
+    cpp_scan_dependencies.write("            if(sizeof(struct_big) > data_size) {\n")
+    cpp_scan_dependencies.write("                throw OutOfBoundsException();\n")
+    cpp_scan_dependencies.write("            }\n")
+    cpp_scan_dependencies.write("            data_this = data;\n")
+    cpp_scan_dependencies.write("            data_size -= sizeof(struct_big);\n")
+    cpp_scan_dependencies.write("            data_read += sizeof(struct_big);\n")
+    cpp_scan_dependencies.write("            data += sizeof(struct_big);\n")
+    cpp_scan_dependencies.write("        }\n")
+
+    trailing = [s for s in all_used_structs if s["type"] == "TagDependency" or s["type"] == "TagReflexive" or s["type"] == "TagDataOffset"]
+    if len(trailing) > 0:
+        cpp_scan_dependencies.write("        const auto &h = *reinterpret_cast<const struct_big *>(data_this);\n")
+
+    for struct in trailing:
+        name = struct["member_name"]
+        unread = ("cache_only" in struct and struct["cache_only"]) or ("unused" in struct and struct["unused"])
+        if struct["type"] == "TagDependency":
+            cpp_scan_dependencies.write("        std::size_t h_{}_length = h.{}.path_size;\n".format(name, name))
+            cpp_scan_dependencies.write("        if(h_{}_length > 0) {{\n".format(name))
+            cpp_scan_dependencies.write("            if(h_{}_length + 1 > data_size) {{\n".format(name))
+            cpp_scan_dependencies.write("                throw OutOfBoundsException();\n")
+            cpp_scan_dependencies.write("            }\n")
+            cpp_scan_dependencies.write("            if(static_cast<char>(data[h_{}_length]) != 0 || std::memchr(data, 0, h_{}_length) != nullptr) {{\n".format(name, name))
+            cpp_scan_dependencies.write("                throw InvalidTagDataException();\n")
+            cpp_scan_dependencies.write("            }\n")
+            if not unread:
+                cpp_scan_dependencies.write("            if(dependencies) {\n")
+                cpp_scan_dependencies.write("                dependencies->emplace_back(ScannedDependency {{ h.{}.tag_fourcc, std::string_view(reinterpret_cast<const char *>(data), h_{}_length) }});\n".format(name, name))
+                cpp_scan_dependencies.write("            }\n")
+            cpp_scan_dependencies.write("            data_size -= h_{}_length + 1;\n".format(name))
+            cpp_scan_dependencies.write("            data_read += h_{}_length + 1;\n".format(name))
+            cpp_scan_dependencies.write("            data += h_{}_length + 1;\n".format(name))
+            cpp_scan_dependencies.write("        }\n")
+        elif struct["type"] == "TagReflexive":
+            cpp_scan_dependencies.write("        std::size_t h_{}_count = h.{}.count;\n".format(name, name))
+            cpp_scan_dependencies.write("        if(h_{}_count > 0) {{\n".format(name))
+            cpp_scan_dependencies.write("            const auto *array = reinterpret_cast<const {}::struct_big *>(data);\n".format(struct["struct"]))
+            cpp_scan_dependencies.write("            std::size_t total_size = sizeof(*array) * h_{}_count;\n".format(name))
+            cpp_scan_dependencies.write("            if(total_size > data_size) {\n")
+            cpp_scan_dependencies.write("                throw OutOfBoundsException();\n")
+            cpp_scan_dependencies.write("            }\n")
+            cpp_scan_dependencies.write("            data_size -= total_size;\n")
+            cpp_scan_dependencies.write("            data_read += total_size;\n")
+            cpp_scan_dependencies.write("            data += total_size;\n")
+
+            # Nothing stored after each element means there's nothing else to read
+            if has_trailing_data(struct["struct"], all_structs):
+                cpp_scan_dependencies.write("            for(std::size_t ref = 0; ref < h_{}_count; ref++) {{\n".format(name))
+                cpp_scan_dependencies.write("                std::size_t ref_data_read = 0;\n")
+                cpp_scan_dependencies.write("                {}::scan_hek_tag_dependencies(data, data_size, ref_data_read, {}, reinterpret_cast<const std::byte *>(array + ref));\n".format(struct["struct"], "nullptr" if unread else "dependencies"))
+                cpp_scan_dependencies.write("                data += ref_data_read;\n")
+                cpp_scan_dependencies.write("                data_read += ref_data_read;\n")
+                cpp_scan_dependencies.write("                data_size -= ref_data_read;\n")
+                cpp_scan_dependencies.write("            }\n")
+            cpp_scan_dependencies.write("        }\n")
+        elif struct["type"] == "TagDataOffset":
+            cpp_scan_dependencies.write("        std::size_t h_{}_size = h.{}.size;\n".format(name, name))
+            cpp_scan_dependencies.write("        if(h_{}_size > data_size) {{\n".format(name))
+            cpp_scan_dependencies.write("            throw OutOfBoundsException();\n")
+            cpp_scan_dependencies.write("        }\n")
+            cpp_scan_dependencies.write("        data_size -= h_{}_size;\n".format(name))
+            cpp_scan_dependencies.write("        data_read += h_{}_size;\n".format(name))
+            cpp_scan_dependencies.write("        data += h_{}_size;\n".format(name))
+    cpp_scan_dependencies.write("    }\n")
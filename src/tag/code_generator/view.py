@@ -0,0 +1,166 @@
+# SPDX-License-Identifier: GPL-3.0-only
+
+from scan_dependencies import has_trailing_data
+
+def make_view(all_used_structs, struct_name, tag_class, all_structs, hpp, cpp_view):
+    # Dependency paths, reflexives, and data are stored after the struct in the order of the fields, so finding one means skipping over the ones before it
+    trailing = [s for s in all_used_structs if s["type"] == "TagDependency" or s["type"] == "TagReflexive" or s["type"] == "TagDataOffset"]
+
+    hpp.write("\n        /**\n")
+    hpp.write("         * Read-only view of HEK tag data. Fields are read straight from the tag data without parsing or copying it, so the data\n")
+    hpp.write("         * must outlive the view. Getting a dependency, reflexive, or data field skips over the ones stored before it.\n")
+    hpp.write("         */\n")
+    hpp.write("        class View {\n")
+    hpp.write("        public:\n")
+    hpp.write("            using struct_big = HEK::{}<HEK::BigEndian>;\n\n".format(struct_name))
+    hpp.write("            /**\n")
+    hpp.write("             * View the HEK tag file\n")
+    hpp.write("             * @param data      Tag file data to read from\n")
+    hpp.write("             * @param data_size Size of the tag file\n")
+    hpp.write("             * @return          view of the base struct\n")
+    hpp.write("             * @throws          OutOfBoundsException if the base struct is out of bounds\n")
+    if tag_class is not None:
+        hpp.write("             * @throws          InvalidTagDataException if the tag file is not a {} tag\n".format(tag_class))
+    hpp.write("             */\n")
+    hpp.write("            static View from_hek_tag_file(const std::byte *data, std::size_t data_size);\n\n")
+    hpp.write("            /**\n")
+    hpp.write("             * Get the size of everything stored after the struct\n")
+    hpp.write("             * @param data_this Pointer to the struct\n")
+    hpp.write("             * @param data      Data stored after the struct\n")
+    hpp.write("             * @param data_size Size of the data\n")
+    hpp.write("             * @return          size in bytes\n")
+    hpp.write("             */\n")
+    hpp.write("            static std::size_t get_trailing_size(const std::byte *data_this, const std::byte *data, std::size_t data_size);\n\n")
+    hpp.write("            View(const std::byte *data_this, const std::byte *data, std::size_t data_size) noexcept : view_struct(reinterpret_cast<const struct_big *>(data_this)), view_data(data), view_data_size(data_size) {}\n\n")
+    hpp.write("            const struct_big &get_raw() const noexcept {\n")
+    hpp.write("                return *this->view_struct;\n")
+    hpp.write("            }\n")
+
+    for struct in all_used_structs:
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            hpp.write("            ScannedDependency {}() const;\n".format(name))
+        elif struct["type"] == "TagReflexive":
+            hpp.write("            ReflexiveView<{}::View> {}() const;\n".format(struct["struct"], name))
+        elif struct["type"] == "TagDataOffset":
+            hpp.write("            std::span<const std::byte> {}() const;\n".format(name))
+        else:
+            hpp.write("            const auto &{}() const noexcept {{\n".format(name))
+            hpp.write("                return this->view_struct->{};\n".format(name))
+            hpp.write("            }\n")
+
+    hpp.write("        private:\n")
+    hpp.write("            const struct_big *view_struct;\n")
+    hpp.write("            const std::byte *view_data;\n")
+    hpp.write("            std::size_t view_data_size;\n")
+    if len(trailing) > 0:
+        hpp.write("            const std::byte *get_trailing(std::size_t field, std::size_t &size) const;\n")
+    hpp.write("        };\n")
+
+    cpp_view.write("    {}::View {}::View::from_hek_tag_file(const std::byte *data, std::size_t data_size) {{\n".format(struct_name, struct_name))
+    cpp_view.write("        HEK::TagFileHeader::validate_header(reinterpret_cast<const HEK::TagFileHeader *>(data), data_size);\n")
+    if tag_class is not None:
+        cpp_view.write("        auto tag_fourcc = reinterpret_cast<const HEK::TagFileHeader *>(data)->tag_fourcc.read();\n")
+        cpp_view.write("        if(tag_fourcc != TagFourCC::TAG_FOURCC_{}) {{\n".format(tag_class.upper()))
+        cpp_view.write("            eprintf_error(\"Unexpected tag class %s (expected {})\", HEK::tag_fourcc_to_extension(tag_fourcc));\n".format(tag_class))
+        cpp_view.write("            throw InvalidTagDataException();\n")
+        cpp_view.write("        }\n")
+    cpp_view.write("        data += sizeof(HEK::TagFileHeader);\n")
+    cpp_view.write("        data_size -= sizeof(HEK::TagFileHeader);\n")
+    cpp_view.write("        if(sizeof(struct_big) > data_size) {\n")
+    cpp_view.write("            throw OutOfBoundsException();\n")
+    cpp_view.write("        }\n")
+    cpp_view.write("        return View(data, data + sizeof(struct_big), data_size - sizeof(struct_big));\n")
+    cpp_view.write("    }\n")
+
+    cpp_view.write("    std::size_t {}::View::get_trailing_size(const std::byte *data_this, const std::byte *data, std::size_t data_size) {{\n".format(struct_name))
+    cpp_view.write("        std::size_t data_read = 0;\n")
+    cpp_view.write("        {}::scan_hek_tag_dependencies(data, data_size, data_read, nullptr, data_this);\n".format(struct_name))
+    cpp_view.write("        return data_read;\n")
+    cpp_view.write("    }\n")
+
+    if len(trailing) == 0:
+        return
+
+    cpp_view.write("    const std::byte *{}::View::get_trailing(std::size_t field, std::size_t &size) const {{\n".format(struct_name))
+    if len(trailing) > 1:
+        cpp_view.write("        const auto &h = *this->view_struct;\n")
+    cpp_view.write("        const auto *data = this->view_data;\n")
+    cpp_view.write("        std::size_t data_size = this->view_data_size;\n")
+    for i in range(len(trailing)):
+        struct = trailing[i]
+        name = struct["member_name"]
+        cpp_view.write("        if(field == {}) {{\n".format(i))
+        cpp_view.write("            size = data_size;\n")
+        cpp_view.write("            return data;\n")
+        cpp_view.write("        }\n")
+        if i + 1 == len(trailing):
+            break
+        cpp_view.write("        {\n")
+        if struct["type"] == "TagDependency":
+            cpp_view.write("            std::size_t length = h.{}.path_size;\n".format(name))
+            cpp_view.write("            std::size_t skip = length > 0 ? length + 1 : 0;\n")
+        elif struct["type"] == "TagReflexive":
+            cpp_view.write("            std::size_t skip = h.{}.count * sizeof({}::struct_big);\n".format(name, struct["struct"]))
+        else:
+            cpp_view.write("            std::size_t skip = h.{}.size;\n".format(name))
+        cpp_view.write("            if(skip > data_size) {\n")
+        cpp_view.write("                throw OutOfBoundsException();\n")
+        cpp_view.write("            }\n")
+        if struct["type"] == "TagReflexive" and has_trailing_data(struct["struct"], all_structs):
+            cpp_view.write("            const auto *array = data;\n")
+            cpp_view.write("            data += skip;\n")
+            cpp_view.write("            data_size -= skip;\n")
+            cpp_view.write("            for(std::size_t ref = 0; ref < h.{}.count; ref++) {{\n".format(name))
+            cpp_view.write("                std::size_t ref_data_read = {}::View::get_trailing_size(array + ref * sizeof({}::struct_big), data, data_size);\n".format(struct["struct"], struct["struct"]))
+            cpp_view.write("                data += ref_data_read;\n")
+            cpp_view.write("                data_size -= ref_data_read;\n")
+            cpp_view.write("            }\n")
+        else:
+            cpp_view.write("            data += skip;\n")
+            cpp_view.write("            data_size -= skip;\n")
+        cpp_view.write("        }\n")
+    cpp_view.write("        std::terminate();\n")
+    cpp_view.write("    }\n")
+
+    for i in range(len(trailing)):
+        struct = trailing[i]
+        name = struct["member_name"]
+        if struct["type"] == "TagDependency":
+            cpp_view.write("    ScannedDependency {}::View::{}() const {{\n".format(struct_name, name))
+            cpp_view.write("        const auto &dependency = this->view_struct->{};\n".format(name))
+            cpp_view.write("        std::size_t length = dependency.path_size;\n")
+            cpp_view.write("        if(length == 0) {\n")
+            cpp_view.write("            return ScannedDependency { dependency.tag_fourcc, {} };\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        std::size_t size;\n")
+            cpp_view.write("        const auto *data = this->get_trailing({}, size);\n".format(i))
+            cpp_view.write("        if(length + 1 > size) {\n")
+            cpp_view.write("            throw OutOfBoundsException();\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        if(static_cast<char>(data[length]) != 0 || std::memchr(data, 0, length) != nullptr) {\n")
+            cpp_view.write("            throw InvalidTagDataException();\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        return ScannedDependency { dependency.tag_fourcc, std::string_view(reinterpret_cast<const char *>(data), length) };\n")
+            cpp_view.write("    }\n")
+        elif struct["type"] == "TagReflexive":
+            cpp_view.write("    ReflexiveView<{}::View> {}::View::{}() const {{\n".format(struct["struct"], struct_name, name))
+            cpp_view.write("        std::size_t count = this->view_struct->{}.count;\n".format(name))
+            cpp_view.write("        std::size_t total_size = count * sizeof({}::struct_big);\n".format(struct["struct"]))
+            cpp_view.write("        std::size_t size;\n")
+            cpp_view.write("        const auto *data = this->get_trailing({}, size);\n".format(i))
+            cpp_view.write("        if(total_size > size) {\n")
+            cpp_view.write("            throw OutOfBoundsException();\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        return ReflexiveView<{}::View>(data, count, data + total_size, size - total_size);\n".format(struct["struct"]))
+            cpp_view.write("    }\n")
+        else:
+            cpp_view.write("    std::span<const std::byte> {}::View::{}() const {{\n".format(struct_name, name))
+            cpp_view.write("        std::size_t data_size = this->view_struct->{}.size;\n".format(name))
+            cpp_view.write("        std::size_t size;\n")
+            cpp_view.write("        const auto *data = this->get_trailing({}, size);\n".format(i))
+            cpp_view.write("        if(data_size > size) {\n")
+            cpp_view.write("            throw OutOfBoundsException();\n")
+            cpp_view.write("        }\n")
+            cpp_view.write("        return std::span<const std::byte>(data, data_size);\n")
+            cpp_view.write("    }\n")
@@ -1,7 +1,11 @@
 // SPDX-License-Identifier: GPL-3.0-only
 
+#include <numeric>
+
 #include <invader/tag/parser/parser.hpp>
+#include <invader/tag/parser/compile/model_animations.hpp>
 #include <invader/build/build_workload.hpp>
+#include <invader/hek/endian.hpp>
 
 namespace Invader::Parser {
     bool read_bit_from_bitfield(std::size_t offset, std::uint32_t *fields) noexcept {
@@ -19,6 +23,43 @@ namespace Invader::Parser {
         return total_size;
     }
 
+    void swap_animation_frame_data(ModelAnimationsAnimation &animation, const std::byte *input, std::byte *output, std::size_t frame_count, bool default_data) noexcept {
+        // Get the size of each value in a frame, in order
+        std::vector<std::size_t> value_sizes;
+        for(std::size_t node = 0; node < animation.node_count; node++) {
+            if(read_bit_from_bitfield(node, animation.node_rotation_flag_data) != default_data) {
+                value_sizes.insert(value_sizes.end(), sizeof(ModelAnimationsRotation::struct_big) / sizeof(std::int16_t), sizeof(std::int16_t));
+            }
+            if(read_bit_from_bitfield(node, animation.node_transform_flag_data) != default_data) {
+                value_sizes.insert(value_sizes.end(), sizeof(ModelAnimationsTransform::struct_big) / sizeof(float), sizeof(float));
+            }
+            if(read_bit_from_bitfield(node, animation.node_scale_flag_data) != default_data) {
+                value_sizes.insert(value_sizes.end(), sizeof(ModelAnimationscale::struct_big) / sizeof(float), sizeof(float));
+            }
+        }
+
+        std::size_t frame_size = std::accumulate(value_sizes.begin(), value_sizes.end(), static_cast<std::size_t>(0));
+        if(frame_size == 0 || frame_count == 0) {
+            return;
+        }
+
+        // Every value is aligned to its own size and every frame is a multiple of 4 bytes, so no value crosses a 16 byte
+        // block and the pattern repeats every lcm(frame_size, 16) bytes
+        std::size_t pattern_size = std::lcm(frame_size, static_cast<std::size_t>(16));
+        std::vector<std::uint8_t> pattern(pattern_size);
+        std::size_t offset = 0;
+        while(offset < pattern_size) {
+            for(auto size : value_sizes) {
+                for(std::size_t b = 0; b < size; b++) {
+                    pattern[offset + b] = static_cast<std::uint8_t>((offset + size - 1 - b) % 16);
+                }
+                offset += size;
+            }
+        }
+
+        HEK::swap_big_endian_array(input, output, frame_size * frame_count, pattern.data(), pattern_size);
+    }
+
     void ModelAnimations::pre_compile(BuildWorkload &workload, std::size_t tag_index, std::size_t, std::size_t) {
         std::size_t animation_count = this->animations.size();
         std::size_t sound_count = this->sound_references.size();
@@ -161,31 +202,9 @@ namespace Invader::Parser {
             std::vector<std::byte> frame_info_little_v(frame_info_size);
             std::byte *frame_info_little = frame_info_little_v.data();
 
-            // Update frame_info data, updating everything to little endian endian
-            switch(frame_type) {
-                case HEK::AnimationFrameInfoType::ANIMATION_FRAME_INFO_TYPE_NONE:
-                    break;
-                case HEK::AnimationFrameInfoType::ANIMATION_FRAME_INFO_TYPE_DX_DY: {
-                    const auto *big = reinterpret_cast<const ModelAnimationsFrameInfoDxDy::struct_big *>(frame_info_big);
-                    auto *little = reinterpret_cast<ModelAnimationsFrameInfoDxDy::struct_little *>(frame_info_little);
-                    std::copy(big, big + frame_count, little);
-                    break;
-                }
-                case HEK::AnimationFrameInfoType::ANIMATION_FRAME_INFO_TYPE_DX_DY_DYAW: {
-                    const auto *big = reinterpret_cast<const ModelAnimationsFrameInfoDxDyDyaw::struct_big *>(frame_info_big);
-                    auto *little = reinterpret_cast<ModelAnimationsFrameInfoDxDyDyaw::struct_little *>(frame_info_little);
-                    std::copy(big, big + frame_count, little);
-                    break;
-                }
-                case HEK::AnimationFrameInfoType::ANIMATION_FRAME_INFO_TYPE_DX_DY_DZ_DYAW: {
-                    const auto *big = reinterpret_cast<const ModelAnimationsFrameInfoDxDyDzDyaw::struct_big *>(frame_info_big);
-                    auto *little = reinterpret_cast<ModelAnimationsFrameInfoDxDyDzDyaw::struct_little *>(frame_info_little);
-                    std::copy(big, big + frame_count, little);
-                    break;
-                }
-                case HEK::AnimationFrameInfoType::ANIMATION_FRAME_INFO_TYPE_ENUM_COUNT:
-                    std::terminate();
-            }
+            // Update frame_info data, updating everything to little endian endian (frame info is only floats)
+            static constexpr std::uint8_t FLOAT_SWAP_PATTERN[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+            HEK::swap_big_endian_array(frame_info_big, frame_info_little, frame_info_size, FLOAT_SWAP_PATTERN, sizeof(FLOAT_SWAP_PATTERN));
 
             this->frame_info = frame_info_little_v;
         }
@@ -215,32 +234,8 @@ namespace Invader::Parser {
 
         // Let's do default_data. Basically just add what isn't in frame_data, and only for one frame
         if(default_data_size != 0 && !compressed) {
-            const auto *default_data_big = this->default_data.data();
             std::vector<std::byte> default_data(default_data_size);
-            auto *default_data_little = default_data.data();
-            for(std::size_t node = 0; node < node_count; node++) {
-                if(!read_bit_from_bitfield(node, this->node_rotation_flag_data)) {
-                    const auto &rotation_big = *reinterpret_cast<const ModelAnimationsRotation::struct_big *>(default_data_big);
-                    auto &rotation_little = *reinterpret_cast<ModelAnimationsRotation::struct_little *>(default_data_little);
-                    rotation_little = rotation_big;
-                    default_data_big += sizeof(rotation_big);
-                    default_data_little += sizeof(rotation_big);
-                }
-                if(!read_bit_from_bitfield(node, this->node_transform_flag_data)) {
-                    const auto &transform_big = *reinterpret_cast<const ModelAnimationsTransform::struct_big *>(default_data_big);
-                    auto &transform_little = *reinterpret_cast<ModelAnimationsTransform::struct_little *>(default_data_little);
-                    transform_little = transform_big;
-                    default_data_big += sizeof(transform_big);
-                    default_data_little += sizeof(transform_big);
-                }
-                if(!read_bit_from_bitfield(node, this->node_scale_flag_data)) {
-                    const auto &scale_big = *reinterpret_cast<const ModelAnimationscale::struct_big *>(default_data_big);
-                    auto &scale_little = *reinterpret_cast<ModelAnimationscale::struct_little *>(default_data_little);
-                    scale_little = scale_big;
-                    default_data_big += sizeof(scale_big);
-                    default_data_little += sizeof(scale_big);
-                }
-            }
+            swap_animation_frame_data(*this, this->default_data.data(), default_data.data(), 1, true);
             this->default_data = default_data;
         }
         else {
@@ -256,35 +251,15 @@ namespace Invader::Parser {
             this->frame_data = std::vector<std::byte>(this->frame_data.begin() + compressed_data_offset, this->frame_data.end());
         }
         else {
-            const auto *frame_data_big = this->frame_data.data();
             if(frame_data_size > 0) {
-                std::vector<std::byte> frame_data(frame_data_size, std::byte());
-                auto *frame_data_little = frame_data.data();
-                for(std::size_t frame = 0; frame < frame_count; frame++) {
-                    for(std::size_t node = 0; node < node_count; node++) {
-                        if(read_bit_from_bitfield(node, this->node_rotation_flag_data)) {
-                            const auto &rotation_big = *reinterpret_cast<const ModelAnimationsRotation::struct_big *>(frame_data_big);
-                            auto &rotation_little = *reinterpret_cast<ModelAnimationsRotation::struct_little *>(frame_data_little);
-                            rotation_little = rotation_big;
-                            frame_data_big += sizeof(rotation_big);
-                            frame_data_little += sizeof(rotation_big);
-                        }
-                        if(read_bit_from_bitfield(node, this->node_transform_flag_data)) {
-                            const auto &transform_big = *reinterpret_cast<const ModelAnimationsTransform::struct_big *>(frame_data_big);
-                            auto &transform_little = *reinterpret_cast<ModelAnimationsTransform::struct_little *>(frame_data_little);
-                            transform_little = transform_big;
-                            frame_data_big += sizeof(transform_big);
-                            frame_data_little += sizeof(transform_big);
-                        }
-                        if(read_bit_from_bitfield(node, this->node_scale_flag_data)) {
-                            const auto &scale_big = *reinterpret_cast<const ModelAnimationscale::struct_big *>(frame_data_big);
-                            auto &scale_little = *reinterpret_cast<ModelAnimationscale::struct_little *>(frame_data_little);
-                            scale_little = scale_big;
-                            frame_data_big += sizeof(scale_big);
-                            frame_data_little += sizeof(scale_big);
-                        }
-                    }
+                std::size_t uncompressed_frame_data_size = total_frame_size * frame_count;
+                if(uncompressed_frame_data_size > frame_data_size) {
+                    REPORT_ERROR_PRINTF(workload, ERROR_TYPE_FATAL_ERROR, tag_index, "Animation #%zu has an invalid frame data size (%zu < %zu)", animation_index, frame_data_size, uncompressed_frame_data_size);
+                    throw InvalidTagDataException();
                 }
+
+                std::vector<std::byte> frame_data(frame_data_size, std::byte());
+                swap_animation_frame_data(*this, this->frame_data.data(), frame_data.data(), frame_count, false);
                 this->frame_data = frame_data;
             }
         }
@@ -739,7 +739,7 @@ namespace Invader::Parser {
                         new_struct_ptr.struct_index = workload.structs.size();
                         auto &new_struct = workload.structs.emplace_back();
                         new_struct.bsp = workload.structs[*workload.tags[bsp_id.index].base_struct].bsp;
-                        new_struct.data = std::vector<std::byte>(reinterpret_cast<std::byte *>(runtime_decals.data()), reinterpret_cast<std::byte *>(runtime_decals.data() + runtime_decals.size()));
+                        new_struct.data.assign(reinterpret_cast<std::byte *>(runtime_decals.data()), reinterpret_cast<std::byte *>(runtime_decals.data() + runtime_decals.size()));
                     }
                 }
             }
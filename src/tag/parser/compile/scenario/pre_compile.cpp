@@ -936,7 +936,8 @@ namespace Invader::Parser {
 
         // Get these things
         BuildWorkload::BuildWorkloadStruct script_data_struct = {};
-        script_data_struct.data = std::move(scenario.script_syntax_data);
+        // This has to be copied rather than moved, since struct data uses a different allocator than the tag's vectors
+        script_data_struct.data.assign(scenario.script_syntax_data.begin(), scenario.script_syntax_data.end());
         scenario.script_syntax_data.clear();
         const char *string_data = reinterpret_cast<const char *>(scenario.script_string_data.data());
 
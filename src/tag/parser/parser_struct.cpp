@@ -704,6 +704,36 @@ namespace Invader::Parser {
         #undef DO_TAG_CLASS
     }
 
+    std::vector<ScannedDependency> ParserStruct::scan_hek_tag_file_dependencies(const std::byte *data, std::size_t data_size) {
+        const auto *header = reinterpret_cast<const HEK::TagFileHeader *>(data);
+        HEK::TagFileHeader::validate_header(header, data_size);
+        
+        std::vector<ScannedDependency> dependencies;
+        std::size_t data_read = 0;
+        std::size_t expected_data_read = data_size - sizeof(HEK::TagFileHeader);
+
+        #define DO_TAG_CLASS(class_struct, fourcc) case TagFourCC::fourcc: { \
+            Invader::Parser::class_struct::scan_hek_tag_dependencies(data + sizeof(HEK::TagFileHeader), expected_data_read, data_read, &dependencies); \
+            if(data_read != expected_data_read) { \
+                throw InvalidTagDataException(); \
+            } \
+            return dependencies; \
+        }
+
+        switch(header->tag_fourcc) {
+            DO_BASED_ON_TAG_CLASS
+
+            case Invader::HEK::TagFourCC::TAG_FOURCC_NONE:
+            case Invader::HEK::TagFourCC::TAG_FOURCC_NULL:
+            case Invader::HEK::TagFourCC::TAG_FOURCC_SPHEROID:
+                break;
+        }
+
+        throw InvalidTagDataException();
+
+        #undef DO_TAG_CLASS
+    }
+
     std::unique_ptr<ParserStruct> ParserStruct::generate_base_struct(TagFourCC tag_class) {
         #define DO_TAG_CLASS(class_struct, fourcc) case TagFourCC::fourcc: { \
             return std::unique_ptr<ParserStruct>(new class_struct()); \
@@ -761,88 +791,31 @@ namespace Invader::Parser {
         return total;
     }
     
-    bool ParserStruct::check_for_invalid_references(bool null_references) {
-        auto &values = this->get_values();
-        bool result = false;
-        for(auto &i : values) {
-            switch(i.get_type()) {
-                case ParserStructValue::ValueType::VALUE_TYPE_DEPENDENCY: {
-                    auto &dep = i.get_dependency();
-                    auto &allowed_classes = i.get_allowed_classes(); // get allowed classes
-                    if(allowed_classes.size() >= 1 && !dep.path.empty()) { // do we even have any?
-                        bool valid = false;
-                        for(auto &c : allowed_classes) {
-                            if(c == dep.tag_fourcc) {
-                                valid = true;
-                                break;
-                            }
-                        }
-                        if(!valid) {
-                            if(null_references) {
-                                dep.tag_fourcc = allowed_classes[0]; // set it
-                                dep.path.clear(); // clear the path
-                            }
-                            result = true;
-                        }
-                    }
-                    break;
-                }
-                case ParserStructValue::ValueType::VALUE_TYPE_REFLEXIVE: {
-                    auto count = i.get_array_size();
-                    for(std::size_t c = 0; c < count && (!result || null_references); c++) { // continue until result is true, unless we're nulling references
-                        result = i.get_object_in_array(c).check_for_invalid_references(null_references) || result;
-                    }
-                    break;
-                }
-                default:
-                    break;
-            }
-            
-            // If we're done, stop
-            if(!null_references && result) {
-                break;
-            }
-        }
-        return result;
-    }
-    
     bool ParserStruct::compare(const ParserStruct *what, bool precision, bool ignore_volatile, std::list<std::string> *differences) const {
         return this->compare(what, precision, ignore_volatile, differences, 1);
     }
     
-    static constexpr bool too_different(double a, double b) noexcept {
-        double delta = 0.0001;
-        
-        auto max_discrepency = a * delta;
-        if(max_discrepency < 0.0) {
-            max_discrepency *= -1.0;
-        }
-        
-        auto difference = (a - b);
-        if(difference < 0.0) {
-            difference *= -1.0;
-        }
-        
-        // (a-b) > delta && b is not in [a - dA, a + dA]
-        return difference > delta && ((b > a + max_discrepency) || (b < a - max_discrepency));
-    }
-    
-    static_assert(too_different(1, 1) == false);
-    static_assert(too_different(1.000025, 1) == false);
-    static_assert(too_different(1.01, 1) == true);
-    static_assert(too_different(-1, 1) == true);
-    static_assert(too_different(-0.000025, 0.000025) == false);
-    static_assert(too_different(0.000025, -0.000025) == false);
-    
     bool ParserStruct::compare(const ParserStruct *what, bool precision, bool ignore_volatile, std::list<std::string> *differences_array, std::size_t depth) const {
+        static_assert(too_different(1, 1) == false);
+        static_assert(too_different(1.000025, 1) == false);
+        static_assert(too_different(1.01, 1) == true);
+        static_assert(too_different(-1, 1) == true);
+        static_assert(too_different(-0.000025, 0.000025) == false);
+        static_assert(too_different(0.000025, -0.000025) == false);
+        
         // Different struct name
-        if(typeid(this) != typeid(what)) {
+        if(typeid(*this) != typeid(*what)) {
             if(differences_array != nullptr) {
                 differences_array->emplace_back(std::string(this->struct_name()) + " is not a " + std::string(what->struct_name()));
             }
             return false;
         }
         
+        // If we don't need to list the differences, we can compare the fields directly
+        if(differences_array == nullptr) {
+            return this->compare_fields(*what, precision, ignore_volatile);
+        }
+        
         auto &this_value = *this;
         
         // Make sure these are the same
@@ -1352,54 +1325,6 @@ namespace Invader::Parser {
         return !is_different;
     }
     
-    bool ParserStruct::check_for_broken_enums(bool reset_enums) {
-        auto &values = this->get_values();
-        bool result = false;
-        for(auto &i : values) {
-            switch(i.get_type()) {
-                case ParserStructValue::ValueType::VALUE_TYPE_ENUM: {
-                    try {
-                        auto *enum_val = i.read_enum();
-                        bool inside = false;
-                        
-                        for(auto &k : i.list_enum()) {
-                            if(std::strcmp(k, enum_val) == 0) {
-                                inside = true;
-                                break;
-                            }
-                        }
-                        
-                        if(!inside) {
-                            throw std::exception(); // throw - it's not valid
-                        }
-                    }
-                    catch(std::exception &) {
-                        if(reset_enums) {
-                            i.write_enum(i.list_enum()[0]);
-                        }
-                        result = true;
-                    }
-                    break;
-                }
-                case ParserStructValue::ValueType::VALUE_TYPE_REFLEXIVE: {
-                    auto count = i.get_array_size();
-                    for(std::size_t c = 0; c < count && (!result || reset_enums); c++) { // continue until result is true, unless we're nulling references
-                        result = i.get_object_in_array(c).check_for_broken_enums(reset_enums) || result;
-                    }
-                    break;
-                }
-                default:
-                    break;
-            }
-            
-            // If we're done, stop
-            if(!reset_enums && result) {
-                break;
-            }
-        }
-        return result;
-    }
-    
     std::vector<ParserStructValue> &ParserStruct::get_values() {
         if(!this->values.has_value()) {
             this->values = this->get_values_internal();
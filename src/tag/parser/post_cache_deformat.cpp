@@ -143,34 +143,7 @@ namespace Invader::Parser {
                     throw InvalidTagDataException();
                 }
 
-                if(expected_default_data_size > 0) {
-                    auto *default_data_big = this->default_data.data();
-                    auto *default_data_little = default_data.data();
-
-                    for(std::size_t node = 0; node < this->node_count; node++) {
-                        if(!read_bit_from_bitfield(node, this->node_rotation_flag_data)) {
-                            auto &rotation_big = *reinterpret_cast<ModelAnimationsRotation::struct_big *>(default_data_big);
-                            const auto &rotation_little = *reinterpret_cast<const ModelAnimationsRotation::struct_little *>(default_data_little);
-                            rotation_big = rotation_little;
-                            default_data_big += sizeof(rotation_big);
-                            default_data_little += sizeof(rotation_big);
-                        }
-                        if(!read_bit_from_bitfield(node, this->node_transform_flag_data)) {
-                            auto &transform_big = *reinterpret_cast<ModelAnimationsTransform::struct_big *>(default_data_big);
-                            const auto &transform_little = *reinterpret_cast<const ModelAnimationsTransform::struct_little *>(default_data_little);
-                            transform_big = transform_little;
-                            default_data_big += sizeof(transform_big);
-                            default_data_little += sizeof(transform_big);
-                        }
-                        if(!read_bit_from_bitfield(node, this->node_scale_flag_data)) {
-                            auto &scale_big = *reinterpret_cast<ModelAnimationscale::struct_big *>(default_data_big);
-                            const auto &scale_little = *reinterpret_cast<const ModelAnimationscale::struct_little *>(default_data_little);
-                            scale_big = scale_little;
-                            default_data_big += sizeof(scale_big);
-                            default_data_little += sizeof(scale_big);
-                        }
-                    }
-                }
+                swap_animation_frame_data(*this, this->default_data.data(), this->default_data.data(), 1, true);
             }
         }
         // Zero out default data if there is none
@@ -196,35 +169,7 @@ namespace Invader::Parser {
                 throw InvalidTagDataException();
             }
 
-            if(frame_data_size_expected) {
-                auto *frame_data_big = this->frame_data.data();
-                auto *frame_data_little = frame_data.data();
-                for(std::size_t frame = 0; frame < frame_count; frame++) {
-                    for(std::size_t node = 0; node < this->node_count; node++) {
-                        if(read_bit_from_bitfield(node, this->node_rotation_flag_data)) {
-                            auto &rotation_big = *reinterpret_cast<ModelAnimationsRotation::struct_little *>(frame_data_big);
-                            const auto &rotation_little = *reinterpret_cast<const ModelAnimationsRotation::struct_big *>(frame_data_little);
-                            rotation_big = rotation_little;
-                            frame_data_big += sizeof(rotation_big);
-                            frame_data_little += sizeof(rotation_big);
-                        }
-                        if(read_bit_from_bitfield(node, this->node_transform_flag_data)) {
-                            auto &transform_big = *reinterpret_cast<ModelAnimationsTransform::struct_little *>(frame_data_big);
-                            const auto &transform_little = *reinterpret_cast<const ModelAnimationsTransform::struct_big *>(frame_data_little);
-                            transform_big = transform_little;
-                            frame_data_big += sizeof(transform_big);
-                            frame_data_little += sizeof(transform_big);
-                        }
-                        if(read_bit_from_bitfield(node, this->node_scale_flag_data)) {
-                            auto &scale_big = *reinterpret_cast<ModelAnimationscale::struct_little *>(frame_data_big);
-                            const auto &scale_little = *reinterpret_cast<const ModelAnimationscale::struct_big *>(frame_data_little);
-                            scale_big = scale_little;
-                            frame_data_big += sizeof(scale_big);
-                            frame_data_little += sizeof(scale_big);
-                        }
-                    }
-                }
-            }
+            swap_animation_frame_data(*this, this->frame_data.data(), this->frame_data.data(), this->frame_count, false);
         }
     }
 }